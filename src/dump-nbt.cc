@@ -5,6 +5,7 @@
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
@@ -60,13 +61,12 @@ namespace {
             }
         }
 
-        std::vector<std::uint8_t> *data;
         try {
             std::filesystem::path infile(filename);
             pixel_terrain::anvil::region r =
                 pixel_terrain::anvil::region(infile);
-            data = r.chunk_data(x, z);
-            if (data == nullptr) {
+            std::span<std::uint8_t const> data = r.chunk_data(x, z);
+            if (data.empty()) {
                 std::cerr << outname << ": Chunk not exists.\n";
                 return false;
             }
@@ -78,13 +78,12 @@ namespace {
                 return false;
             }
 
-            out.write(reinterpret_cast<char *>(data->data()), data->size());
+            out.write(reinterpret_cast<char const *>(data.data()),
+                      static_cast<std::streamsize>(data.size()));
         } catch (...) {
-            delete data;
             std::cerr << outname << ": Error dumping nbt.\n";
             return false;
         }
-        delete data;
         return true;
     }
 
@@ -3,13 +3,16 @@
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
 
 #include <regetopt.h>
 
 #include "config.h"
+#include "graphics/png.hh"
 #include "image/image.hh"
 #include "logger/logger.hh"
 #include "nbt/utils.hh"
@@ -64,12 +67,17 @@ Usage: pixel-terrain image [option]... [--] <dir>    OR
 
 Generate map image.
 
+      --biome-blend=N       Tint grass, leaves and water with biome colors
+                            averaged over (2N+1)x(2N+1) blocks, as the game
+                            does (0-7). 0 (default) only tints some biomes.
   -c DIR, --cache-dir=DIR   Use DIR as cache direcotry.
       --clear               Reset current generator configuration.
       --generate=SRC        Generate image for SRC with current configuration.
   -j N, --jobs=N            Execute N jobs concurrently. Take effects only if
                             specified before --generate option specified.
       --label               Label current configuration.
+      --manifest=FILE       Write list of images written in this run to FILE as
+                            JSON lines, with updated chunk ranges and timings.
   -n, --nether              Use image generator optimized to nether.
   -o PATH, --out=PATH       Save generated images to PATH.
                             If PATH is a file, write output image to PATH eve if
@@ -79,6 +87,25 @@ Generate map image.
       --outname-format=FMT  Specify format for output filename. Default value is
                             original filename with extension appended. Note that
                             proper extension will be appended automatically.
+      --png-compression=PRESET
+                            Set PNG encoder preset: "fast" (quick, larger files;
+                            good for frequent re-renders), "default" or "max"
+                            (slow, smallest files; good for archives).
+      --png-colors=MODE     Set color type of PNG: "rgba" (default), "auto"
+                            (indexed color if there are 256 or fewer colors, RGB
+                            if opaque) or "quantize" (same as "auto", but reduce
+                            colors to 256 if there are more).
+      --png-level=N         Set zlib compression level of PNG to N (0-9),
+                            whether before or after --png-compression.
+      --raw-cache           Keep uncompressed copy of output images in cache
+                            directory (-c), and update it in place instead of
+                            decoding PNG. Uses 1 MiB per region.
+      --split-regions       Render chunks of a region in parallel. Useful if
+                            there are fewer regions than jobs.
+      --zoom-levels=N       Also build N levels of zoomed-out tiles in
+                            zoom-1/, zoom-2/, ... of output directory. A tile
+                            of level N covers 2^N x 2^N regions. Only tiles
+                            above updated regions are rebuilt.
   -V, -VV, -VVV             Set log level. Specifying multiple times increases log level.
                             Note that --clear option does NOT clear this value.
       --help                Print this usage and exit.
@@ -92,6 +119,7 @@ Output name format speficier:
 
     auto long_options = pixel_terrain::make_array<::re_option>(
         ::re_option{"jobs", re_required_argument, nullptr, 'j'},
+        ::re_option{"biome-blend", re_required_argument, nullptr, 'B'},
         ::re_option{"cache-dir", re_required_argument, nullptr, 'c'},
         ::re_option{"clear", re_no_argument, nullptr, 'C'},
         ::re_option{"generate", re_required_argument, nullptr, 'G'},
@@ -99,6 +127,13 @@ Output name format speficier:
         ::re_option{"out", re_required_argument, nullptr, 'o'},
         ::re_option{"outname-format", re_required_argument, nullptr, 'F'},
         ::re_option{"label", re_required_argument, nullptr, 'l'},
+        ::re_option{"manifest", re_required_argument, nullptr, 'm'},
+        ::re_option{"raw-cache", re_no_argument, nullptr, 'R'},
+        ::re_option{"split-regions", re_no_argument, nullptr, 'S'},
+        ::re_option{"zoom-levels", re_required_argument, nullptr, 'Z'},
+        ::re_option{"png-compression", re_required_argument, nullptr, 'P'},
+        ::re_option{"png-colors", re_required_argument, nullptr, 'M'},
+        ::re_option{"png-level", re_required_argument, nullptr, 'L'},
         ::re_option{"help", re_no_argument, nullptr, 'h'},
         ::re_option{nullptr, 0, nullptr, 0});
 } // namespace
@@ -108,6 +143,9 @@ namespace pixel_terrain {
         std::atexit(&clean_up_generator);
 
         pixel_terrain::image::options options;
+        /* Given by --png-level, which wins over the level of presets
+           whatever the order. */
+        std::optional<int> png_level;
 
         bool should_generate = true;
 
@@ -155,6 +193,7 @@ namespace pixel_terrain {
 
             case 'C':
                 options.clear();
+                png_level.reset();
                 break;
 
             case 'G':
@@ -166,6 +205,104 @@ namespace pixel_terrain {
                 options.set_label(::re_optarg);
                 break;
 
+            case 'm':
+                options.set_manifest_path(::re_optarg);
+                break;
+
+            case 'R':
+                options.set_raw_cache(true);
+                break;
+
+            case 'S':
+                options.set_split_regions(true);
+                break;
+
+            case 'P': {
+                auto preset =
+                    graphics::png_write_options::preset(::re_optarg);
+                if (!preset) {
+                    std::cout << "Unknown PNG compression preset.\n";
+                    std::exit(1);
+                }
+                preset->color_mode = options.png_options().color_mode;
+                if (png_level) {
+                    preset->level = *png_level;
+                }
+                options.set_png_options(*preset);
+                break;
+            }
+
+            case 'M': {
+                graphics::png_write_options png_options =
+                    options.png_options();
+                std::string_view mode = ::re_optarg;
+                if (mode == "rgba") {
+                    png_options.color_mode = graphics::png_color_mode::RGBA;
+                } else if (mode == "auto") {
+                    png_options.color_mode = graphics::png_color_mode::AUTO;
+                } else if (mode == "quantize") {
+                    png_options.color_mode =
+                        graphics::png_color_mode::QUANTIZE;
+                } else {
+                    std::cout << "Unknown PNG color mode.\n";
+                    std::exit(1);
+                }
+                options.set_png_options(png_options);
+                break;
+            }
+
+            case 'L': {
+                constexpr int max_level = 9;
+                int level;
+                try {
+                    level = std::stoi(::re_optarg);
+                } catch (std::logic_error const &) {
+                    level = -1;
+                }
+                if (level < 0 || level > max_level) {
+                    std::cout << "Invalid PNG compression level.\n";
+                    std::exit(1);
+                }
+                graphics::png_write_options png_options =
+                    options.png_options();
+                png_options.level = level;
+                options.set_png_options(png_options);
+                png_level = level;
+                break;
+            }
+
+            case 'Z': {
+                constexpr int max_levels = 16;
+                int levels;
+                try {
+                    levels = std::stoi(::re_optarg);
+                } catch (std::logic_error const &) {
+                    levels = -1;
+                }
+                if (levels < 0 || levels > max_levels) {
+                    std::cout << "Invalid number of zoom levels.\n";
+                    std::exit(1);
+                }
+                options.set_zoom_levels(levels);
+                break;
+            }
+
+            case 'B': {
+                constexpr int max_radius = image::options::MAX_BIOME_BLEND;
+                int radius;
+                try {
+                    radius = std::stoi(::re_optarg);
+                } catch (std::logic_error const &) {
+                    radius = -1;
+                }
+                if (radius < 0 || radius > max_radius) {
+                    std::cout << "Invalid biome blend radius.\n";
+                    std::exit(1);
+                }
+                options.set_biome_blend(radius);
+                break;
+            }
+
             case 'h':
                 print_usage();
                 std::exit(0);
@@ -1,9 +1,29 @@
 // SPDX-License-Identifier: MIT
 
-/* Utilities for color blending, changing brightness, and so on. */
+/* Utilities for color blending, changing brightness, and so on.
+   Batch versions are vectorized with SSE2 or AVX2, chosen at runtime.
+   Blending divides in single precision float, which is exact here since
+   dividends are integers below 2^24 and quotients are truncated: no
+   quotient rounds up to the next integer. */
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#else
+#define USE_SSE2 0
+#endif
+
+#if USE_SSE2 && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define USE_AVX2 1
+#else
+#define USE_AVX2 0
+#endif
 
 #include "graphics/color.hh"
 #include "graphics/constants.hh"
@@ -91,4 +111,300 @@ namespace pixel_terrain::graphics {
                ((c[2] & CHAN_MASK) << B_OFFSET) |
                ((c[3] & CHAN_MASK) << A_OFFSET);
     }
+
+    namespace {
+        void blend_colors_scalar(std::uint32_t const *fg,
+                                 std::uint32_t const *bg, std::uint32_t *out,
+                                 std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                out[i] = blend_color(fg[i], bg[i]);
+            }
+        }
+
+        void increase_brightness_scalar(std::uint32_t const *colors,
+                                        std::int32_t const *amounts,
+                                        std::uint32_t *out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                out[i] = increase_brightness(colors[i], amounts[i]);
+            }
+        }
+
+#if USE_SSE2
+        auto channel_sse2(__m128i v, int offset) -> __m128 {
+            return _mm_cvtepi32_ps(_mm_and_si128(
+                _mm_srli_epi32(v, offset), _mm_set1_epi32(color::CHAN_MASK)));
+        }
+
+        /* Truncated quotient of non-negative N and D. */
+        auto div_sse2(__m128 n, __m128 d) -> __m128i {
+            return _mm_cvttps_epi32(_mm_div_ps(n, d));
+        }
+
+        auto blend_4_sse2(__m128i f, __m128i b) -> __m128i {
+            using namespace color;
+
+            __m128 full = _mm_set1_ps(CHAN_FULL);
+            __m128 f_a = channel_sse2(f, A_OFFSET);
+            __m128 b_a = channel_sse2(b, A_OFFSET);
+
+            __m128 new_a = _mm_sub_ps(
+                _mm_add_ps(b_a, f_a),
+                _mm_cvtepi32_ps(div_sse2(_mm_mul_ps(b_a, f_a), full)));
+            /* Lanes with zero alpha in background are replaced by
+               foreground below; avoid dividing by zero in them. */
+            __m128 divisor = _mm_max_ps(new_a, _mm_set1_ps(1));
+            __m128 b_weight = _mm_mul_ps(_mm_sub_ps(full, f_a), b_a);
+
+            __m128i result = _mm_cvttps_epi32(new_a);
+            for (unsigned int offset : {R_OFFSET, G_OFFSET, B_OFFSET}) {
+                __m128 num = _mm_add_ps(
+                    _mm_mul_ps(channel_sse2(f, offset), f_a),
+                    _mm_cvtepi32_ps(div_sse2(
+                        _mm_mul_ps(channel_sse2(b, offset), b_weight),
+                        full)));
+                __m128i c = _mm_and_si128(div_sse2(num, divisor),
+                                          _mm_set1_epi32(CHAN_MASK));
+                result = _mm_or_si128(result, _mm_slli_epi32(c, offset));
+            }
+
+            __m128i transparent =
+                _mm_cmpeq_epi32(_mm_and_si128(b, _mm_set1_epi32(CHAN_MASK)),
+                                _mm_setzero_si128());
+            return _mm_or_si128(_mm_and_si128(transparent, f),
+                                _mm_andnot_si128(transparent, result));
+        }
+
+        void blend_colors_sse2(std::uint32_t const *fg,
+                               std::uint32_t const *bg, std::uint32_t *out,
+                               std::size_t n) {
+            constexpr std::size_t width = 4;
+            std::size_t i = 0;
+            for (; i + width <= n; i += width) {
+                __m128i f =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(fg + i));
+                __m128i b =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(bg + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                                 blend_4_sse2(f, b));
+            }
+            blend_colors_scalar(fg + i, bg + i, out + i, n - i);
+        }
+
+        /* Saturating add of AMOUNTS to RGB channels; as in scalar version,
+           alpha is left as is. */
+        void increase_brightness_sse2(std::uint32_t const *colors,
+                                      std::int32_t const *amounts,
+                                      std::uint32_t *out, std::size_t n) {
+            constexpr std::size_t width = 4;
+            __m128i zero = _mm_setzero_si128();
+            __m128i full = _mm_set1_epi16(color::CHAN_FULL);
+
+            std::size_t i = 0;
+            for (; i + width <= n; i += width) {
+                __m128i c = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(colors + i));
+                __m128i a = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(amounts + i));
+
+                /* Clamp to [-255, 255] in 16-bit lanes. */
+                a = _mm_packs_epi32(a, a);
+                a = _mm_max_epi16(_mm_min_epi16(a, full),
+                                  _mm_sub_epi16(zero, full));
+                __m128i pos = _mm_unpacklo_epi16(_mm_max_epi16(a, zero), zero);
+                __m128i neg = _mm_unpacklo_epi16(
+                    _mm_max_epi16(_mm_sub_epi16(zero, a), zero), zero);
+
+                /* Spread to bytes of R, G and B. */
+                pos = _mm_or_si128(
+                    _mm_or_si128(_mm_slli_epi32(pos, color::R_OFFSET),
+                                 _mm_slli_epi32(pos, color::G_OFFSET)),
+                    _mm_slli_epi32(pos, color::B_OFFSET));
+                neg = _mm_or_si128(
+                    _mm_or_si128(_mm_slli_epi32(neg, color::R_OFFSET),
+                                 _mm_slli_epi32(neg, color::G_OFFSET)),
+                    _mm_slli_epi32(neg, color::B_OFFSET));
+
+                c = _mm_subs_epu8(_mm_adds_epu8(c, pos), neg);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), c);
+            }
+            increase_brightness_scalar(colors + i, amounts + i, out + i,
+                                       n - i);
+        }
+#endif
+
+#if USE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+        AVX2_TARGET auto channel_avx2(__m256i v, int offset) -> __m256 {
+            return _mm256_cvtepi32_ps(
+                _mm256_and_si256(_mm256_srli_epi32(v, offset),
+                                 _mm256_set1_epi32(color::CHAN_MASK)));
+        }
+
+        AVX2_TARGET auto div_avx2(__m256 n, __m256 d) -> __m256i {
+            return _mm256_cvttps_epi32(_mm256_div_ps(n, d));
+        }
+
+        AVX2_TARGET auto blend_8_avx2(__m256i f, __m256i b) -> __m256i {
+            using namespace color;
+
+            __m256 full = _mm256_set1_ps(CHAN_FULL);
+            __m256 f_a = channel_avx2(f, A_OFFSET);
+            __m256 b_a = channel_avx2(b, A_OFFSET);
+
+            __m256 new_a = _mm256_sub_ps(
+                _mm256_add_ps(b_a, f_a),
+                _mm256_cvtepi32_ps(div_avx2(_mm256_mul_ps(b_a, f_a), full)));
+            __m256 divisor = _mm256_max_ps(new_a, _mm256_set1_ps(1));
+            __m256 b_weight = _mm256_mul_ps(_mm256_sub_ps(full, f_a), b_a);
+
+            __m256i result = _mm256_cvttps_epi32(new_a);
+            for (unsigned int offset : {R_OFFSET, G_OFFSET, B_OFFSET}) {
+                __m256 num = _mm256_add_ps(
+                    _mm256_mul_ps(channel_avx2(f, offset), f_a),
+                    _mm256_cvtepi32_ps(div_avx2(
+                        _mm256_mul_ps(channel_avx2(b, offset), b_weight),
+                        full)));
+                __m256i c = _mm256_and_si256(div_avx2(num, divisor),
+                                             _mm256_set1_epi32(CHAN_MASK));
+                result =
+                    _mm256_or_si256(result, _mm256_slli_epi32(c, offset));
+            }
+
+            __m256i transparent = _mm256_cmpeq_epi32(
+                _mm256_and_si256(b, _mm256_set1_epi32(CHAN_MASK)),
+                _mm256_setzero_si256());
+            return _mm256_blendv_epi8(result, f, transparent);
+        }
+
+        AVX2_TARGET void blend_colors_avx2(std::uint32_t const *fg,
+                                           std::uint32_t const *bg,
+                                           std::uint32_t *out,
+                                           std::size_t n) {
+            constexpr std::size_t width = 8;
+            std::size_t i = 0;
+            for (; i + width <= n; i += width) {
+                __m256i f = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(fg + i));
+                __m256i b = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(bg + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                                    blend_8_avx2(f, b));
+            }
+            blend_colors_sse2(fg + i, bg + i, out + i, n - i);
+        }
+
+        AVX2_TARGET void increase_brightness_avx2(std::uint32_t const *colors,
+                                                  std::int32_t const *amounts,
+                                                  std::uint32_t *out,
+                                                  std::size_t n) {
+            constexpr std::size_t width = 8;
+            constexpr std::int32_t rgb_bytes = 0x01010100;
+            __m256i zero = _mm256_setzero_si256();
+            __m256i full = _mm256_set1_epi32(color::CHAN_FULL);
+            __m256i spread = _mm256_set1_epi32(rgb_bytes);
+
+            std::size_t i = 0;
+            for (; i + width <= n; i += width) {
+                __m256i c = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(colors + i));
+                __m256i a = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(amounts + i));
+
+                a = _mm256_max_epi32(_mm256_min_epi32(a, full),
+                                     _mm256_sub_epi32(zero, full));
+                __m256i pos =
+                    _mm256_mullo_epi32(_mm256_max_epi32(a, zero), spread);
+                __m256i neg = _mm256_mullo_epi32(
+                    _mm256_max_epi32(_mm256_sub_epi32(zero, a), zero),
+                    spread);
+
+                c = _mm256_subs_epu8(_mm256_adds_epu8(c, pos), neg);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), c);
+            }
+            increase_brightness_sse2(colors + i, amounts + i, out + i, n - i);
+        }
+
+#undef AVX2_TARGET
+#endif
+
+        auto best_kernel() -> color_kernel {
+#if USE_AVX2
+            if (__builtin_cpu_supports("avx2")) {
+                return color_kernel::AVX2;
+            }
+#endif
+#if USE_SSE2
+            return color_kernel::SSE2;
+#else
+            return color_kernel::SCALAR;
+#endif
+        }
+
+        auto resolve(color_kernel kernel) -> color_kernel {
+            static color_kernel const best = best_kernel();
+            if (kernel == color_kernel::AUTO ||
+                !color_kernel_supported(kernel)) {
+                return best;
+            }
+            return kernel;
+        }
+    } // namespace
+
+    auto color_kernel_supported(color_kernel kernel) -> bool {
+        switch (kernel) {
+        case color_kernel::AUTO:
+        case color_kernel::SCALAR:
+            return true;
+        case color_kernel::SSE2:
+            return USE_SSE2 != 0;
+        case color_kernel::AVX2:
+#if USE_AVX2
+            return __builtin_cpu_supports("avx2") != 0;
+#else
+            return false;
+#endif
+        }
+        return false;
+    }
+
+    void blend_colors(std::uint32_t const *fg, std::uint32_t const *bg,
+                      std::uint32_t *out, std::size_t n,
+                      color_kernel kernel) {
+        switch (resolve(kernel)) {
+#if USE_AVX2
+        case color_kernel::AVX2:
+            blend_colors_avx2(fg, bg, out, n);
+            return;
+#endif
+#if USE_SSE2
+        case color_kernel::SSE2:
+            blend_colors_sse2(fg, bg, out, n);
+            return;
+#endif
+        default:
+            blend_colors_scalar(fg, bg, out, n);
+            return;
+        }
+    }
+
+    void increase_brightness(std::uint32_t const *colors,
+                             std::int32_t const *amounts, std::uint32_t *out,
+                             std::size_t n, color_kernel kernel) {
+        switch (resolve(kernel)) {
+#if USE_AVX2
+        case color_kernel::AVX2:
+            increase_brightness_avx2(colors, amounts, out, n);
+            return;
+#endif
+#if USE_SSE2
+        case color_kernel::SSE2:
+            increase_brightness_sse2(colors, amounts, out, n);
+            return;
+#endif
+        default:
+            increase_brightness_scalar(colors, amounts, out, n);
+            return;
+        }
+    }
 } // namespace pixel_terrain::graphics
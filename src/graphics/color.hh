@@ -3,6 +3,7 @@
 #ifndef COLOR_HH
 #define COLOR_HH
 
+#include <cstddef>
 #include <cstdint>
 
 #include "graphics/constants.hh"
@@ -19,6 +20,25 @@ namespace pixel_terrain::graphics {
                      double opacity) -> std::uint_fast32_t;
     auto increase_brightness(std::uint_fast32_t color, int amount)
         -> std::uint_fast32_t;
+
+    /* Instruction set used by batch functions below. AUTO picks the best
+       one the CPU supports at runtime. */
+    enum class color_kernel { AUTO, SCALAR, SSE2, AVX2 };
+
+    auto color_kernel_supported(color_kernel kernel) -> bool;
+
+    /* OUT[i] = blend_color(FG[i], BG[i]) for N colors. Results are
+       identical to the single color version. OUT may alias inputs. */
+    void blend_colors(std::uint32_t const *fg, std::uint32_t const *bg,
+                      std::uint32_t *out, std::size_t n,
+                      color_kernel kernel = color_kernel::AUTO);
+
+    /* OUT[i] = increase_brightness(COLORS[i], AMOUNTS[i]) for N colors.
+       OUT may alias COLORS. */
+    void increase_brightness(std::uint32_t const *colors,
+                             std::int32_t const *amounts, std::uint32_t *out,
+                             std::size_t n,
+                             color_kernel kernel = color_kernel::AUTO);
 } // namespace pixel_terrain::graphics
 
 #endif
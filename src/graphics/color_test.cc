@@ -1,5 +1,10 @@
 // SPDX-License-Identifier: MIT
 
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
 #include <boost/test/tools/interface.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/unit_test_suite.hpp>
@@ -47,3 +52,84 @@ BOOST_AUTO_TEST_CASE(increase_brightness) {
     BOOST_TEST((graphics::increase_brightness(0x03035aff, -5) & 0xffffffff) ==
                0x000055ff);
 }
+
+namespace {
+    auto random_colors(std::size_t n, unsigned int seed)
+        -> std::vector<std::uint32_t> {
+        std::mt19937 rng(seed);
+        std::vector<std::uint32_t> result(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            result[i] = rng();
+            /* Zero and full alpha take separate paths in blending. */
+            if (i % 5 == 0) {
+                result[i] &= 0xffffff00;
+            } else if (i % 5 == 1) {
+                result[i] |= 0xff;
+            }
+        }
+        return result;
+    }
+
+    auto kernels() -> std::vector<graphics::color_kernel> {
+        std::vector<graphics::color_kernel> result;
+        for (auto kernel :
+             {graphics::color_kernel::SCALAR, graphics::color_kernel::SSE2,
+              graphics::color_kernel::AVX2}) {
+            if (graphics::color_kernel_supported(kernel)) {
+                result.push_back(kernel);
+            }
+        }
+        return result;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(blend_colors_batch) {
+    /* Not a multiple of vector width, to cover the tail. */
+    constexpr std::size_t n = 4099;
+    auto fg = random_colors(n, 1);
+    auto bg = random_colors(n, 2);
+
+    std::vector<std::uint32_t> expected(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        expected[i] = graphics::blend_color(fg[i], bg[i]) & 0xffffffff;
+    }
+
+    for (auto kernel : kernels()) {
+        std::vector<std::uint32_t> out(n);
+        graphics::blend_colors(fg.data(), bg.data(), out.data(), n, kernel);
+        BOOST_TEST(out == expected);
+
+        /* In place. */
+        out = fg;
+        graphics::blend_colors(out.data(), bg.data(), out.data(), n, kernel);
+        BOOST_TEST(out == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(increase_brightness_batch) {
+    constexpr std::size_t n = 4099;
+    auto colors = random_colors(n, 3);
+    std::mt19937 rng(4);
+    std::vector<std::int32_t> amounts(n);
+    for (std::int32_t &amount : amounts) {
+        amount = static_cast<std::int32_t>(rng() % 1201) - 600;
+    }
+    amounts[0] = 0;
+    amounts[1] = 255;
+    amounts[2] = -255;
+    amounts[3] = 100000;
+    amounts[4] = -100000;
+
+    std::vector<std::uint32_t> expected(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        expected[i] =
+            graphics::increase_brightness(colors[i], amounts[i]) & 0xffffffff;
+    }
+
+    for (auto kernel : kernels()) {
+        std::vector<std::uint32_t> out(n);
+        graphics::increase_brightness(colors.data(), amounts.data(),
+                                      out.data(), n, kernel);
+        BOOST_TEST(out == expected);
+    }
+}
@@ -13,11 +13,17 @@
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <png.h>
 #include <pngconf.h>
+#include <zlib.h>
 
 #include "graphics/constants.hh"
 #include "graphics/png.hh"
@@ -28,6 +34,328 @@ namespace pixel_terrain::graphics {
         inline constexpr std::size_t PNG_SIG_LEN = 8;
         inline constexpr int SUPPORTED_BIT_DEPTH = 8;
         inline constexpr unsigned int N_CHANNEL = 4;
+
+        void write_data(::png_structp png, ::png_bytep data, ::png_size_t len) {
+            auto *f = static_cast<std::FILE *>(::png_get_io_ptr(png));
+            if (std::fwrite(data, 1, len, f) != len) {
+                ::png_error(png, "Failed to write data");
+            }
+        }
+
+        void flush_data(::png_structp png) {
+            std::fflush(static_cast<std::FILE *>(::png_get_io_ptr(png)));
+        }
+
+        inline constexpr std::size_t MAX_PALETTE_SIZE = 256;
+
+        auto color_at(::png_const_bytep p) -> std::uint32_t {
+            using namespace color;
+
+            return std::uint32_t{p[0]} << R_OFFSET |
+                   std::uint32_t{p[1]} << G_OFFSET |
+                   std::uint32_t{p[2]} << B_OFFSET |
+                   std::uint32_t{p[3]} << A_OFFSET;
+        }
+
+        auto channel(std::uint32_t color, unsigned int n) -> unsigned int {
+            return (color >> (color::R_OFFSET - n * 8)) & color::CHAN_MASK;
+        }
+
+        /* Number of pixels of each color. Counting stops once more than
+           LIMIT colors are found. */
+        auto count_colors(::png_const_bytep data, std::size_t n_pixels,
+                          std::size_t limit)
+            -> std::unordered_map<std::uint32_t, std::uint32_t> {
+            std::unordered_map<std::uint32_t, std::uint32_t> result;
+            std::uint32_t last = color_at(data);
+            std::uint32_t run = 0;
+            for (std::size_t i = 0; i < n_pixels; ++i) {
+                std::uint32_t c = color_at(data + i * N_CHANNEL);
+                if (c == last) {
+                    ++run;
+                    continue;
+                }
+                result[last] += run;
+                if (result.size() > limit) {
+                    return result;
+                }
+                last = c;
+                run = 1;
+            }
+            result[last] += run;
+            return result;
+        }
+
+        auto is_opaque(::png_const_bytep data, std::size_t n_pixels) -> bool {
+            for (std::size_t i = 0; i < n_pixels; ++i) {
+                if (data[i * N_CHANNEL + 3] != color::CHAN_FULL) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        struct palette {
+            std::vector<std::uint32_t> colors;
+            std::unordered_map<std::uint32_t, std::uint8_t> index;
+        };
+
+        /* Move translucent entries to the front, so that tRNS chunk only
+           needs to cover them. */
+        void sort_translucent_first(palette *pal) {
+            std::vector<std::uint8_t> order(pal->colors.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_partition(
+                order.begin(), order.end(), [pal](std::uint8_t i) {
+                    return channel(pal->colors[i], 3) != color::CHAN_FULL;
+                });
+
+            std::vector<std::uint8_t> new_index(order.size());
+            std::vector<std::uint32_t> colors(order.size());
+            for (std::size_t i = 0; i < order.size(); ++i) {
+                colors[i] = pal->colors[order[i]];
+                new_index[order[i]] = i;
+            }
+            pal->colors = std::move(colors);
+            for (auto &[color, index] : pal->index) {
+                index = new_index[index];
+            }
+        }
+
+        auto exact_palette(
+            std::unordered_map<std::uint32_t, std::uint32_t> const &histogram)
+            -> palette {
+            palette result;
+            for (auto const &[color, count] : histogram) {
+                result.index[color] = result.colors.size();
+                result.colors.push_back(color);
+            }
+            return result;
+        }
+
+        /* Reduce colors in HISTOGRAM to at most MAX_COLORS by splitting
+           the box with the widest channel range at its weighted median. */
+        auto median_cut(
+            std::unordered_map<std::uint32_t, std::uint32_t> const &histogram,
+            std::size_t max_colors) -> palette {
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> entries(
+                histogram.begin(), histogram.end());
+            struct box {
+                std::size_t begin;
+                std::size_t end;
+            };
+
+            /* Returns widest channel of B and its range. */
+            auto widest = [&entries](box const &b) {
+                std::array<unsigned int, N_CHANNEL> lo;
+                std::array<unsigned int, N_CHANNEL> hi;
+                lo.fill(color::CHAN_MASK);
+                hi.fill(0);
+                for (std::size_t i = b.begin; i < b.end; ++i) {
+                    for (unsigned int ch = 0; ch < N_CHANNEL; ++ch) {
+                        unsigned int v = channel(entries[i].first, ch);
+                        lo[ch] = std::min(lo[ch], v);
+                        hi[ch] = std::max(hi[ch], v);
+                    }
+                }
+                std::pair<unsigned int, unsigned int> result(0, 0);
+                for (unsigned int ch = 0; ch < N_CHANNEL; ++ch) {
+                    if (hi[ch] - lo[ch] > result.second) {
+                        result = {ch, hi[ch] - lo[ch]};
+                    }
+                }
+                return result;
+            };
+
+            std::vector<box> boxes = {{0, entries.size()}};
+            while (boxes.size() < max_colors) {
+                std::size_t target = boxes.size();
+                std::pair<unsigned int, unsigned int> target_channel(0, 0);
+                for (std::size_t i = 0; i < boxes.size(); ++i) {
+                    auto w = widest(boxes[i]);
+                    if (w.second > target_channel.second) {
+                        target = i;
+                        target_channel = w;
+                    }
+                }
+                if (target == boxes.size()) {
+                    break;
+                }
+
+                box b = boxes[target];
+                unsigned int ch = target_channel.first;
+                std::sort(entries.begin() + b.begin, entries.begin() + b.end,
+                          [ch](auto const &lhs, auto const &rhs) {
+                              return channel(lhs.first, ch) <
+                                     channel(rhs.first, ch);
+                          });
+
+                std::uint64_t total = 0;
+                for (std::size_t i = b.begin; i < b.end; ++i) {
+                    total += entries[i].second;
+                }
+                std::uint64_t sum = 0;
+                std::size_t mid = b.begin + 1;
+                for (std::size_t i = b.begin; i < b.end - 1; ++i) {
+                    sum += entries[i].second;
+                    mid = i + 1;
+                    if (sum * 2 >= total) {
+                        break;
+                    }
+                }
+
+                boxes[target] = {b.begin, mid};
+                boxes.push_back({mid, b.end});
+            }
+
+            palette result;
+            for (box const &b : boxes) {
+                std::array<std::uint64_t, N_CHANNEL> sums{};
+                std::uint64_t total = 0;
+                for (std::size_t i = b.begin; i < b.end; ++i) {
+                    for (unsigned int ch = 0; ch < N_CHANNEL; ++ch) {
+                        sums[ch] += std::uint64_t{channel(entries[i].first,
+                                                          ch)} *
+                                    entries[i].second;
+                    }
+                    total += entries[i].second;
+                    result.index[entries[i].first] = result.colors.size();
+                }
+
+                std::uint32_t color = 0;
+                for (unsigned int ch = 0; ch < N_CHANNEL; ++ch) {
+                    auto avg =
+                        static_cast<std::uint32_t>((sums[ch] + total / 2) /
+                                                   total);
+                    color |= avg << (color::R_OFFSET - ch * 8);
+                }
+                result.colors.push_back(color);
+            }
+            return result;
+        }
+
+        /* What png::save() hands to libpng, prepared before setjmp() so
+           that no object with a destructor lives across it. */
+        struct png_encoding {
+            int color_type = PNG_COLOR_TYPE_RGBA;
+            std::vector<::png_color> plte;
+            std::vector<::png_byte> trns;
+            /* Palette index of each pixel if COLOR_TYPE is
+               PNG_COLOR_TYPE_PALETTE, empty otherwise. */
+            std::vector<::png_byte> indices;
+        };
+
+        auto encode(::png_const_bytep data, std::size_t n_pixels,
+                    png_color_mode mode) -> png_encoding {
+            png_encoding result;
+            if (mode == png_color_mode::RGBA || n_pixels == 0) {
+                return result;
+            }
+
+            auto histogram = count_colors(
+                data, n_pixels,
+                mode == png_color_mode::QUANTIZE ? n_pixels
+                                                 : MAX_PALETTE_SIZE);
+            palette pal;
+            if (histogram.size() <= MAX_PALETTE_SIZE) {
+                pal = exact_palette(histogram);
+            } else if (mode == png_color_mode::QUANTIZE) {
+                pal = median_cut(histogram, MAX_PALETTE_SIZE);
+            } else {
+                if (is_opaque(data, n_pixels)) {
+                    result.color_type = PNG_COLOR_TYPE_RGB;
+                }
+                return result;
+            }
+            sort_translucent_first(&pal);
+
+            result.color_type = PNG_COLOR_TYPE_PALETTE;
+            result.plte.resize(pal.colors.size());
+            for (std::size_t i = 0; i < pal.colors.size(); ++i) {
+                result.plte[i].red = channel(pal.colors[i], 0);
+                result.plte[i].green = channel(pal.colors[i], 1);
+                result.plte[i].blue = channel(pal.colors[i], 2);
+                if (channel(pal.colors[i], 3) != color::CHAN_FULL) {
+                    result.trns.push_back(channel(pal.colors[i], 3));
+                }
+            }
+
+            result.indices.resize(n_pixels);
+            std::uint32_t last = color_at(data);
+            std::uint8_t last_index = pal.index[last];
+            for (std::size_t i = 0; i < n_pixels; ++i) {
+                std::uint32_t c = color_at(data + i * N_CHANNEL);
+                if (c != last) {
+                    last = c;
+                    last_index = pal.index[c];
+                }
+                result.indices[i] = last_index;
+            }
+            return result;
+        }
+
+        /* Write WIDTH x HEIGHT pixels of RGBA DATA encoded as ENC to F.
+           Only this function calls setjmp(), and it takes nothing that
+           needs to be destroyed or is modified after it. */
+        auto write_png(std::FILE *f, ::png_const_bytep data,
+                       unsigned int width, unsigned int height,
+                       png_encoding const *enc,
+                       png_write_options const *options) -> bool {
+            ::png_structp png = ::png_create_write_struct(
+                PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+            if (png == nullptr) {
+                return false;
+            }
+            ::png_infop info = ::png_create_info_struct(png);
+            if (info == nullptr) {
+                ::png_destroy_write_struct(&png, nullptr);
+                return false;
+            }
+
+            if (setjmp(png_jmpbuf(png))) {
+                ::png_destroy_write_struct(&png, &info);
+                return false;
+            }
+
+            bool const indexed = enc->color_type == PNG_COLOR_TYPE_PALETTE;
+            ::png_set_write_fn(png, f, &write_data, &flush_data);
+            ::png_set_IHDR(png, info, width, height, SUPPORTED_BIT_DEPTH,
+                           enc->color_type, PNG_INTERLACE_NONE,
+                           PNG_COMPRESSION_TYPE_DEFAULT,
+                           PNG_FILTER_TYPE_DEFAULT);
+            ::png_set_sRGB(png, info, PNG_sRGB_INTENT_PERCEPTUAL);
+            if (indexed) {
+                ::png_set_PLTE(png, info, enc->plte.data(),
+                               static_cast<int>(enc->plte.size()));
+                if (!enc->trns.empty()) {
+                    ::png_set_tRNS(png, info, enc->trns.data(),
+                                   static_cast<int>(enc->trns.size()),
+                                   nullptr);
+                }
+            }
+            ::png_set_compression_level(png, options->level);
+            ::png_set_compression_strategy(png, options->strategy);
+            ::png_set_filter(png, PNG_FILTER_TYPE_BASE,
+                             indexed ? PNG_FILTER_NONE : options->filters);
+            ::png_write_info(png, info);
+            if (enc->color_type == PNG_COLOR_TYPE_RGB) {
+                /* Let libpng drop alpha bytes from our RGBA rows. */
+                ::png_set_filler(png, 0, PNG_FILLER_AFTER);
+            }
+
+            for (unsigned int y = 0; y < height; ++y) {
+                if (indexed) {
+                    ::png_write_row(png, enc->indices.data() + y * width);
+                } else {
+                    /* Pixel buffer is already in PNG row layout. */
+                    ::png_write_row(png, data + y * width * N_CHANNEL);
+                }
+            }
+            ::png_write_end(png, nullptr);
+
+            ::png_destroy_write_struct(&png, &info);
+            return true;
+        }
     } // namespace
 
     png::png(int width, int height)
@@ -35,6 +363,9 @@ namespace pixel_terrain::graphics {
         std::fill(data, data + width * height * 4, 0);
     }
 
+    png::png(unsigned int width, unsigned int height, ::png_bytep buffer)
+        : width(width), height(height), data(buffer), owns_data(false) {}
+
     png::png(std::filesystem::path const &path) {
         std::FILE *in = FOPEN(path.c_str(), "rb");
         if (in == nullptr) {
@@ -73,15 +404,16 @@ namespace pixel_terrain::graphics {
             throw err;
         }
 
+        /* Let libpng expand indexed and RGB images. */
+        png.format = PNG_FORMAT_RGBA;
         ::png_uint_32 stride = PNG_IMAGE_ROW_STRIDE(png);
         data = new ::png_byte[png.width * png.height * 4];
 
         width = png.width;
         height = png.height;
 
-        if (png.format == PNG_FORMAT_RGBA) {
-            ::png_image_finish_read(&png, nullptr, data, stride, nullptr);
-        } else {
+        if (::png_image_finish_read(&png, nullptr, data, stride, nullptr) ==
+            0) {
             std::memset(data, 0, png.width * png.height * 4);
         }
 
@@ -89,7 +421,11 @@ namespace pixel_terrain::graphics {
         std::fclose(in);
     }
 
-    png::~png() { delete[] data; }
+    png::~png() {
+        if (owns_data) {
+            delete[] data;
+        }
+    }
 
     void png::fit(unsigned int width, unsigned int height) {
         auto *new_data = new ::png_byte[width * height * 4];
@@ -106,8 +442,11 @@ namespace pixel_terrain::graphics {
         }
         this->width = width;
         this->height = height;
-        delete[] data;
+        if (owns_data) {
+            delete[] data;
+        }
         data = new_data;
+        owns_data = true;
     }
 
     void png::set_pixel(unsigned int x, unsigned int y,
@@ -147,56 +486,50 @@ namespace pixel_terrain::graphics {
         data[++base_off] = 0;
     }
 
-    auto png::save(std::filesystem::path const &path) -> bool {
-        std::FILE *f = FOPEN(path.c_str(), "wb");
-        if (f == nullptr) {
-            return false;
+    auto png_write_options::fast() -> png_write_options {
+        png_write_options result;
+        result.level = Z_BEST_SPEED;
+        result.filters = PNG_FILTER_SUB | PNG_FILTER_UP;
+        return result;
+    }
+
+    auto png_write_options::max() -> png_write_options {
+        png_write_options result;
+        result.level = Z_BEST_COMPRESSION;
+        return result;
+    }
+
+    auto png_write_options::preset(std::string_view name)
+        -> std::optional<png_write_options> {
+        if (name == "default") {
+            return png_write_options();
         }
+        if (name == "fast") {
+            return fast();
+        }
+        if (name == "max") {
+            return max();
+        }
+        return std::nullopt;
+    }
 
-        ::png_image png;
-        std::memset(&png, 0, sizeof(::png_image));
-        png.version = PNG_IMAGE_VERSION;
-        png.width = width;
-        png.height = height;
-        png.format = PNG_FORMAT_RGBA;
-        ::png_uint_32 stride = PNG_IMAGE_ROW_STRIDE(png);
+    /* Rows are written with our own I/O functions rather than
+       png_init_io(), since libpng may not share the C runtime with us on
+       Windows. */
+    auto png::save(std::filesystem::path const &path,
+                   png_write_options const &options) -> bool {
+        png_encoding enc = encode(
+            data, static_cast<std::size_t>(width) * height, options.color_mode);
 
-#if defined(OS_WIN)
-        /* XXX   Same as its reader function.
-           We write the data to memory once, then write to file. */
-        int result;
-        /* First we try 512 KiB because it's large enough in
-           almost all cases. */
-        ::png_alloc_size_t mem_size = 1024 * 512;
-        std::uint8_t *out = nullptr;
-        do {
-            delete[] out;
-            out = new std::uint8_t[mem_size];
-            /* png_image_write_to_memory writes required memory size to
-               `mem_size` even if the invocation fails. We allocate sifficient
-               memory later, in case the function fails. */
-            result = ::png_image_write_to_memory(&png, out, &mem_size, 0, data,
-                                                 stride, nullptr);
-        } while (!static_cast<bool>(result));
-        std::size_t n = std::fwrite(out, 1, mem_size, f);
-        if (n != mem_size) {
-            delete[] out;
+        std::FILE *f = FOPEN(path.c_str(), "wb");
+        if (f == nullptr) {
             return false;
         }
-        delete[] out;
-#else  // not defined(OS_WIN)
-        if (::png_image_write_to_stdio(&png, f, 0, data, stride, nullptr) ==
-            0) {
-            ::png_image_free(&png);
+        if (!write_png(f, data, width, height, &enc, &options)) {
             std::fclose(f);
             return false;
         }
-#endif // defined(OS_WIN)
-
-        ::png_image_free(&png);
-        std::fclose(f);
-
-        return true;
+        return std::fclose(f) == 0;
     }
 
     auto png::save() -> bool {
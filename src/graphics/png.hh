@@ -5,32 +5,71 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <string_view>
 
 #include <png.h>
+#include <zlib.h>
 
 #include "utils/path_hack.hh"
 
 namespace pixel_terrain::graphics {
+    enum class png_color_mode {
+        /* Always write 32-bit RGBA. */
+        RGBA,
+        /* Write 8-bit indexed color if the image has at most 256 colors,
+           24-bit RGB if it is opaque, and RGBA otherwise. Lossless. */
+        AUTO,
+        /* Same as AUTO, but reduce images with more than 256 colors to
+           256 by median cut. Lossy. */
+        QUANTIZE,
+    };
+
+    /* Encoder settings for png::save. LEVEL and STRATEGY are passed to
+       zlib; FILTERS is a mask of PNG_FILTER_* values, and is ignored for
+       indexed color. */
+    struct png_write_options {
+        int level = Z_DEFAULT_COMPRESSION;
+        int filters = PNG_ALL_FILTERS;
+        int strategy = Z_FILTERED;
+        png_color_mode color_mode = png_color_mode::RGBA;
+
+        /* Level 1 with Sub and Up filters, for frequent re-renders. */
+        static auto fast() -> png_write_options;
+        /* Level 9 with all filters, for archival. */
+        static auto max() -> png_write_options;
+        /* Preset named NAME: "default", "fast" or "max". */
+        static auto preset(std::string_view name)
+            -> std::optional<png_write_options>;
+    };
+
     class png {
         unsigned int width;
         unsigned int height;
         std::filesystem::path path;
         ::png_bytep data;
+        bool owns_data = true;
 
     public:
         png(int width, int height);
+        /* Use BUFFER of WIDTH x HEIGHT RGBA pixels in place, without
+           taking ownership. */
+        png(unsigned int width, unsigned int height, ::png_bytep buffer);
         png(std::filesystem::path const &path);
         ~png();
 
         [[nodiscard]] auto get_width() const -> unsigned int;
         [[nodiscard]] auto get_height() const -> unsigned int;
+        /* RGBA pixels, 4 * width bytes per row. */
+        [[nodiscard]] auto get_data() -> ::png_bytep { return data; }
         void fit(unsigned int width, unsigned int height);
         void set_pixel(unsigned int x, unsigned int y,
                        std::uint_fast32_t color);
         auto get_pixel(int x, int y) -> std::uint_fast32_t;
         void clear(int x, int y);
-        auto save(std::filesystem::path const &path) -> bool;
+        auto save(std::filesystem::path const &path,
+                  png_write_options const &options = {}) -> bool;
         auto save() -> bool;
     };
 } // namespace pixel_terrain::graphics
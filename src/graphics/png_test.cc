@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "graphics/png.hh"
+
+using namespace pixel_terrain::graphics;
+
+namespace {
+    constexpr int size = 64;
+
+    auto temp_path(std::string const &name) -> std::filesystem::path {
+        return std::filesystem::temp_directory_path() /
+               ("pixel_terrain_png_test_" + name + ".png");
+    }
+
+    /* Color type field of IHDR chunk. */
+    auto color_type_of(std::filesystem::path const &path) -> int {
+        constexpr std::size_t color_type_off = 25;
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(color_type_off);
+        return in.get();
+    }
+
+    void fill(png &image, std::uint32_t (*color)(int, int)) {
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                image.set_pixel(x, y, color(x, y));
+            }
+        }
+    }
+
+    auto round_trip(png &image, png_color_mode mode, std::string const &name,
+                    int *color_type) -> png * {
+        png_write_options options;
+        options.color_mode = mode;
+        auto path = temp_path(name);
+        BOOST_REQUIRE(image.save(path, options));
+        *color_type = color_type_of(path);
+        auto *result = new png(path);
+        std::filesystem::remove(path);
+        return result;
+    }
+
+    auto same_pixels(png &a, png &b) -> bool {
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                if (a.get_pixel(x, y) != b.get_pixel(x, y)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /* Few colors, some translucent. */
+    auto few_colors(int x, int y) -> std::uint32_t {
+        return 0x10203000 | ((x / 8 + y / 8) % 4 * 0x40 + 0x3f);
+    }
+
+    /* Many opaque colors. */
+    auto many_opaque(int x, int y) -> std::uint32_t {
+        return (x * 4) << 24 | (y * 4) << 16 | 0x80ff;
+    }
+
+    /* Many colors, some translucent. */
+    auto many_translucent(int x, int y) -> std::uint32_t {
+        return (x * 4) << 24 | (y * 4) << 16 | 0x8000 | (y < 8 ? 0x80 : 0xff);
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(png_rgba) {
+    png image(size, size);
+    fill(image, many_translucent);
+    int color_type;
+    png *read = round_trip(image, png_color_mode::RGBA, "rgba", &color_type);
+    BOOST_TEST(color_type == PNG_COLOR_TYPE_RGBA);
+    BOOST_TEST(same_pixels(image, *read));
+    delete read;
+}
+
+BOOST_AUTO_TEST_CASE(png_auto_indexed) {
+    png image(size, size);
+    fill(image, few_colors);
+    int color_type;
+    png *read = round_trip(image, png_color_mode::AUTO, "indexed", &color_type);
+    BOOST_TEST(color_type == PNG_COLOR_TYPE_PALETTE);
+    BOOST_TEST(same_pixels(image, *read));
+    delete read;
+}
+
+BOOST_AUTO_TEST_CASE(png_auto_rgb) {
+    png image(size, size);
+    fill(image, many_opaque);
+    int color_type;
+    png *read = round_trip(image, png_color_mode::AUTO, "rgb", &color_type);
+    BOOST_TEST(color_type == PNG_COLOR_TYPE_RGB);
+    BOOST_TEST(same_pixels(image, *read));
+    delete read;
+}
+
+BOOST_AUTO_TEST_CASE(png_auto_translucent) {
+    png image(size, size);
+    fill(image, many_translucent);
+    int color_type;
+    png *read =
+        round_trip(image, png_color_mode::AUTO, "translucent", &color_type);
+    BOOST_TEST(color_type == PNG_COLOR_TYPE_RGBA);
+    BOOST_TEST(same_pixels(image, *read));
+    delete read;
+}
+
+BOOST_AUTO_TEST_CASE(png_quantize) {
+    png image(size, size);
+    fill(image, many_translucent);
+    int color_type;
+    png *read =
+        round_trip(image, png_color_mode::QUANTIZE, "quantize", &color_type);
+    BOOST_TEST(color_type == PNG_COLOR_TYPE_PALETTE);
+
+    std::set<std::uint32_t> colors;
+    int max_diff = 0;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            std::uint32_t a = image.get_pixel(x, y);
+            std::uint32_t b = read->get_pixel(x, y);
+            colors.insert(b);
+            for (int shift = 0; shift < 32; shift += 8) {
+                int diff = static_cast<int>((a >> shift) & 0xff) -
+                           static_cast<int>((b >> shift) & 0xff);
+                max_diff = std::max(max_diff, std::abs(diff));
+            }
+        }
+    }
+    BOOST_TEST(colors.size() <= 256);
+    /* 4096 colors in 256 boxes are about 4x4 gradient steps each; allow
+       some slack for uneven splits. */
+    BOOST_TEST(max_diff <= 32);
+    delete read;
+}
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: MIT
+
+/* Image resampling for zoomed-out tiles.
+   Blocks of fully opaque pixels, which make up most of a map, are
+   averaged with SSE2 where available; others go through the alpha
+   weighted path, which gives the same result for opaque pixels. */
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2 1
+#else
+#define USE_SSE2 0
+#endif
+
+#include "graphics/resample.hh"
+
+namespace pixel_terrain::graphics {
+    namespace {
+        constexpr unsigned int N_CHANNEL = 4;
+        constexpr unsigned int ALPHA = 3;
+
+        /* Average 2x2 pixels whose top-left is at TOP and BOTTOM. */
+        void average_weighted(std::uint8_t const *top,
+                              std::uint8_t const *bottom, std::uint8_t *out) {
+            std::uint8_t const *px[4] = {top, top + N_CHANNEL, bottom,
+                                         bottom + N_CHANNEL};
+
+            std::uint32_t alpha_sum = 0;
+            for (std::uint8_t const *p : px) {
+                alpha_sum += p[ALPHA];
+            }
+            if (alpha_sum == 0) {
+                for (unsigned int ch = 0; ch < N_CHANNEL; ++ch) {
+                    out[ch] = 0;
+                }
+                return;
+            }
+
+            for (unsigned int ch = 0; ch < ALPHA; ++ch) {
+                std::uint32_t sum = 0;
+                for (std::uint8_t const *p : px) {
+                    sum += std::uint32_t{p[ch]} * p[ALPHA];
+                }
+                out[ch] = (sum + alpha_sum / 2) / alpha_sum;
+            }
+            out[ALPHA] = (alpha_sum + 2) / 4;
+        }
+
+#if USE_SSE2
+        /* Sum horizontally adjacent pixels in 16-bit lanes of A (two
+           pixels) and B (two pixels), giving two pixels. */
+        auto pair_sum(__m128i a, __m128i b) -> __m128i {
+            __m128i sa = _mm_add_epi16(a, _mm_srli_si128(a, 8));
+            __m128i sb = _mm_add_epi16(b, _mm_srli_si128(b, 8));
+            return _mm_unpacklo_epi64(sa, sb);
+        }
+
+        /* Average 2x2 blocks of 4 output pixels from 8 input pixels of each
+           row, if all of them are opaque. */
+        auto average_opaque_4(std::uint8_t const *top,
+                              std::uint8_t const *bottom, std::uint8_t *out)
+            -> bool {
+            __m128i t0 =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(top));
+            __m128i t1 =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(top + 16));
+            __m128i b0 =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(bottom));
+            __m128i b1 =
+                _mm_loadu_si128(reinterpret_cast<__m128i const *>(bottom + 16));
+
+            __m128i all = _mm_and_si128(_mm_and_si128(t0, t1),
+                                        _mm_and_si128(b0, b1));
+            constexpr int alpha_bits = 0x8888;
+            int opaque =
+                _mm_movemask_epi8(_mm_cmpeq_epi8(all, _mm_set1_epi8(-1)));
+            if ((opaque & alpha_bits) != alpha_bits) {
+                return false;
+            }
+
+            __m128i zero = _mm_setzero_si128();
+            __m128i v0 = _mm_add_epi16(_mm_unpacklo_epi8(t0, zero),
+                                       _mm_unpacklo_epi8(b0, zero));
+            __m128i v1 = _mm_add_epi16(_mm_unpackhi_epi8(t0, zero),
+                                       _mm_unpackhi_epi8(b0, zero));
+            __m128i v2 = _mm_add_epi16(_mm_unpacklo_epi8(t1, zero),
+                                       _mm_unpacklo_epi8(b1, zero));
+            __m128i v3 = _mm_add_epi16(_mm_unpackhi_epi8(t1, zero),
+                                       _mm_unpackhi_epi8(b1, zero));
+
+            __m128i rounding = _mm_set1_epi16(2);
+            __m128i lo = _mm_srli_epi16(
+                _mm_add_epi16(pair_sum(v0, v1), rounding), 2);
+            __m128i hi = _mm_srli_epi16(
+                _mm_add_epi16(pair_sum(v2, v3), rounding), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                             _mm_packus_epi16(lo, hi));
+            return true;
+        }
+#endif
+    } // namespace
+
+    void downsample_half(std::uint8_t const *src, std::size_t src_stride,
+                         unsigned int width, unsigned int height,
+                         std::uint8_t *dst, std::size_t dst_stride) {
+        unsigned int out_width = width / 2;
+        unsigned int out_height = height / 2;
+
+        for (unsigned int y = 0; y < out_height; ++y) {
+            std::uint8_t const *top = src + 2 * y * src_stride;
+            std::uint8_t const *bottom = top + src_stride;
+            std::uint8_t *out = dst + y * dst_stride;
+
+            unsigned int x = 0;
+#if USE_SSE2
+            constexpr unsigned int block = 4;
+            for (; x + block <= out_width; x += block) {
+                std::size_t in_off = 2 * x * N_CHANNEL;
+                if (average_opaque_4(top + in_off, bottom + in_off,
+                                     out + x * N_CHANNEL)) {
+                    continue;
+                }
+                for (unsigned int i = x; i < x + block; ++i) {
+                    average_weighted(top + 2 * i * N_CHANNEL,
+                                     bottom + 2 * i * N_CHANNEL,
+                                     out + i * N_CHANNEL);
+                }
+            }
+#endif
+            for (; x < out_width; ++x) {
+                average_weighted(top + 2 * x * N_CHANNEL,
+                                 bottom + 2 * x * N_CHANNEL,
+                                 out + x * N_CHANNEL);
+            }
+        }
+    }
+} // namespace pixel_terrain::graphics
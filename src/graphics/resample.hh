@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef GRAPHICS_RESAMPLE_HH
+#define GRAPHICS_RESAMPLE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pixel_terrain::graphics {
+    /* Shrink WIDTH x HEIGHT RGBA pixels at SRC to half size into DST with
+       2x2 box filter. Colors are weighted by alpha, so that transparent
+       pixels do not darken edges. Strides are in bytes. */
+    void downsample_half(std::uint8_t const *src, std::size_t src_stride,
+                         unsigned int width, unsigned int height,
+                         std::uint8_t *dst, std::size_t dst_stride);
+} // namespace pixel_terrain::graphics
+
+#endif
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "graphics/resample.hh"
+
+using namespace pixel_terrain::graphics;
+
+namespace {
+    auto downsample(std::vector<std::uint8_t> const &src, unsigned int width,
+                    unsigned int height) -> std::vector<std::uint8_t> {
+        std::vector<std::uint8_t> result(width / 2 * height / 2 * 4);
+        downsample_half(src.data(), width * 4, width, height, result.data(),
+                        width / 2 * 4);
+        return result;
+    }
+
+    /* Straightforward alpha weighted 2x2 average. */
+    auto reference(std::vector<std::uint8_t> const &src, unsigned int width,
+                   unsigned int height) -> std::vector<std::uint8_t> {
+        std::vector<std::uint8_t> result(width / 2 * height / 2 * 4);
+        for (unsigned int y = 0; y < height / 2; ++y) {
+            for (unsigned int x = 0; x < width / 2; ++x) {
+                unsigned int alpha = 0;
+                unsigned int sums[3] = {0, 0, 0};
+                for (unsigned int i = 0; i < 4; ++i) {
+                    std::uint8_t const *p =
+                        &src[((2 * y + i / 2) * width + 2 * x + i % 2) * 4];
+                    alpha += p[3];
+                    for (int ch = 0; ch < 3; ++ch) {
+                        sums[ch] += p[ch] * p[3];
+                    }
+                }
+                std::uint8_t *out = &result[(y * width / 2 + x) * 4];
+                for (int ch = 0; ch < 3; ++ch) {
+                    out[ch] = alpha == 0 ? 0 : (sums[ch] + alpha / 2) / alpha;
+                }
+                out[3] = (alpha + 2) / 4;
+            }
+        }
+        return result;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(downsample_opaque) {
+    constexpr unsigned int width = 64;
+    constexpr unsigned int height = 8;
+    std::mt19937 rng(1);
+    std::vector<std::uint8_t> src(width * height * 4);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = i % 4 == 3 ? 255 : rng() & 0xff;
+    }
+    BOOST_TEST(downsample(src, width, height) == reference(src, width, height));
+}
+
+BOOST_AUTO_TEST_CASE(downsample_translucent) {
+    /* Odd width in output leaves a tail for the scalar loop. */
+    constexpr unsigned int width = 46;
+    constexpr unsigned int height = 6;
+    std::mt19937 rng(2);
+    std::vector<std::uint8_t> src(width * height * 4);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = rng() & 0xff;
+        if (i % 4 == 3 && (i / 4) % 3 != 0) {
+            src[i] = 255;
+        }
+    }
+    BOOST_TEST(downsample(src, width, height) == reference(src, width, height));
+}
+
+BOOST_AUTO_TEST_CASE(downsample_transparent_edge) {
+    /* Opaque white next to transparent black stays white. */
+    std::vector<std::uint8_t> src = {
+        255, 255, 255, 255, 0, 0, 0, 0, //
+        255, 255, 255, 255, 0, 0, 0, 0,
+    };
+    std::vector<std::uint8_t> expected = {255, 255, 255, 128};
+    BOOST_TEST(downsample(src, 2, 2) == expected);
+
+    std::vector<std::uint8_t> clear(16, 0);
+    BOOST_TEST(downsample(clear, 2, 2) == std::vector<std::uint8_t>(4, 0));
+}
@@ -5,19 +5,41 @@
 
 #include <cstdint>
 #include <cstring>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 
 #include "block_colors_data.hh"
+#include "graphics/color.hh"
 #include "image/blocks.hh"
+#include "nbt/xxhash.hh"
 
 namespace pixel_terrain::image {
     namespace {
-        using block_color_map =
-            std::unordered_map<std::string_view, std::uint32_t>;
-    }
+        auto is_air(std::string_view block) -> bool {
+            return block == "minecraft:air" || block == "minecraft:cave_air" ||
+                   block == "minecraft:void_air";
+        }
+
+        /* Which biome color BLOCK is tinted with, given that it is biome
+           overridden. */
+        auto tint_flags(std::string_view block) -> std::uint8_t {
+            if (block == "minecraft:water" ||
+                block == "minecraft:bubble_column") {
+                return block_info::TINT_WATER;
+            }
+            if (block.find("leaves") != std::string_view::npos ||
+                block == "minecraft:vine") {
+                return block_info::TINT_FOLIAGE;
+            }
+            return 0;
+        }
+    } // namespace
+
+    block_registry::block_registry() {
+        insert("minecraft:air", 0, true);
 
-    auto init_block_list() -> block_color_map {
-        block_color_map result;
         std::size_t off = 0;
         for (;;) {
             auto len = static_cast<std::size_t>(block_colors_data[off]);
@@ -32,18 +54,68 @@ namespace pixel_terrain::image {
             off += 1 + static_cast<std::size_t>(block_colors_data[off]);
             std::uint32_t color;
             std::memcpy(&color, block_colors_data + off, sizeof(std::uint32_t));
-            result[block_name] = color;
+            if (auto itr = ids_.find(block_name); itr != ids_.end()) {
+                infos_[itr->second].color = color;
+            } else {
+                insert(block_name, color, true);
+            }
             off += 4;
         }
+    }
+
+    auto block_registry::insert(std::string_view name, std::uint32_t color,
+                                bool known) -> block_info {
+        block_info info;
+        info.id = static_cast<block_id>(infos_.size());
+        info.color = color;
+        if (!known) {
+            info.flags |= block_info::UNKNOWN;
+        } else if (is_air(name)) {
+            info.flags |= block_info::AIR;
+        } else {
+            if (is_biome_overridden(name)) {
+                info.flags |= block_info::BIOME_OVERRIDDEN | tint_flags(name);
+            }
+            if (graphics::alpha(color) == graphics::color::CHAN_FULL) {
+                info.flags |= block_info::OPAQUE;
+            }
+        }
 
-        return result;
+        std::string const &stored = names_.emplace_back(name);
+        ids_.emplace(stored, info.id);
+        infos_.push_back(info);
+        return info;
     }
 
-    block_color_map colors = init_block_list();
+    auto block_registry::intern(std::string_view name) -> block_info {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            if (auto itr = ids_.find(name); itr != ids_.end()) {
+                return infos_[itr->second];
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        /* Another thread may have interned it while unlocked. */
+        if (auto itr = ids_.find(name); itr != ids_.end()) {
+            return infos_[itr->second];
+        }
+        return insert(name, 0, is_air(name));
+    }
+
+    auto block_registry::info(block_id id) const -> block_info {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return infos_[id];
+    }
+
+    auto block_registry::name(block_id id) const -> std::string {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return names_[id];
+    }
 
-    auto is_biome_overridden(std::string const &block) -> bool {
-        using namespace std::string_literals;
+    block_registry block_ids;
 
+    auto is_biome_overridden(std::string_view block) -> bool {
         /* first, check if block is water or grass_block because the most
          * blocks are one of them. */
         if (block == "minecraft:water" || block == "minecraft:grass_block") {
@@ -58,7 +130,7 @@ namespace pixel_terrain::image {
         }
 
         /* next, check if block is leaf-family. */
-        if (block.find("leaves") != std::string::npos) {
+        if (block.find("leaves") != std::string_view::npos) {
             return true;
         }
 
@@ -70,4 +142,15 @@ namespace pixel_terrain::image {
 
         return false;
     }
+
+    auto color_table_version() -> std::uint32_t {
+        /* Bump this when colors are derived from the table differently,
+           e.g. when biome color rules change. */
+        constexpr std::uint64_t color_rules_revision = 3;
+
+        static std::uint32_t const version = static_cast<std::uint32_t>(
+            nbt::utils::xxhash64(block_colors_data, sizeof(block_colors_data),
+                                 color_rules_revision));
+        return version;
+    }
 } // namespace pixel_terrain::image
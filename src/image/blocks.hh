@@ -3,15 +3,67 @@
 #ifndef BLOCKS_HH
 #define BLOCKS_HH
 
-#include <array>
 #include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace pixel_terrain::image {
-    extern std::unordered_map<std::string_view, std::uint32_t> colors;
+    using block_id = std::uint32_t;
 
-    auto is_biome_overridden(std::string const &block) -> bool;
+    /* Per-block attributes, computed once when the block is interned. */
+    struct block_info {
+        static constexpr std::uint8_t AIR = 1;
+        static constexpr std::uint8_t BIOME_OVERRIDDEN = 1 << 1;
+        static constexpr std::uint8_t OPAQUE = 1 << 2;
+        static constexpr std::uint8_t UNKNOWN = 1 << 3;
+        /* Biome color of BIOME_OVERRIDDEN blocks, grass if neither. */
+        static constexpr std::uint8_t TINT_FOLIAGE = 1 << 4;
+        static constexpr std::uint8_t TINT_WATER = 1 << 5;
+
+        block_id id = 0;
+        std::uint32_t color = 0;
+        std::uint8_t flags = 0;
+
+        [[nodiscard]] auto has(std::uint8_t flag) const -> bool {
+            return (flags & flag) != 0;
+        }
+    };
+
+    /* Thread-safe table assigning a small integer ID to each block name.
+       Seeded from the embedded block color data; blocks not listed there
+       are interned on first use and marked as UNKNOWN. */
+    class block_registry {
+        mutable std::shared_mutex mutex_;
+        std::deque<std::string> names_;
+        std::unordered_map<std::string_view, block_id> ids_;
+        std::vector<block_info> infos_;
+
+        auto insert(std::string_view name, std::uint32_t color,
+                    bool known) -> block_info;
+
+    public:
+        /* ID of minecraft:air, which is always interned first. */
+        static constexpr block_id AIR_ID = 0;
+
+        block_registry();
+
+        auto intern(std::string_view name) -> block_info;
+
+        [[nodiscard]] auto info(block_id id) const -> block_info;
+
+        [[nodiscard]] auto name(block_id id) const -> std::string;
+    };
+
+    extern block_registry block_ids;
+
+    auto is_biome_overridden(std::string_view block) -> bool;
+
+    /* Changes whenever the embedded block color data changes. */
+    auto color_table_version() -> std::uint32_t;
 } // namespace pixel_terrain::image
 
 #endif
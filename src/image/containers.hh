@@ -3,12 +3,24 @@
 #ifndef CONTAINERS_HH
 #define CONTAINERS_HH
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <mutex>
 #include <thread>
 
+#include "graphics/png.hh"
+#include "image/edges.hh"
+#include "image/planes.hh"
 #include "logger/logger.hh"
 #include "nbt/chunk.hh"
+#include "nbt/file.hh"
 #include "nbt/region.hh"
+#include "nbt/xxhash.hh"
 #include "utils/path_hack.hh"
 
 namespace pixel_terrain::image {
@@ -20,8 +32,17 @@ namespace pixel_terrain::image {
         std::string label_;
         std::filesystem::path cache_dir_;
         std::string outname_format_;
+        bool split_regions_;
+        graphics::png_write_options png_options_;
+        bool raw_cache_;
+        unsigned int zoom_levels_;
+        std::filesystem::path manifest_path_;
+        unsigned int biome_blend_;
 
     public:
+        /* Largest biome blend radius, which is the game's 15x15. */
+        static constexpr unsigned int MAX_BIOME_BLEND = 7;
+
         options() { clear(); }
 
         void clear() {
@@ -30,6 +51,12 @@ namespace pixel_terrain::image {
             is_nether_ = false;
             cache_dir_.clear();
             outname_format_.clear();
+            split_regions_ = false;
+            png_options_ = graphics::png_write_options();
+            raw_cache_ = false;
+            zoom_levels_ = 0;
+            manifest_path_.clear();
+            biome_blend_ = 0;
         }
 
         void set_out_path(std::filesystem::path const &p) {
@@ -86,6 +113,62 @@ namespace pixel_terrain::image {
         [[nodiscard]] auto outname_format() const -> std::string const & {
             return outname_format_;
         }
+
+        void set_split_regions(bool split) { split_regions_ = split; }
+
+        /* If true, chunks of a region are rendered as separate jobs. */
+        [[nodiscard]] auto split_regions() const -> bool {
+            return split_regions_;
+        }
+
+        void set_png_options(graphics::png_write_options const &options) {
+            png_options_ = options;
+        }
+
+        [[nodiscard]] auto png_options() const
+            -> graphics::png_write_options const & {
+            return png_options_;
+        }
+
+        void set_raw_cache(bool raw_cache) { raw_cache_ = raw_cache; }
+
+        /* If true, keep uncompressed copy of output images in the cache
+           directory, so that incremental updates need not decode PNG. */
+        [[nodiscard]] auto raw_cache() const -> bool { return raw_cache_; }
+
+        void set_zoom_levels(unsigned int levels) { zoom_levels_ = levels; }
+
+        /* Number of zoomed-out levels to build above region images. */
+        [[nodiscard]] auto zoom_levels() const -> unsigned int {
+            return zoom_levels_;
+        }
+
+        void set_manifest_path(std::filesystem::path const &path) {
+            manifest_path_ = path;
+        }
+
+        /* File to list written images in, or empty. */
+        [[nodiscard]] auto manifest_path() const
+            -> std::filesystem::path const & {
+            return manifest_path_;
+        }
+
+        void set_biome_blend(unsigned int radius) { biome_blend_ = radius; }
+
+        /* Radius of the square biome colors are averaged over, or 0 to
+           only overlay a few biomes' colors on their own blocks. */
+        [[nodiscard]] auto biome_blend() const -> unsigned int {
+            return biome_blend_;
+        }
+
+        /* Hash of options that affect rendered pixels, used to invalidate
+           cached chunks when they change. */
+        [[nodiscard]] auto render_fingerprint() const -> std::uint64_t {
+            std::array<std::uint8_t, 2> key = {
+                static_cast<std::uint8_t>(is_nether_),
+                static_cast<std::uint8_t>(biome_blend_)};
+            return nbt::utils::xxhash64(key.data(), key.size());
+        }
     };
 
     class region_container {
@@ -93,12 +176,41 @@ namespace pixel_terrain::image {
         options options_;
         std::filesystem::path out_file_;
 
+        /* Used when chunks are rendered as separate jobs. */
+        std::mutex image_mutex_;
+        graphics::png *image_ = nullptr;
+        std::atomic<int> remaining_chunks_ = 0;
+
+        /* Mapped raw cache backing image, if any. */
+        file<unsigned char> *raw_cache_ = nullptr;
+        bool saved_ = false;
+        bool has_coords_ = false;
+        int region_x_ = 0;
+        int region_z_ = 0;
+
+        /* Chunks redrawn in this run, for the manifest. */
+        mutable std::mutex dirty_mutex_;
+        std::bitset<CHUNKS_PER_REGION> dirty_chunks_;
+        std::chrono::steady_clock::time_point start_time_;
+
+        /* Chunks scanned so far, shaded when all of them are scanned. */
+        region_planes *planes_ = nullptr;
+        edge_cache *edge_cache_ = nullptr;
+        bool render_all_ = false;
+        std::bitset<CHUNKS_PER_REGION> forced_chunks_;
+
     public:
         region_container(anvil::region *region, options options,
                          std::filesystem::path out_file)
             : region_(region), options_(std::move(options)),
               out_file_(std::move(out_file)) {}
-        ~region_container() { delete region_; }
+        ~region_container() {
+            delete image_;
+            delete raw_cache_;
+            delete planes_;
+            delete edge_cache_;
+            delete region_;
+        }
 
         [[nodiscard]] auto get_region() -> anvil::region * { return region_; }
 
@@ -110,6 +222,104 @@ namespace pixel_terrain::image {
         [[nodiscard]] auto get_options() const -> options const * {
             return &options_;
         }
+
+        [[nodiscard]] auto image_mutex() -> std::mutex & {
+            return image_mutex_;
+        }
+
+        [[nodiscard]] auto image() const -> graphics::png * { return image_; }
+
+        void set_image(graphics::png *image) { image_ = image; }
+
+        [[nodiscard]] auto raw_cache() const -> file<unsigned char> * {
+            return raw_cache_;
+        }
+
+        void set_raw_cache(file<unsigned char> *raw_cache) {
+            raw_cache_ = raw_cache;
+        }
+
+        void set_coords(int x, int z) {
+            has_coords_ = true;
+            region_x_ = x;
+            region_z_ = z;
+        }
+
+        /* Region coordinates, if known from the input filename. */
+        [[nodiscard]] auto has_coords() const -> bool { return has_coords_; }
+        [[nodiscard]] auto region_x() const -> int { return region_x_; }
+        [[nodiscard]] auto region_z() const -> int { return region_z_; }
+
+        /* True if the output image was written in this run. */
+        [[nodiscard]] auto saved() const -> bool { return saved_; }
+
+        void set_saved() { saved_ = true; }
+
+        void add_dirty_chunk(int chunk_x, int chunk_z) {
+            std::unique_lock<std::mutex> lock(dirty_mutex_);
+            dirty_chunks_.set(region_planes::chunk_index(chunk_x, chunk_z));
+        }
+
+        /* Indexed by region_planes::chunk_index(). */
+        [[nodiscard]] auto dirty_chunks() const
+            -> std::bitset<CHUNKS_PER_REGION> {
+            std::unique_lock<std::mutex> lock(dirty_mutex_);
+            return dirty_chunks_;
+        }
+
+        void start_timer() { start_time_ = std::chrono::steady_clock::now(); }
+
+        [[nodiscard]] auto elapsed_ms() const -> double {
+            return std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start_time_)
+                .count();
+        }
+
+        [[nodiscard]] auto planes() const -> region_planes * {
+            return planes_;
+        }
+
+        void set_planes(region_planes *planes) { planes_ = planes; }
+
+        [[nodiscard]] auto get_edge_cache() const -> edge_cache * {
+            return edge_cache_;
+        }
+
+        void set_edge_cache(edge_cache *cache) { edge_cache_ = cache; }
+
+        /* If true, chunks are rendered whether changed or not. */
+        [[nodiscard]] auto render_all() const -> bool { return render_all_; }
+
+        void set_render_all(bool render_all) { render_all_ = render_all; }
+
+        /* If any chunk is forced, only forced chunks are rendered, whether
+           changed or not. */
+        void force_chunk(int chunk_x, int chunk_z) {
+            forced_chunks_.set(region_planes::chunk_index(chunk_x, chunk_z));
+        }
+
+        [[nodiscard]] auto has_forced_chunks() const -> bool {
+            return forced_chunks_.any();
+        }
+
+        [[nodiscard]] auto is_forced_chunk(int chunk_x, int chunk_z) const
+            -> bool {
+            return forced_chunks_.test(
+                region_planes::chunk_index(chunk_x, chunk_z));
+        }
+
+        void set_remaining_chunks(int n) { remaining_chunks_ = n; }
+
+        /* Mark one chunk job done. Returns true for the last one. */
+        auto finish_chunk() -> bool { return --remaining_chunks_ == 0; }
+    };
+
+    /* Unit of work queued to the thread pool: a whole region, or a single
+       chunk of it if CHUNK_X and CHUNK_Z are not negative. */
+    struct region_job {
+        region_container *item = nullptr;
+        int chunk_x = -1;
+        int chunk_z = -1;
     };
 } // namespace pixel_terrain::image
 
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+
+/* Height borders of regions, for slope shading across chunk and region
+   borders. */
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+
+#include "image/edges.hh"
+#include "image/utils.hh"
+#include "utils/path_hack.hh"
+
+namespace pixel_terrain::image {
+    edge_cache::edge_cache(std::filesystem::path const &cache_dir, int x,
+                           int z) {
+        std::filesystem::path p = path(cache_dir, x, z);
+
+        std::error_code ec;
+        auto size = std::filesystem::file_size(p, ec);
+        if (ec || size != sizeof(layout)) {
+            std::filesystem::remove(p, ec);
+        }
+
+        file_ = new file<layout>(p, 1, "r+");
+        data_ = file_->get_raw_data();
+        if (data_->magic != layout::MAGIC ||
+            data_->version != layout::VERSION) {
+            fresh_ = true;
+            data_->magic = layout::MAGIC;
+            data_->version = layout::VERSION;
+            data_->reserved = 0;
+            for (region_edge &e : data_->columns) {
+                e.fill(UNKNOWN_HEIGHT);
+            }
+            for (region_edge &e : data_->rows) {
+                e.fill(UNKNOWN_HEIGHT);
+            }
+            data_->west_used.fill(UNKNOWN_HEIGHT);
+            data_->north_used.fill(UNKNOWN_HEIGHT);
+        }
+    }
+
+    edge_cache::~edge_cache() { delete file_; }
+
+    auto edge_cache::path(std::filesystem::path const &cache_dir, int x,
+                          int z) -> std::filesystem::path {
+        path_string name =
+            format_output_name("r.%X.%Z", x, z) + PATH_STR_LITERAL(".ptedge");
+        return cache_dir / name;
+    }
+
+    auto edge_cache::read(std::filesystem::path const &cache_dir, int x,
+                          int z) -> std::optional<region_edges> {
+        std::ifstream in(path(cache_dir, x, z), std::ios::binary);
+        layout data;
+        if (!in.read(reinterpret_cast<char *>(&data), sizeof(data)) ||
+            data.magic != layout::MAGIC || data.version != layout::VERSION) {
+            return std::nullopt;
+        }
+
+        return edges_of(data);
+    }
+
+    auto edge_cache::edges_of(layout const &data) -> region_edges {
+        region_edges result;
+        result.east = data.columns.back();
+        result.south = data.rows.back();
+        result.west_used = data.west_used;
+        result.north_used = data.north_used;
+        return result;
+    }
+
+    void edge_exchange::publish(key const &k, region_edges const &edges) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        published_.insert_or_assign(k, edges);
+    }
+
+    auto edge_exchange::find(key const &k) const
+        -> std::optional<region_edges> {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto itr = published_.find(k);
+        if (itr == published_.end()) {
+            return std::nullopt;
+        }
+        return itr->second;
+    }
+} // namespace pixel_terrain::image
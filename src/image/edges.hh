@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef EDGES_HH
+#define EDGES_HH
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <tuple>
+
+#include "image/planes.hh"
+#include "nbt/constants.hh"
+#include "nbt/file.hh"
+
+namespace pixel_terrain::image {
+    using region_edge =
+        std::array<block_height, nbt::biomes::BLOCK_PER_REGION_WIDTH>;
+
+    /* Opaque heights along borders of a region, exchanged with
+       neighboring regions so that slope shading continues across them. */
+    struct region_edges {
+        /* Heights of the east column and south row, for neighbors. */
+        region_edge east;
+        region_edge south;
+        /* Heights of neighbors the west column and north row were last
+           shaded with. */
+        region_edge west_used;
+        region_edge north_used;
+
+        region_edges() {
+            east.fill(UNKNOWN_HEIGHT);
+            south.fill(UNKNOWN_HEIGHT);
+            west_used.fill(UNKNOWN_HEIGHT);
+            north_used.fill(UNKNOWN_HEIGHT);
+        }
+    };
+
+    /* Mapped *.ptedge file in the cache directory. It holds heights of
+       the east column and south row of each chunk, so that chunks next to
+       a changed one can be shaded without scanning unchanged chunks, and
+       the heights the region border was shaded with. */
+    class edge_cache {
+        struct layout {
+            static constexpr std::array<char, 8> MAGIC = {
+                'P', 'T', 'E', 'D', 'G', 'E', '\0', '\0'};
+            static constexpr std::uint32_t VERSION = 2;
+
+            std::array<char, 8> magic;
+            std::uint32_t version;
+            std::uint32_t reserved;
+            /* Column X = 16 * N + 15 for each chunk column N, by Z. */
+            std::array<region_edge, nbt::biomes::CHUNK_PER_REGION_WIDTH>
+                columns;
+            /* Row Z = 16 * N + 15 for each chunk row N, by X. */
+            std::array<region_edge, nbt::biomes::CHUNK_PER_REGION_WIDTH>
+                rows;
+            region_edge west_used;
+            region_edge north_used;
+        };
+
+        file<layout> *file_ = nullptr;
+        layout *data_ = nullptr;
+        bool fresh_ = false;
+
+        static auto edges_of(layout const &data) -> region_edges;
+
+    public:
+        /* Open or create the file of region (X, Z) in CACHE_DIR. Throws
+           if it cannot be mapped. */
+        edge_cache(std::filesystem::path const &cache_dir, int x, int z);
+        ~edge_cache();
+
+        edge_cache(edge_cache const &) = delete;
+        auto operator=(edge_cache const &) -> edge_cache & = delete;
+
+        static auto path(std::filesystem::path const &cache_dir, int x, int z)
+            -> std::filesystem::path;
+
+        /* Edges of region (X, Z) recorded in CACHE_DIR, if any. */
+        static auto read(std::filesystem::path const &cache_dir, int x, int z)
+            -> std::optional<region_edges>;
+
+        /* True if nothing was recorded, i.e. the region has never been
+           rendered with this cache, or the file was unusable. */
+        [[nodiscard]] auto fresh() const -> bool { return fresh_; }
+
+        auto column(int chunk_x) -> region_edge & {
+            return data_->columns[chunk_x];
+        }
+
+        auto row(int chunk_z) -> region_edge & { return data_->rows[chunk_z]; }
+
+        auto west_used() -> region_edge & { return data_->west_used; }
+
+        auto north_used() -> region_edge & { return data_->north_used; }
+
+        [[nodiscard]] auto edges() const -> region_edges {
+            return edges_of(*data_);
+        }
+    };
+
+    /* Edges of regions rendered in this run, keyed by output directory and
+       region coordinates. */
+    class edge_exchange {
+    public:
+        using key = std::tuple<std::filesystem::path, int, int>;
+
+    private:
+        mutable std::mutex mutex_;
+        std::map<key, region_edges> published_;
+
+    public:
+        void publish(key const &k, region_edges const &edges);
+
+        [[nodiscard]] auto find(key const &k) const
+            -> std::optional<region_edges>;
+
+        /* All published edges. Must not race with publish(). */
+        [[nodiscard]] auto published() const
+            -> std::map<key, region_edges> const & {
+            return published_;
+        }
+    };
+} // namespace pixel_terrain::image
+
+#endif
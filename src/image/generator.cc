@@ -8,18 +8,25 @@
 #include <exception>
 #include <filesystem>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "image/blocks.hh"
+#include "image/edges.hh"
 #include "image/image.hh"
 #include "image/utils.hh"
 #include "image/worker.hh"
 #include "logger/logger.hh"
+#include "nbt/constants.hh"
 #include "nbt/region.hh"
 #include "nbt/utils.hh"
 #include "utils/path_hack.hh"
@@ -70,13 +77,118 @@ namespace pixel_terrain::image {
 
             return std::make_pair(out_file, true);
         }
+
+        auto open_region_file(std::filesystem::path const &region_file,
+                              options const &options) -> anvil::region * {
+            try {
+                if (options.cache_dir().empty()) {
+                    return new anvil::region(region_file);
+                }
+                return new anvil::region(
+                    region_file, options.cache_dir(),
+                    {options.render_fingerprint(), color_table_version()});
+            } catch (std::exception const &e) {
+                ELOG("Failed to read region: %s\n",
+                     region_file.string().c_str());
+                ELOG("%s\n", e.what());
+
+                return nullptr;
+            }
+        }
+
+        /* Indices of 16-pixel segments that differ between A and B. */
+        auto changed_segments(region_edge const &a, region_edge const &b)
+            -> std::vector<int> {
+            constexpr int width = nbt::biomes::CHUNK_WIDTH;
+
+            std::vector<int> result;
+            for (int seg = 0; seg < nbt::biomes::CHUNK_PER_REGION_WIDTH;
+                 ++seg) {
+                if (!std::equal(a.begin() + seg * width,
+                                a.begin() + (seg + 1) * width,
+                                b.begin() + seg * width)) {
+                    result.push_back(seg);
+                }
+            }
+            return result;
+        }
     } // namespace
 
+    void image_generator::handle_job(region_job const &job) {
+        region_container *item = job.item;
+
+        if (job.chunk_x < 0) {
+            item->start_timer();
+            worker_->open_region(item);
+            if (item->get_options()->split_regions()) {
+                split_region(item);
+                return;
+            }
+
+            worker_->generate_region(item);
+        } else {
+            worker_->generate_region_chunk(item, job.chunk_x, job.chunk_z);
+            if (!item->finish_chunk()) {
+                return;
+            }
+
+            worker_->save_region(item);
+        }
+
+        finish_region(item);
+    }
+
+    void image_generator::record_region(region_container const *item) {
+        options const *options = item->get_options();
+        if (item->saved() && !options->manifest_path().empty()) {
+            manifest_.add_region(*item);
+        }
+        if (item->saved() && item->has_coords() &&
+            options->zoom_levels() > 0 && options->out_path_is_directory()) {
+            pyramid_.add_changed(*options, item->region_x(),
+                                 item->region_z());
+        }
+    }
+
+    void image_generator::finish_region(region_container *item) {
+        record_region(item);
+        logger::progress_bar_process_one();
+        delete item;
+    }
+
+    void image_generator::split_region(region_container *item) {
+        anvil::region *region = item->get_region();
+
+        std::vector<region_job> jobs;
+        for (int chunk_z = 0; chunk_z < nbt::biomes::CHUNK_PER_REGION_WIDTH;
+             ++chunk_z) {
+            for (int chunk_x = 0;
+                 chunk_x < nbt::biomes::CHUNK_PER_REGION_WIDTH; ++chunk_x) {
+                if (!region->is_chunk_missing(chunk_x, chunk_z)) {
+                    jobs.push_back(region_job{item, chunk_x, chunk_z});
+                }
+            }
+        }
+
+        if (jobs.empty()) {
+            finish_region(item);
+            return;
+        }
+
+        DLOG("Splitting %s into %zu jobs\n",
+             item->get_output_path()->filename().string().c_str(),
+             jobs.size());
+
+        /* Set the count before queuing since jobs may finish at once. */
+        item->set_remaining_chunks(static_cast<int>(jobs.size()));
+        thread_pool_->queue_jobs(jobs.begin(), jobs.end());
+    }
+
     void image_generator::queue(region_container *item) {
         DLOG("Queue: %s\n",
              item->get_output_path()->filename().string().c_str());
 
-        thread_pool_->queue_job(item);
+        thread_pool_->queue_job(region_job{item});
     }
 
     void image_generator::queue_region(std::filesystem::path const &region_file,
@@ -84,23 +196,18 @@ namespace pixel_terrain::image {
         DLOG("Preparing %s for queuing...\n",
              region_file.filename().string().c_str());
 
+        if (!options.manifest_path().empty()) {
+            manifest_.open(options.manifest_path());
+        }
+
         if (region_file.extension().string() != ".mca") {
             ILOG("Skipping %s because it is not a .mca file.\n",
                  region_file.filename().string().c_str());
             return;
         }
 
-        anvil::region *r;
-        try {
-            if (options.cache_dir().empty()) {
-                r = new anvil::region(region_file);
-            } else {
-                r = new anvil::region(region_file, options.cache_dir());
-            }
-        } catch (std::exception const &e) {
-            ELOG("Failed to read region: %s\n", region_file.string().c_str());
-            ELOG("%s\n", e.what());
-
+        anvil::region *r = open_region_file(region_file, options);
+        if (r == nullptr) {
             return;
         }
 
@@ -121,7 +228,21 @@ namespace pixel_terrain::image {
 
         DLOG("Output filename is %s.\n", out_file.string().c_str());
 
-        queue(new region_container(r, options, out_file));
+        auto *item = new region_container(r, options, out_file);
+        try {
+            auto [rx, rz, ok] = parse_region_file_path(region_file);
+            if (ok) {
+                item->set_coords(rx, rz);
+            }
+        } catch (std::logic_error const &) {
+            /* Not r.X.Z.mca; it is left out of zoomed-out tiles. */
+        }
+        if (item->has_coords() && options.out_path_is_directory()) {
+            queued_.insert_or_assign(
+                {options.out_path(), item->region_x(), item->region_z()},
+                queued_region{region_file, options, out_file});
+        }
+        queue(item);
         logger::progress_bar_increase_total(1);
     }
 
@@ -141,6 +262,10 @@ namespace pixel_terrain::image {
             }
         }
 
+        if (!options.manifest_path().empty()) {
+            manifest_.open(options.manifest_path());
+        }
+
         for (std::filesystem::directory_entry const &path :
              std::filesystem::directory_iterator(dir)) {
             if (path.is_directory()) {
@@ -157,5 +282,94 @@ namespace pixel_terrain::image {
         thread_pool_->start();
     }
 
-    void image_generator::finish() { thread_pool_->finish(); }
+    void image_generator::fix_borders() {
+        /* Regions next to each other may be rendered in any order, so a
+           region may have been shaded with old edges of its west or north
+           neighbor. Redraw chunks along such borders. */
+        std::map<edge_exchange::key, region_container *> fixes;
+        auto fix = [&](edge_exchange::key const &k) -> region_container * {
+            auto itr = fixes.find(k);
+            if (itr != fixes.end()) {
+                return itr->second;
+            }
+
+            auto queued = queued_.find(k);
+            if (queued == queued_.end()) {
+                return nullptr;
+            }
+            queued_region const &queued_item = queued->second;
+            anvil::region *r = open_region_file(
+                queued_item.region_file, queued_item.render_options);
+            if (r == nullptr) {
+                return nullptr;
+            }
+            auto *item = new region_container(
+                r, queued_item.render_options, queued_item.out_file);
+            item->set_coords(std::get<1>(k), std::get<2>(k));
+            fixes.emplace(k, item);
+            return item;
+        };
+        auto used_edges = [&](edge_exchange::key const &k)
+            -> std::optional<region_edges> {
+            std::optional<region_edges> edges = edges_.find(k);
+            auto queued = queued_.find(k);
+            if (!edges && queued != queued_.end() &&
+                !queued->second.render_options.cache_dir().empty()) {
+                edges = edge_cache::read(
+                    queued->second.render_options.cache_dir(),
+                    std::get<1>(k), std::get<2>(k));
+            }
+            return edges;
+        };
+
+        for (auto const &[k, edges] : edges_.published()) {
+            auto const &[dir, x, z] = k;
+
+            edge_exchange::key east = {dir, x + 1, z};
+            if (std::optional<region_edges> used = used_edges(east)) {
+                for (int seg : changed_segments(edges.east, used->west_used)) {
+                    if (region_container *item = fix(east)) {
+                        item->force_chunk(0, seg);
+                    }
+                }
+            }
+
+            edge_exchange::key south = {dir, x, z + 1};
+            if (std::optional<region_edges> used = used_edges(south)) {
+                for (int seg :
+                     changed_segments(edges.south, used->north_used)) {
+                    if (region_container *item = fix(south)) {
+                        item->force_chunk(seg, 0);
+                    }
+                }
+            }
+        }
+
+        if (fixes.empty()) {
+            return;
+        }
+
+        DLOG("Redrawing borders of %zu region(s)\n", fixes.size());
+        threaded_worker<region_container *> pool(
+            n_jobs_, [this](region_container *item) {
+                item->start_timer();
+                worker_->open_region(item);
+                worker_->generate_region(item);
+                /* Already counted in the progress when first rendered. */
+                record_region(item);
+                delete item;
+            });
+        pool.start();
+        for (auto const &[k, item] : fixes) {
+            pool.queue_job(item);
+        }
+        pool.finish();
+    }
+
+    void image_generator::finish() {
+        thread_pool_->finish();
+        fix_borders();
+        manifest_.write_regions();
+        pyramid_.build(n_jobs_, &manifest_);
+    }
 } // namespace pixel_terrain::image
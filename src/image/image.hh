@@ -4,8 +4,12 @@
 #define IMAGE_HH
 
 #include <filesystem>
+#include <map>
 
 #include "image/containers.hh"
+#include "image/edges.hh"
+#include "image/manifest.hh"
+#include "image/pyramid.hh"
 #include "image/worker.hh"
 #include "logger/logger.hh"
 #include "nbt/chunk.hh"
@@ -16,21 +20,38 @@
 namespace pixel_terrain::image {
     class image_generator {
         image::worker *worker_;
-        threaded_worker<region_container *> *thread_pool_;
+        threaded_worker<region_job> *thread_pool_;
+        unsigned int n_jobs_;
+        pyramid pyramid_;
+        manifest manifest_;
+        edge_exchange edges_;
+
+        /* Regions queued so far, to redraw their borders. */
+        struct queued_region {
+            std::filesystem::path region_file;
+            options render_options;
+            std::filesystem::path out_file;
+        };
+        std::map<edge_exchange::key, queued_region> queued_;
+
         auto fetch() -> region_container *;
 
+        void handle_job(region_job const &job);
+        /* Add ITEM to the manifest and zoomed-out tiles to rebuild. */
+        void record_region(region_container const *item);
+        void finish_region(region_container *item);
+        void split_region(region_container *item);
+        void fix_borders();
+
         void write_range_file(int start_x, int start_z, int end_x, int end_z,
                               options const &options);
 
     public:
-        image_generator(options const &options) {
-            worker_ = new image::worker;
-            thread_pool_ = new threaded_worker<region_container *>(
-                options.n_jobs(), [this](region_container *item) {
-                    this->worker_->generate_region(item);
-                    logger::progress_bar_process_one();
-                    delete item;
-                });
+        image_generator(options const &options) : n_jobs_(options.n_jobs()) {
+            worker_ = new image::worker(&edges_);
+            thread_pool_ = new threaded_worker<region_job>(
+                options.n_jobs(),
+                [this](region_job job) { this->handle_job(job); });
         }
 
         ~image_generator() {
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: MIT
+
+/* JSON lines manifest of written images. */
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "image/containers.hh"
+#include "image/manifest.hh"
+#include "image/planes.hh"
+#include "logger/logger.hh"
+#include "nbt/constants.hh"
+
+namespace pixel_terrain::image {
+    namespace {
+        auto json_string(std::string_view s) -> std::string {
+            std::string result = "\"";
+            for (char c : s) {
+                if (c == '"' || c == '\\') {
+                    result += '\\';
+                    result += c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    std::array<char, 8> buf;
+                    std::snprintf(buf.data(), buf.size(), "\\u%04x", c);
+                    result += buf.data();
+                } else {
+                    result += c;
+                }
+            }
+            result += '"';
+            return result;
+        }
+
+        auto json_ms(double ms) -> std::string {
+            std::array<char, 32> buf;
+            std::snprintf(buf.data(), buf.size(), "%.3f", ms);
+            return buf.data();
+        }
+    } // namespace
+
+    manifest::~manifest() {
+        for (auto &[path, f] : files_) {
+            if (f != nullptr && std::fclose(f) != 0) {
+                ELOG("Failed to write manifest %s\n", path.string().c_str());
+            }
+        }
+    }
+
+    auto manifest::get_file(std::filesystem::path const &path) -> std::FILE * {
+        auto itr = files_.find(path);
+        if (itr != files_.end()) {
+            return itr->second;
+        }
+
+        std::FILE *f = std::fopen(path.string().c_str(), "w");
+        if (f == nullptr) {
+            ELOG("Cannot open manifest %s\n", path.string().c_str());
+        }
+        /* Remember failures too, not to report them for every image. */
+        files_.emplace(path, f);
+        return f;
+    }
+
+    void manifest::open(std::filesystem::path const &path) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        get_file(path);
+    }
+
+    void manifest::add_region(region_container const &item) {
+        options const *options = item.get_options();
+        std::bitset<CHUNKS_PER_REGION> chunks = item.dirty_chunks();
+        double ms = item.elapsed_ms();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto [itr, inserted] = region_index_.try_emplace(
+            {options->manifest_path(), *item.get_output_path()},
+            regions_.size());
+        if (!inserted) {
+            region_entry &entry = regions_[itr->second];
+            entry.chunks |= chunks;
+            entry.ms += ms;
+            return;
+        }
+        regions_.push_back({options->manifest_path(),
+                            *item.get_output_path(), item.has_coords(),
+                            item.region_x(), item.region_z(), chunks, ms});
+    }
+
+    void manifest::write_regions() {
+        constexpr int width = nbt::biomes::CHUNK_PER_REGION_WIDTH;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (region_entry const &entry : regions_) {
+            std::string line = "{\"type\":\"region\",\"path\":" +
+                               json_string(entry.path.string());
+            if (entry.has_coords) {
+                line += ",\"region\":[" + std::to_string(entry.x) + "," +
+                        std::to_string(entry.z) + "]";
+            }
+            line += ",\"chunks\":" + std::to_string(entry.chunks.count());
+            if (entry.chunks.any()) {
+                int x0 = width;
+                int z0 = width;
+                int x1 = -1;
+                int z1 = -1;
+                for (int z = 0; z < width; ++z) {
+                    for (int x = 0; x < width; ++x) {
+                        if (entry.chunks.test(
+                                region_planes::chunk_index(x, z))) {
+                            x0 = std::min(x0, x);
+                            z0 = std::min(z0, z);
+                            x1 = std::max(x1, x);
+                            z1 = std::max(z1, z);
+                        }
+                    }
+                }
+                line += ",\"bbox\":[" + std::to_string(x0) + "," +
+                        std::to_string(z0) + "," + std::to_string(x1) + "," +
+                        std::to_string(z1) + "]";
+            }
+            line += ",\"ms\":" + json_ms(entry.ms) + "}\n";
+
+            std::FILE *f = get_file(entry.manifest_path);
+            if (f != nullptr) {
+                std::fputs(line.c_str(), f);
+            }
+        }
+        regions_.clear();
+        region_index_.clear();
+    }
+
+    void manifest::add_tile(options const &options,
+                            std::filesystem::path const &tile_path,
+                            unsigned int level, int x, int z, double ms) {
+        std::string line =
+            "{\"type\":\"tile\",\"path\":" + json_string(tile_path.string()) +
+            ",\"level\":" + std::to_string(level) + ",\"tile\":[" +
+            std::to_string(x) + "," + std::to_string(z) +
+            "],\"ms\":" + json_ms(ms) + "}\n";
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::FILE *f = get_file(options.manifest_path());
+        if (f != nullptr) {
+            std::fputs(line.c_str(), f);
+        }
+    }
+} // namespace pixel_terrain::image
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef MANIFEST_HH
+#define MANIFEST_HH
+
+#include <bitset>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "image/containers.hh"
+#include "image/planes.hh"
+
+namespace pixel_terrain::image {
+    /* List of images written in a run, for tools syncing output elsewhere.
+       One JSON object per line:
+         {"type":"region","path":P,"region":[X,Z],"chunks":N,
+          "bbox":[X0,Z0,X1,Z1],"ms":T}
+         {"type":"tile","path":P,"level":L,"tile":[X,Z],"ms":T}
+       BBOX is the inclusive range of redrawn chunks in the region, "region"
+       is omitted if the input name is not r.X.Z.mca, and T is wall time
+       spent on the image in milliseconds. Each region image is listed
+       once, even if its borders are redrawn later in the run. */
+    class manifest {
+        struct region_entry {
+            std::filesystem::path manifest_path;
+            std::filesystem::path path;
+            bool has_coords;
+            int x;
+            int z;
+            std::bitset<CHUNKS_PER_REGION> chunks;
+            double ms;
+        };
+
+        std::mutex mutex_;
+        std::map<std::filesystem::path, std::FILE *> files_;
+        /* Regions not written yet, in the order they were finished. */
+        std::vector<region_entry> regions_;
+        std::map<std::pair<std::filesystem::path, std::filesystem::path>,
+                 std::size_t>
+            region_index_;
+
+        auto get_file(std::filesystem::path const &path) -> std::FILE *;
+
+    public:
+        manifest() = default;
+        ~manifest();
+
+        manifest(manifest const &) = delete;
+        auto operator=(manifest const &) -> manifest & = delete;
+
+        /* Create or truncate PATH. It is left empty if nothing is written,
+           so that an old list is never mistaken for this run's. */
+        void open(std::filesystem::path const &path);
+
+        /* Record ITEM, merged with an earlier record of the same image
+           if any. Written by write_regions(). */
+        void add_region(region_container const &item);
+
+        void write_regions();
+
+        void add_tile(options const &options,
+                      std::filesystem::path const &tile_path,
+                      unsigned int level, int x, int z, double ms);
+    };
+} // namespace pixel_terrain::image
+
+#endif
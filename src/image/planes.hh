@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef PLANES_HH
+#define PLANES_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "nbt/biomes.hh"
+#include "nbt/constants.hh"
+
+namespace pixel_terrain::image {
+    inline constexpr std::size_t CHUNK_AREA =
+        nbt::biomes::CHUNK_WIDTH * nbt::biomes::CHUNK_WIDTH;
+
+    inline constexpr std::size_t CHUNKS_PER_REGION =
+        nbt::biomes::CHUNK_PER_REGION_WIDTH *
+        nbt::biomes::CHUNK_PER_REGION_WIDTH;
+
+    /* Block Y of a pixel. Signed, since worlds may go below Y = 0. */
+    using block_height = std::int16_t;
+
+    /* Height of pixels whose block is not known, e.g. outside of any
+       generated chunk. */
+    inline constexpr block_height UNKNOWN_HEIGHT =
+        std::numeric_limits<block_height>::min();
+
+    /* Biome of pixels outside of any generated chunk. */
+    inline constexpr nbt::biomes::biome_index UNKNOWN_BIOME =
+        std::numeric_limits<nbt::biomes::biome_index>::max();
+
+    /* Per-pixel values of a chunk, indexed by z * CHUNK_WIDTH + x, so that
+       each stage is a pass over contiguous arrays. */
+    using color_plane = std::array<std::uint32_t, CHUNK_AREA>;
+    using amount_plane = std::array<std::int32_t, CHUNK_AREA>;
+    using height_plane = std::array<block_height, CHUNK_AREA>;
+
+    /* State of pixels of a chunk being rendered. Top is the topmost
+       non-air block, mid the first one below it, and opaque the one where
+       the scan stopped. */
+    struct pixel_planes {
+        static constexpr std::uint8_t IS_TRANSPARENT = 1;
+        static constexpr std::uint8_t BIOME_OVERRIDDEN = 1 << 1;
+        /* Biome color of BIOME_OVERRIDDEN pixels, grass if neither. */
+        static constexpr std::uint8_t TINT_FOLIAGE = 1 << 2;
+        static constexpr std::uint8_t TINT_WATER = 1 << 3;
+
+        std::array<std::uint8_t, CHUNK_AREA> flags;
+        height_plane top_height;
+        height_plane mid_height;
+        height_plane opaque_height;
+        color_plane fg_color;
+        color_plane mid_color;
+        color_plane bg_color;
+        std::array<nbt::biomes::biome_index, CHUNK_AREA> top_biome;
+#if USE_BLOCK_LIGHT_DATA
+        std::array<std::uint8_t, CHUNK_AREA> block_light;
+#endif
+
+        void clear() {
+            flags.fill(0);
+            top_height.fill(0);
+            mid_height.fill(0);
+            opaque_height.fill(0);
+            fg_color.fill(0);
+            mid_color.fill(0);
+            bg_color.fill(0);
+            top_biome.fill(0);
+#if USE_BLOCK_LIGHT_DATA
+            block_light.fill(0);
+#endif
+        }
+    };
+
+    /* Free pixel_planes, so that chunks being rendered reuse those of
+       chunks already shaded rather than allocating new ones. Safe to use
+       from multiple threads. */
+    class planes_pool {
+        std::mutex mutex_;
+        std::vector<pixel_planes *> free_;
+
+    public:
+        planes_pool() = default;
+        ~planes_pool() {
+            for (pixel_planes *planes : free_) {
+                delete planes;
+            }
+        }
+
+        planes_pool(planes_pool const &) = delete;
+        auto operator=(planes_pool const &) -> planes_pool & = delete;
+
+        auto acquire() -> pixel_planes * {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!free_.empty()) {
+                    pixel_planes *planes = free_.back();
+                    free_.pop_back();
+                    return planes;
+                }
+            }
+            return new pixel_planes;
+        }
+
+        void release(pixel_planes *planes) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            free_.push_back(planes);
+        }
+    };
+
+    /* Planes of a region rendered in this run. Chunks are shaded only
+       after all of them are scanned, since slope shading of a pixel looks
+       at its west and north neighbors, which may be in another chunk.
+       Only chunks scanned in this run hold pixel_planes, taken from
+       POOL and given back when the region is destroyed. */
+    struct region_planes {
+        static constexpr int WIDTH = nbt::biomes::BLOCK_PER_REGION_WIDTH;
+
+        planes_pool *pool;
+        /* Null for chunks not scanned. Each is set by the thread scanning
+           the chunk, and read only after all chunks are scanned. */
+        std::array<pixel_planes *, CHUNKS_PER_REGION> chunks;
+        /* Opaque heights of the whole region, with a column and a row of
+           west and north neighbors at -1. */
+        std::array<block_height, (WIDTH + 1) * (WIDTH + 1)> heights;
+        /* Biomes of top blocks of the whole region, to blend biome colors
+           across chunks. */
+        std::array<nbt::biomes::biome_index, WIDTH * WIDTH> biomes;
+
+        explicit region_planes(planes_pool *pool) : pool(pool) {
+            chunks.fill(nullptr);
+            heights.fill(UNKNOWN_HEIGHT);
+            biomes.fill(UNKNOWN_BIOME);
+        }
+        ~region_planes() {
+            for (pixel_planes *planes : chunks) {
+                if (planes != nullptr) {
+                    pool->release(planes);
+                }
+            }
+        }
+
+        region_planes(region_planes const &) = delete;
+        auto operator=(region_planes const &) -> region_planes & = delete;
+
+        static auto chunk_index(int chunk_x, int chunk_z) -> std::size_t {
+            return chunk_z * nbt::biomes::CHUNK_PER_REGION_WIDTH + chunk_x;
+        }
+
+        /* Planes of a scanned chunk. */
+        auto chunk(int chunk_x, int chunk_z) -> pixel_planes & {
+            return *chunks[chunk_index(chunk_x, chunk_z)];
+        }
+
+        [[nodiscard]] auto is_scanned(int chunk_x, int chunk_z) const
+            -> bool {
+            return chunks[chunk_index(chunk_x, chunk_z)] != nullptr;
+        }
+
+        /* Opaque height at (X, Z) in the region; X and Z may be -1. */
+        auto height(int x, int z) -> block_height & {
+            return heights[(z + 1) * (WIDTH + 1) + x + 1];
+        }
+
+        auto biome(int x, int z) -> nbt::biomes::biome_index & {
+            return biomes[z * WIDTH + x];
+        }
+    };
+} // namespace pixel_terrain::image
+
+#endif
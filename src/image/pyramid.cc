@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: MIT
+
+/* Build zoomed-out tiles by shrinking 2x2 child tiles into their parent,
+   one level at a time. */
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "graphics/png.hh"
+#include "graphics/resample.hh"
+#include "image/pyramid.hh"
+#include "image/utils.hh"
+#include "logger/logger.hh"
+#include "nbt/constants.hh"
+#include "utils/path_hack.hh"
+#include "utils/threaded_worker.hh"
+
+namespace pixel_terrain::image {
+    namespace {
+        /* Floor of V / 2, for negative coordinates too. */
+        auto parent_of(int v) -> int { return v >= 0 ? v / 2 : (v - 1) / 2; }
+    } // namespace
+
+    auto pyramid::tile_path(options const &options, unsigned int level, int x,
+                            int z) -> std::filesystem::path {
+        std::string const &format = options.outname_format().empty()
+                                        ? std::string("r.%X.%Z")
+                                        : options.outname_format();
+        path_string name =
+            format_output_name(format, x, z) + PATH_STR_LITERAL(".png");
+
+        if (level == 0) {
+            return options.out_path() / name;
+        }
+        return options.out_path() /
+               (PATH_STR_LITERAL("zoom-") + to_path_string(level)) / name;
+    }
+
+    void pyramid::build_tile(tile_job const &job, manifest *manifest) {
+        auto start = std::chrono::steady_clock::now();
+        constexpr unsigned int size = nbt::biomes::BLOCK_PER_REGION_WIDTH;
+        constexpr unsigned int half = size / 2;
+        constexpr unsigned int stride = size * 4;
+
+        options const &options = job.owner->render_options;
+        graphics::png tile(size, size);
+
+        for (int dz = 0; dz < 2; ++dz) {
+            for (int dx = 0; dx < 2; ++dx) {
+                std::filesystem::path child_path = tile_path(
+                    options, job.level - 1, job.x * 2 + dx, job.z * 2 + dz);
+                if (!std::filesystem::exists(child_path)) {
+                    continue;
+                }
+
+                graphics::png *child;
+                try {
+                    child = new graphics::png(child_path);
+                } catch (std::exception const &e) {
+                    ELOG("Failed to read %s: %s\n", child_path.string().c_str(),
+                         e.what());
+                    continue;
+                }
+                child->fit(size, size);
+                graphics::downsample_half(
+                    child->get_data(), stride, size, size,
+                    tile.get_data() + (dz * half * size + dx * half) * 4,
+                    stride);
+                delete child;
+            }
+        }
+
+        std::filesystem::path path =
+            tile_path(options, job.level, job.x, job.z);
+        try {
+            std::filesystem::create_directories(path.parent_path());
+        } catch (std::filesystem::filesystem_error const &e) {
+            ELOG("Cannot create directory for %s: %s\n", path.string().c_str(),
+                 e.what());
+            return;
+        }
+        if (!tile.save(path, options.png_options())) {
+            ELOG("Failed to save %s\n", path.string().c_str());
+            return;
+        }
+
+        if (!options.manifest_path().empty()) {
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+            manifest->add_tile(options, path, job.level, job.x, job.z,
+                               elapsed.count());
+        }
+    }
+
+    void pyramid::add_changed(options const &options, int x, int z) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        auto [itr, inserted] =
+            targets_.try_emplace(options.out_path(), target{options, {}});
+        itr->second.changed.emplace(x, z);
+    }
+
+    void pyramid::build(unsigned int n_jobs, manifest *manifest) {
+        for (auto &[dir, target] : targets_) {
+            unsigned int n_levels = target.render_options.zoom_levels();
+            std::set<std::pair<int, int>> changed = target.changed;
+            for (unsigned int level = 1;
+                 level <= n_levels && !changed.empty(); ++level) {
+                std::set<std::pair<int, int>> parents;
+                for (auto const &[x, z] : changed) {
+                    parents.emplace(parent_of(x), parent_of(z));
+                }
+
+                std::vector<tile_job> jobs;
+                for (auto const &[x, z] : parents) {
+                    jobs.push_back(tile_job{&target, level, x, z});
+                }
+                DLOG("Building %zu tile(s) of zoom level %u in %s\n",
+                     jobs.size(), level, dir.string().c_str());
+
+                /* Each level reads the previous one, so finish it first. */
+                threaded_worker<tile_job> pool(
+                    n_jobs,
+                    [manifest](tile_job job) { build_tile(job, manifest); });
+                pool.start();
+                pool.queue_jobs(jobs.begin(), jobs.end());
+                pool.finish();
+
+                changed = std::move(parents);
+            }
+        }
+        targets_.clear();
+    }
+} // namespace pixel_terrain::image
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef PYRAMID_HH
+#define PYRAMID_HH
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+
+#include "image/containers.hh"
+#include "image/manifest.hh"
+
+namespace pixel_terrain::image {
+    /* Zoomed-out tiles built from region images after they are rendered.
+       Tile (X, Z) of level N covers 2^N x 2^N regions from region
+       (X * 2^N, Z * 2^N), at the size of a region image; level 0 is region
+       images themselves. Only ancestors of images written in this run are
+       rebuilt. */
+    class pyramid {
+        struct target {
+            options render_options;
+            std::set<std::pair<int, int>> changed;
+        };
+
+        struct tile_job {
+            target const *owner = nullptr;
+            unsigned int level = 0;
+            int x = 0;
+            int z = 0;
+        };
+
+        std::mutex mutex_;
+        /* Keyed by output directory. */
+        std::map<std::filesystem::path, target> targets_;
+
+        static void build_tile(tile_job const &job, manifest *manifest);
+
+    public:
+        static auto tile_path(options const &options, unsigned int level,
+                              int x, int z) -> std::filesystem::path;
+
+        /* Record that the image of region (X, Z) rendered with OPTIONS was
+           written. */
+        void add_changed(options const &options, int x, int z);
+
+        /* Rebuild tiles above changed region images with N_JOBS threads,
+           listing them in MANIFEST if requested by options. */
+        void build(unsigned int n_jobs, manifest *manifest);
+    };
+} // namespace pixel_terrain::image
+
+#endif
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "graphics/png.hh"
+#include "image/containers.hh"
+#include "image/image.hh"
+#include "nbt/constants.hh"
+#include "nbt/tag.hh"
+#include "nbt/test_writer.hh"
+
+using namespace pixel_terrain;
+using nbt::tag_type;
+using nbt::testing::block_palette;
+using nbt::testing::nbt_writer;
+using nbt::testing::pack;
+
+namespace {
+    constexpr int n_chunks = 4;
+    constexpr int width = n_chunks * nbt::biomes::CHUNK_WIDTH;
+
+    auto temp_dir(std::string const &name) -> std::filesystem::path {
+        std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                                    ("pixel_terrain_render_test_" + name);
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        return dir;
+    }
+
+    /* Chunk of 1.18 onward of grass on stone, whose surface rises
+       eastward, all in BIOME. */
+    auto make_chunk(int chunk_x, std::string_view biome)
+        -> std::vector<std::uint8_t> {
+        constexpr int width = nbt::biomes::CHUNK_WIDTH;
+
+        nbt_writer w;
+        w.compound("");
+        w.int_("DataVersion", 3465);
+        w.int_("yPos", -4);
+        w.long_("LastUpdate", 1);
+        w.list("sections", tag_type::TAG_COMPOUND, 1);
+        w.byte("Y", -4);
+        w.compound("block_states");
+        block_palette(&w, "palette",
+                      {"minecraft:air", "minecraft:stone",
+                       "minecraft:grass_block"});
+        std::vector<std::uint16_t> blocks(nbt::biomes::SECTION_BLOCK_COUNT);
+        for (int z = 0; z < width; ++z) {
+            for (int x = 0; x < width; ++x) {
+                int top = (chunk_x * width + x) / 8 % 8 + 4;
+                for (int y = 0; y <= top; ++y) {
+                    blocks[(y * width + z) * width + x] = y < top ? 1 : 2;
+                }
+            }
+        }
+        w.long_array("data", pack(blocks, 4));
+        w.end();
+        w.compound("biomes");
+        w.list("palette", tag_type::TAG_STRING, 1);
+        w.string_payload(biome);
+        w.end();
+        w.end();
+        w.end();
+        return w.data();
+    }
+
+    /* Write chunks of N_CHUNKS x N_CHUNKS at the corner of region r.0.0,
+       uncompressed, with the biome of chunk (X, Z) given by BIOME_OF, all
+       saved at TIMESTAMP. */
+    auto write_region(std::filesystem::path const &dir,
+                      std::string_view (*biome_of)(int, int),
+                      std::uint8_t timestamp = 1) -> std::filesystem::path {
+        constexpr std::size_t sector_size = 4096;
+        constexpr std::uint8_t uncompressed = 3;
+
+        std::vector<std::uint8_t> file(2 * sector_size);
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                std::vector<std::uint8_t> data =
+                    make_chunk(chunk_x, biome_of(chunk_x, chunk_z));
+                std::size_t len = data.size() + 1;
+                std::size_t sector = file.size() / sector_size;
+                std::size_t n_sectors =
+                    (len + 4 + sector_size - 1) / sector_size;
+
+                std::size_t index =
+                    (chunk_z * nbt::biomes::CHUNK_PER_REGION_WIDTH + chunk_x) *
+                    4;
+                file[index] = static_cast<std::uint8_t>(sector >> 16);
+                file[index + 1] = static_cast<std::uint8_t>(sector >> 8);
+                file[index + 2] = static_cast<std::uint8_t>(sector);
+                file[index + 3] = static_cast<std::uint8_t>(n_sectors);
+                file[sector_size + index + 3] = timestamp;
+
+                for (int i = 3; i >= 0; --i) {
+                    file.push_back(static_cast<std::uint8_t>(len >> (i * 8)));
+                }
+                file.push_back(uncompressed);
+                file.insert(file.end(), data.begin(), data.end());
+                file.resize((sector + n_sectors) * sector_size);
+            }
+        }
+
+        std::filesystem::path path = dir / "r.0.0.mca";
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<char const *>(file.data()),
+                  static_cast<std::streamsize>(file.size()));
+        return path;
+    }
+
+    /* Pixels of chunks written by write_region() rendered with BLEND.
+       With CACHE_DIR, only changed chunks are rendered into the image
+       kept from the last run. */
+    auto render(std::filesystem::path const &region_file,
+                std::filesystem::path const &out_dir, unsigned int blend,
+                std::filesystem::path const &cache_dir = {})
+        -> std::vector<std::uint32_t> {
+        image::options options;
+        options.set_n_jobs(1);
+        options.set_out_path(out_dir);
+        options.set_biome_blend(blend);
+        options.set_cache_dir(cache_dir);
+
+        {
+            image::image_generator generator(options);
+            generator.start();
+            generator.queue_region(region_file, options);
+            generator.finish();
+        }
+
+        graphics::png image(out_dir / "r.0.0.png");
+        std::vector<std::uint32_t> pixels;
+        for (int z = 0; z < width; ++z) {
+            for (int x = 0; x < width; ++x) {
+                pixels.push_back(image.get_pixel(x, z));
+            }
+        }
+        if (cache_dir.empty()) {
+            std::filesystem::remove(out_dir / "r.0.0.png");
+        }
+        return pixels;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(named_biomes_render_the_same) {
+    std::filesystem::path dir = temp_dir("named");
+    std::filesystem::path region = write_region(
+        dir, [](int chunk_x, int chunk_z) -> std::string_view {
+            return (chunk_x + chunk_z) % 2 == 0 ? "minecraft:plains"
+                                                : "minecraft:swamp";
+        });
+
+    std::vector<std::uint32_t> first = render(region, dir, 0);
+    std::vector<std::uint32_t> second = render(region, dir, 0);
+    BOOST_TEST(first == second);
+
+    /* The same grass in plains and swamp, at (1, 1) of chunks (0, 0) and
+       (1, 0), differs only if biome names are resolved. */
+    constexpr int chunk_width = nbt::biomes::CHUNK_WIDTH;
+    BOOST_TEST(first[width + 1] != first[width + chunk_width + 1]);
+
+    std::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(blend_keeps_plains) {
+    std::filesystem::path dir = temp_dir("plains");
+    std::filesystem::path region =
+        write_region(dir, [](int, int) -> std::string_view {
+            return "minecraft:plains";
+        });
+
+    std::vector<std::uint32_t> plain = render(region, dir, 0);
+    BOOST_TEST(plain == render(region, dir, 2));
+    BOOST_TEST(plain ==
+               render(region, dir, image::options::MAX_BIOME_BLEND));
+
+    std::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_CASE(blend_redraws_neighbors) {
+    std::filesystem::path dir = temp_dir("incremental");
+    std::filesystem::path cache = dir / "cache";
+    std::filesystem::path fresh = dir / "fresh";
+    std::filesystem::create_directories(cache);
+    std::filesystem::create_directories(fresh);
+
+    std::filesystem::path region =
+        write_region(dir, [](int, int) -> std::string_view {
+            return "minecraft:plains";
+        });
+    render(region, dir, 2, cache);
+
+    /* Swamp at chunk (1, 1) tints the edges of chunks around it. */
+    region = write_region(
+        dir, [](int chunk_x, int chunk_z) -> std::string_view {
+            return chunk_x == 1 && chunk_z == 1 ? "minecraft:swamp"
+                                                : "minecraft:plains";
+        },
+        2);
+    BOOST_TEST(render(region, dir, 2, cache) == render(region, fresh, 2));
+
+    std::filesystem::remove_all(dir);
+}
@@ -3,10 +3,21 @@
 /* Read whole mca files, and construct intermidiate representation of those,
    then decide pixel color and generate PNG image.. */
 
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "graphics/color.hh"
 #include "graphics/constants.hh"
@@ -15,44 +26,173 @@
 #include "image/image.hh"
 #include "image/worker.hh"
 #include "logger/logger.hh"
+#include "nbt/biomes.hh"
 #include "nbt/constants.hh"
+#include "nbt/file.hh"
 
 namespace pixel_terrain::image {
-    auto worker::scan_chunk(anvil::chunk *chunk, options const &options) const
-        -> worker::pixel_states * {
+    auto worker::resolve_palette(std::vector<std::string> const &palette)
+        -> std::vector<block_info> {
+        std::vector<block_info> result;
+        result.reserve(palette.size());
+        for (std::string const &block : palette) {
+            result.push_back(block_ids.intern(block));
+        }
+        return result;
+    }
+
+    void worker::scan_chunk(anvil::chunk *chunk, options const &options,
+                            pixel_planes *planes) const {
         using namespace graphics;
 
+        constexpr int section_height = nbt::biomes::BLOCK_PER_SECTION;
+
+        /* Y bounds come from the chunk, as worlds from 1.18 onward go
+           below Y = 0. MIN_Y is at a section boundary. */
+        int min_y = chunk->get_min_height();
         int max_y = chunk->get_max_height();
         if (options.is_nether()) {
             if (max_y > nbt::biomes::CHUNK_MAX_Y_NETHER) {
                 max_y = nbt::biomes::CHUNK_MAX_Y_NETHER;
             }
         }
+        int min_section = min_y / section_height;
+        std::size_t n_sections =
+            max_y < min_y ? 0 : (max_y - min_y) / section_height + 1;
+
+        /* Per-section state below is indexed by section Y - MIN_SECTION.
+           Palettes resolved to block IDs, filled when a section is first
+           reached. Empty table means the section has no blocks. */
+        std::vector<std::vector<block_info>> tables(n_sections);
+        std::vector<std::uint16_t const *> section_data(n_sections);
+        /* Non-null if every block in the section is the same. */
+        std::vector<block_info const *> uniform(n_sections);
+        std::vector<std::uint8_t> resolved(n_sections);
+        std::vector<std::uint8_t> broken(n_sections);
+
+        block_info const air = block_ids.info(block_registry::AIR_ID);
+
+        /* Resolve section at SLOT if not yet done. Returns false if the
+           section is broken. */
+        auto resolve_section = [&](int slot) -> bool {
+            if (!resolved[slot]) {
+                resolved[slot] = true;
+                int section_y = min_section + slot;
+                try {
+                    std::string const *only =
+                        chunk->get_uniform_block(section_y);
+                    if (only != nullptr) {
+                        tables[slot].push_back(block_ids.intern(*only));
+                        uniform[slot] = &tables[slot].front();
+                        return true;
+                    }
+                    section_data[slot] = chunk->get_section(section_y);
+                    if (section_data[slot] != nullptr) {
+                        tables[slot] =
+                            resolve_palette(*chunk->get_palette(section_y));
+                    }
+                } catch (std::exception const &e) {
+                    ELOG("Error occurred while obtaining block\n");
+                    ELOG("%s\n", e.what());
+
+                    broken[slot] = true;
+                }
+            }
+            return !broken[slot];
+        };
+
+        auto block_at = [&](int x, int y, int z) -> block_info const * {
+            int slot = (y - min_y) / section_height;
+            if (!resolve_section(slot)) {
+                return nullptr;
+            }
+            if (uniform[slot] != nullptr) {
+                return uniform[slot];
+            }
+            if (section_data[slot] == nullptr) {
+                return &air;
+            }
+            int index = (((y - min_y) % 16) * 16 + z) * 16 + x; // NOLINT
+            return &tables[slot][section_data[slot][index]];
+        };
+
+        /* Looked up by every pixel, so decoded once here. */
+        nbt::biomes::biome_grid const &biomes = chunk->get_biomes();
+
+        std::uint16_t const *surface = nullptr;
+        try {
+            surface =
+                chunk->get_heightmap(anvil::heightmap_type::WORLD_SURFACE);
+        } catch (std::exception const &e) {
+            DLOG("Ignoring broken heightmap: %s\n", e.what());
+        }
 
-        auto *states = new pixel_states;
+        planes->clear();
         for (int z = 0; z < nbt::biomes::CHUNK_WIDTH; ++z) {
             for (int x = 0; x < nbt::biomes::CHUNK_WIDTH; ++x) {
                 bool air_found = false;
-                std::string prev_block;
+                /* Air never reaches the comparison below, so it doubles
+                   as "no previous block". */
+                block_id prev_block = block_registry::AIR_ID;
 
-                pixel_state &pixel_state = get_pixel_state(states, x, z);
+                int i = z * nbt::biomes::CHUNK_WIDTH + x;
 
-                for (int y = max_y; y >= 0; --y) {
-                    std::string block;
-                    try {
-                        block = chunk->get_block(x, y, z);
-                    } catch (std::exception const &e) {
-                        ELOG("Error occurred while obtaining block\n");
-                        ELOG("%s\n", e.what());
+                /* Start from the top block recorded in the heightmap. The
+                   entry is trusted only if that block is not air and the
+                   one above it is, otherwise we scan the whole column. */
+                int start_y = max_y;
+                if (surface != nullptr) {
+                    int top =
+                        min_y + surface[z * nbt::biomes::CHUNK_WIDTH + x] - 1;
+                    if (min_y <= top && top < max_y) {
+                        block_info const *top_block = block_at(x, top, z);
+                        block_info const *above = block_at(x, top + 1, z);
+                        if (top_block != nullptr && above != nullptr &&
+                            !top_block->has(block_info::AIR) &&
+                            above->has(block_info::AIR)) {
+                            start_y = top;
+                            air_found = true;
+                        }
+                    }
+                }
+
+                int slot = -1;
+                block_info const *table = nullptr;
+                std::uint16_t const *indices = nullptr;
 
+                /* Lowest Y visited by this iteration. */
+                int next_y = start_y;
+                for (int y = start_y; y >= min_y; y = next_y - 1) {
+                    next_y = y;
+                    int y_in_chunk = y - min_y;
+                    if (y_in_chunk / section_height != slot) {
+                        slot = y_in_chunk / section_height;
+                        resolve_section(slot);
+                        indices = section_data[slot];
+                        table = tables[slot].data();
+                    }
+                    if (broken[slot]) {
                         continue;
                     }
 
-                    if (block == "minecraft:air" ||
-                        block == "minecraft:cave_air" ||
-                        block == "minecraft:void_air") {
+                    block_info const *block_ptr = uniform[slot];
+                    if (block_ptr != nullptr) {
+                        /* Layers below are the same block, which would be
+                           skipped as a repeat anyway; visit it once and
+                           step over the rest of the section. */
+                        next_y = min_y + slot * section_height;
+                    } else if (indices == nullptr) {
+                        block_ptr = &air;
+                    } else {
+                        int index =
+                            ((y_in_chunk % 16) * 16 + z) * 16 + x; // NOLINT
+                        block_ptr = &table[indices[index]];
+                    }
+                    block_info const &block = *block_ptr;
+
+                    if (block.has(block_info::AIR)) {
                         air_found = true;
-                        prev_block = block;
+                        prev_block = block.id;
                         continue;
                     }
 
@@ -60,354 +200,965 @@ namespace pixel_terrain::image {
                         continue;
                     }
 
-                    if (block == prev_block) {
+                    if (block.id == prev_block) {
                         continue;
                     }
 
-                    prev_block = block;
+                    prev_block = block.id;
 
-                    auto color_itr = colors.find(block);
-                    if (color_itr == end(colors)) {
+                    if (block.has(block_info::UNKNOWN)) {
                         std::unique_lock<std::mutex> lock(
                             unknown_blocks_mutex_);
-                        unknown_blocks_.insert(block);
+                        unknown_blocks_.insert(block.id);
                     } else {
-                        std::uint_fast32_t color = color_itr->second;
-
-                        if (pixel_state.fg_color() == 0x00000000) {
-                            pixel_state.set_fg_color(color);
-                            pixel_state.set_top_height(y);
-                            pixel_state.set_top_biome(
-                                chunk->get_biome(x, y, z));
-                            if (is_biome_overridden(block)) {
-                                pixel_state.add_flags(
-                                    pixel_state::BIOME_OVERRIDDEN);
+                        std::uint_fast32_t color = block.color;
+
+                        if (planes->fg_color[i] == 0x00000000) {
+                            planes->fg_color[i] = color;
+                            planes->top_height[i] = y;
+                            planes->top_biome[i] = biomes.at(x, y, z);
+                            if (block.has(block_info::BIOME_OVERRIDDEN)) {
+                                planes->flags[i] |=
+                                    pixel_planes::BIOME_OVERRIDDEN;
+                                if (block.has(block_info::TINT_FOLIAGE)) {
+                                    planes->flags[i] |=
+                                        pixel_planes::TINT_FOLIAGE;
+                                } else if (block.has(block_info::TINT_WATER)) {
+                                    planes->flags[i] |=
+                                        pixel_planes::TINT_WATER;
+                                }
                             }
-                            if (graphics::alpha(color) == color::CHAN_FULL) {
-                                pixel_state.set_mid_color(color);
-                                pixel_state.set_mid_height(y);
-                                pixel_state.set_bg_color(color);
-                                pixel_state.set_opaque_height(y);
+                            if (block.has(block_info::OPAQUE)) {
+                                planes->mid_color[i] = color;
+                                planes->mid_height[i] = y;
+                                planes->bg_color[i] = color;
+                                planes->opaque_height[i] = y;
                                 break;
                             }
 
-                            pixel_state.add_flags(pixel_state::IS_TRANSPARENT);
-                        } else if (pixel_state.mid_color() == color::CHAN_MIN) {
-                            pixel_state.set_mid_color(color);
-                            pixel_state.set_mid_height(y);
-                            if ((color & color::CHAN_MASK) ==
-                                color::CHAN_FULL) {
-                                pixel_state.set_bg_color(color);
-                                pixel_state.set_opaque_height(y);
+                            planes->flags[i] |= pixel_planes::IS_TRANSPARENT;
+                        } else if (planes->mid_color[i] == color::CHAN_MIN) {
+                            planes->mid_color[i] = color;
+                            planes->mid_height[i] = y;
+                            if (block.has(block_info::OPAQUE)) {
+                                planes->bg_color[i] = color;
+                                planes->opaque_height[i] = y;
                                 break;
                             }
                         } else {
-                            pixel_state.set_bg_color(
-                                blend_color(pixel_state.bg_color(), color));
-                            if ((pixel_state.bg_color() & color::CHAN_MASK) ==
+                            planes->bg_color[i] =
+                                blend_color(planes->bg_color[i], color);
+                            if ((planes->bg_color[i] & color::CHAN_MASK) ==
                                 color::CHAN_FULL) {
-                                pixel_state.set_opaque_height(y);
+                                planes->opaque_height[i] = y;
                                 break;
                             }
                         }
                     }
 #if USE_BLOCK_LIGHT_DATA
-                    pixel_state.set_block_light(
-                        chunk->get_block_light(x, pixel_state.top_height(), z));
+                    planes->block_light[i] =
+                        chunk->get_block_light(x, planes->top_height[i], z);
 #endif
                 }
-                pixel_state.set_bg_color(pixel_state.bg_color() |
-                                         color::CHAN_FULL);
-                if (pixel_state.top_height() == pixel_state.opaque_height()) {
-                    pixel_state.set_fg_color(color::CHAN_MIN);
-                    pixel_state.set_mid_color(color::CHAN_MIN);
-                } else if (pixel_state.mid_height() ==
-                           pixel_state.opaque_height()) {
-                    pixel_state.set_mid_color(0x00000000);
+                planes->bg_color[i] |= color::CHAN_FULL;
+                if (planes->top_height[i] == planes->opaque_height[i]) {
+                    planes->fg_color[i] = color::CHAN_MIN;
+                    planes->mid_color[i] = color::CHAN_MIN;
+                } else if (planes->mid_height[i] == planes->opaque_height[i]) {
+                    planes->mid_color[i] = 0x00000000;
                 }
             }
         }
-
-        return states;
     }
 
-    void worker::handle_biomes(pixel_states *pixel_states) {
+    void worker::handle_biomes(pixel_planes *planes) {
         using namespace graphics;
 
+        std::span<nbt::biomes::biome_info const> biomes =
+            nbt::biomes::biome_table();
+
         /* process biome color overrides */
-        for (int z = 0; z < nbt::biomes::CHUNK_WIDTH; ++z) {
-            for (int x = 0; x < nbt::biomes::CHUNK_WIDTH; ++x) {
-                pixel_state &pixel_state = get_pixel_state(pixel_states, x, z);
-                if (pixel_state.get_flag(pixel_state::BIOME_OVERRIDDEN)) {
-                    std::uint32_t src_color;
-                    if (pixel_state.fg_color() != color::CHAN_MIN) {
-                        src_color = pixel_state.fg_color();
-                    } else {
-                        src_color = pixel_state.bg_color();
-                    }
-                    std::int32_t biome = pixel_state.top_biome();
-                    constexpr double mix_half = 0.5;
-                    if (biome == nbt::biomes::SWAMP ||
-                        biome == nbt::biomes::SWAMP_HILLS) {
-                        src_color = blend_color(
-                            src_color, nbt::biomes::overrides::SWAMP, mix_half);
-                    } else if (biome == nbt::biomes::JUNGLE ||
-                               biome == nbt::biomes::MODIFIED_JUNGLE ||
-                               biome == nbt::biomes::JUNGLE_EDGE ||
-                               biome == nbt::biomes::MODIFIED_JUNGLE_EDGE) {
-                        src_color = blend_color(src_color,
-                                                nbt::biomes::overrides::JUNGLE,
-                                                mix_half);
-                    } else if (biome == nbt::biomes::SAVANNA ||
-                               biome == nbt::biomes::SHATTERED_SAVANNA) {
-                        src_color = blend_color(src_color,
-                                                nbt::biomes::overrides::SAVANNA,
-                                                mix_half);
-                    }
-                    if (pixel_state.fg_color() != color::CHAN_MIN) {
-                        pixel_state.set_fg_color(src_color);
-                    } else {
-                        pixel_state.set_bg_color(src_color);
-                    }
-                }
+        for (std::size_t i = 0; i < CHUNK_AREA; ++i) {
+            if ((planes->flags[i] & pixel_planes::BIOME_OVERRIDDEN) == 0) {
+                continue;
             }
+            std::uint32_t overlay = biomes[planes->top_biome[i]].overlay;
+            if (overlay == 0) {
+                continue;
+            }
+
+            std::uint32_t &src_color = planes->fg_color[i] != color::CHAN_MIN
+                                           ? planes->fg_color[i]
+                                           : planes->bg_color[i];
+            constexpr double mix_half = 0.5;
+            src_color = blend_color(src_color, overlay, mix_half);
         }
     }
 
-    void worker::handle_inclination(pixel_states *pixel_states) {
-        constexpr int x_tone_change_ratio = 30;
-        constexpr int z_tone_change_ratio = 10;
+    namespace {
+        constexpr std::size_t N_TINTS = 3;
+        /* Red, green and blue of grass, foliage and water colors, then
+           the number of biomes added up. */
+        using tint_sums = std::array<std::int32_t, N_TINTS * 3 + 1>;
+        constexpr std::size_t TINT_COUNT = N_TINTS * 3;
 
-        for (int z = 0; z < nbt::biomes::CHUNK_WIDTH; ++z) {
-            for (int x = 1; x < nbt::biomes::CHUNK_WIDTH; ++x) {
-                pixel_state &left = get_pixel_state(pixel_states, x - 1, z);
-                pixel_state &cur = get_pixel_state(pixel_states, x, z);
-                if (left.opaque_height() < cur.opaque_height()) {
-                    cur.set_bg_color(graphics::increase_brightness(
-                        cur.bg_color(), x_tone_change_ratio));
-                    if (x == 1) {
-                        left.set_bg_color(graphics::increase_brightness(
-                            left.bg_color(), x_tone_change_ratio));
-                    }
-                } else if (cur.opaque_height() < left.opaque_height()) {
-                    cur.set_bg_color(graphics::increase_brightness(
-                        cur.bg_color(), -x_tone_change_ratio));
-                    if (x == 1) {
-                        left.set_bg_color(graphics::increase_brightness(
-                            left.bg_color(), -x_tone_change_ratio));
-                    }
+        constexpr std::array<unsigned int, 3> RGB_OFFSETS = {
+            graphics::color::R_OFFSET, graphics::color::G_OFFSET,
+            graphics::color::B_OFFSET};
+
+        void add_sums(tint_sums *to, tint_sums const &from, int sign) {
+            for (std::size_t i = 0; i < to->size(); ++i) {
+                (*to)[i] += sign * from[i];
+            }
+        }
+
+        /* Scale channels of COLOR by the ratio of SUM / COUNT to
+           REFERENCE, the tint COLOR was taken with. */
+        auto tint_color(std::uint32_t color, std::int32_t const *sum,
+                        std::int32_t count, std::int32_t const *reference)
+            -> std::uint32_t {
+            std::uint32_t result =
+                color & (graphics::color::CHAN_MASK
+                         << graphics::color::A_OFFSET);
+            for (std::size_t c = 0; c < RGB_OFFSETS.size(); ++c) {
+                std::int32_t channel = static_cast<std::int32_t>(
+                    (color >> RGB_OFFSETS[c]) & graphics::color::CHAN_MASK);
+                std::int32_t tinted = channel * sum[c] /
+                                      (count * std::max(reference[c], 1));
+                result |= static_cast<std::uint32_t>(std::min(
+                              tinted, std::int32_t{graphics::color::CHAN_FULL}))
+                          << RGB_OFFSETS[c];
+            }
+            return result;
+        }
+    } // namespace
+
+    void worker::handle_biome_blend(region_planes *planes, int radius) {
+        using namespace graphics;
+
+        constexpr int width = region_planes::WIDTH;
+        constexpr int chunk_width = nbt::biomes::CHUNK_WIDTH;
+        constexpr int n_chunks = nbt::biomes::CHUNK_PER_REGION_WIDTH;
+
+        std::span<nbt::biomes::biome_info const> biomes =
+            nbt::biomes::biome_table();
+        std::vector<tint_sums> terms(biomes.size());
+        for (std::size_t b = 0; b < biomes.size(); ++b) {
+            std::array<std::uint32_t, N_TINTS> colors = {
+                biomes[b].grass, biomes[b].foliage, biomes[b].water};
+            for (std::size_t t = 0; t < N_TINTS; ++t) {
+                for (std::size_t c = 0; c < RGB_OFFSETS.size(); ++c) {
+                    terms[b][t * 3 + c] = static_cast<std::int32_t>(
+                        (colors[t] >> RGB_OFFSETS[c]) & color::CHAN_MASK);
                 }
             }
+            terms[b][TINT_COUNT] = 1;
         }
+        /* Colors of the block table are the ones in plains. */
+        tint_sums const &reference = terms[nbt::biomes::PLAINS_INDEX];
 
-        for (int z = 1; z < nbt::biomes::CHUNK_WIDTH; ++z) {
-            for (int x = 0; x < nbt::biomes::CHUNK_WIDTH; ++x) {
-                pixel_state &cur = get_pixel_state(pixel_states, x, z);
-                pixel_state &upper = get_pixel_state(pixel_states, x, z - 1);
-
-                if (upper.opaque_height() < cur.opaque_height()) {
-                    cur.set_bg_color(graphics::increase_brightness(
-                        cur.bg_color(), z_tone_change_ratio));
-                    if (z == 1) {
-                        upper.set_bg_color(graphics::increase_brightness(
-                            upper.bg_color(), z_tone_change_ratio));
-                    }
-                } else if (cur.opaque_height() < upper.opaque_height()) {
-                    cur.set_bg_color(graphics::increase_brightness(
-                        cur.bg_color(), -z_tone_change_ratio));
-                    if (z == 1) {
-                        upper.set_bg_color(graphics::increase_brightness(
-                            upper.bg_color(), -z_tone_change_ratio));
-                    }
+        auto add_row = [&](std::vector<tint_sums> *columns, int z,
+                           int sign) {
+            for (int x = 0; x < width; ++x) {
+                nbt::biomes::biome_index b = planes->biome(x, z);
+                if (b != UNKNOWN_BIOME) {
+                    add_sums(&(*columns)[x], terms[b], sign);
+                }
+            }
+        };
+
+        std::bitset<n_chunks> scanned_rows;
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                if (planes->is_scanned(chunk_x, chunk_z)) {
+                    scanned_rows.set(chunk_z);
                 }
             }
         }
+
+        /* Box sums are separated into sums of each column over rows
+           Z - RADIUS to Z + RADIUS, and sums of those along the row. Both
+           slide by adding one term and removing another, so the cost per
+           pixel does not depend on RADIUS. */
+        std::vector<tint_sums> columns(width, tint_sums{});
+        for (int z = 0; z < radius; ++z) {
+            add_row(&columns, z, 1);
+        }
+        for (int z = 0; z < width; ++z) {
+            if (z + radius < width) {
+                add_row(&columns, z + radius, 1);
+            }
+            if (z - radius > 0) {
+                add_row(&columns, z - radius - 1, -1);
+            }
+            if (!scanned_rows.test(z / chunk_width)) {
+                continue;
+            }
+
+            tint_sums window{};
+            for (int x = 0; x < radius; ++x) {
+                add_sums(&window, columns[x], 1);
+            }
+            for (int x = 0; x < width; ++x) {
+                if (x + radius < width) {
+                    add_sums(&window, columns[x + radius], 1);
+                }
+                if (x - radius > 0) {
+                    add_sums(&window, columns[x - radius - 1], -1);
+                }
+
+                int chunk_x = x / chunk_width;
+                int chunk_z = z / chunk_width;
+                if (!planes->is_scanned(chunk_x, chunk_z) ||
+                    window[TINT_COUNT] == 0) {
+                    continue;
+                }
+                pixel_planes &chunk_planes = planes->chunk(chunk_x, chunk_z);
+                std::size_t i = (z % chunk_width) * chunk_width +
+                                x % chunk_width;
+                std::uint8_t flags = chunk_planes.flags[i];
+                if ((flags & pixel_planes::BIOME_OVERRIDDEN) == 0) {
+                    continue;
+                }
+
+                std::size_t tint = 0;
+                if ((flags & pixel_planes::TINT_FOLIAGE) != 0) {
+                    tint = 1;
+                } else if ((flags & pixel_planes::TINT_WATER) != 0) {
+                    tint = 2;
+                }
+                std::uint32_t &src_color =
+                    chunk_planes.fg_color[i] != color::CHAN_MIN
+                        ? chunk_planes.fg_color[i]
+                        : chunk_planes.bg_color[i];
+                src_color = tint_color(src_color, &window[tint * 3],
+                                       window[TINT_COUNT],
+                                       &reference[tint * 3]);
+            }
+        }
     }
 
-#if USE_BLOCK_LIGHT_DATA
-    void worker::handle_block_light(pixel_states *pixel_states) {
-        for (int x = 0; x < 16; ++x) {
-            for (int z = 0; z < 16; ++z) {
-                pixel_state &pixel_state = get_pixel_state(pixel_states, x, z);
-                pixel_state.set_bg_color(graphics::increase_brightness(
-                    pixel_state.bg_color(), pixel_state.block_light() * 5));
+    void worker::handle_inclination(pixel_planes *planes,
+                                    block_height const *west,
+                                    block_height const *north) {
+        constexpr int x_tone_change_ratio = 30;
+        constexpr int z_tone_change_ratio = 10;
+        constexpr int width = nbt::biomes::CHUNK_WIDTH;
+
+        /* Amount of change of the pixel by comparing its height with
+           the one before it. */
+        auto tone = [](block_height prev, block_height cur,
+                       int ratio) -> std::int32_t {
+            if (prev < cur) {
+                return ratio;
             }
+            if (cur < prev) {
+                return -ratio;
+            }
+            return 0;
+        };
+
+        /* Each pixel changes at most once in each direction, and it
+           depends only on heights; so collect changes first and apply
+           them at once. Directions are still applied separately since
+           brightness saturates. The first column and row are compared
+           with neighbor chunks; if they are not known, they take the same
+           change as the next ones. */
+        height_plane const &height = planes->opaque_height;
+        amount_plane amounts;
+        for (int z = 0; z < width; ++z) {
+            int row = z * width;
+            for (int x = 1; x < width; ++x) {
+                amounts[row + x] = tone(height[row + x - 1], height[row + x],
+                                        x_tone_change_ratio);
+            }
+            amounts[row] =
+                west[z] == UNKNOWN_HEIGHT
+                    ? amounts[row + 1]
+                    : tone(west[z], height[row], x_tone_change_ratio);
+        }
+        graphics::increase_brightness(planes->bg_color.data(),
+                                      amounts.data(), planes->bg_color.data(),
+                                      CHUNK_AREA);
+
+        for (std::size_t i = width; i < CHUNK_AREA; ++i) {
+            amounts[i] =
+                tone(height[i - width], height[i], z_tone_change_ratio);
+        }
+        for (int x = 0; x < width; ++x) {
+            amounts[x] =
+                north[x] == UNKNOWN_HEIGHT
+                    ? amounts[width + x]
+                    : tone(north[x], height[x], z_tone_change_ratio);
         }
+        graphics::increase_brightness(planes->bg_color.data(),
+                                      amounts.data(), planes->bg_color.data(),
+                                      CHUNK_AREA);
     }
-#endif
 
-    void worker::process_pipeline(pixel_states *pixel_states) {
-        handle_biomes(pixel_states);
-        handle_inclination(pixel_states);
 #if USE_BLOCK_LIGHT_DATA
-        handle_block_light(pixel_states);
-#endif
+    void worker::handle_block_light(pixel_planes *planes) {
+        constexpr int light_ratio = 5;
+
+        amount_plane amounts;
+        for (std::size_t i = 0; i < CHUNK_AREA; ++i) {
+            amounts[i] = planes->block_light[i] * light_ratio;
+        }
+        graphics::increase_brightness(planes->bg_color.data(),
+                                      amounts.data(), planes->bg_color.data(),
+                                      CHUNK_AREA);
     }
+#endif
 
     void worker::generate_image(int chunk_x, int chunk_z,
-                                pixel_states *pixel_states,
+                                pixel_planes const &planes,
                                 graphics::png &image) {
         constexpr int height_tone_ratio = 3;
+        constexpr int width = nbt::biomes::CHUNK_WIDTH;
 
-        for (int z = 0; z < nbt::biomes::CHUNK_WIDTH; ++z) {
-            for (int x = 0; x < nbt::biomes::CHUNK_WIDTH; ++x) {
-                pixel_state &pixel_state = get_pixel_state(pixel_states, x, z);
-
-                std::uint_fast32_t bg_color = graphics::increase_brightness(
-                    pixel_state.mid_color(),
-                    static_cast<int>(pixel_state.mid_height() -
-                                     pixel_state.top_height()) *
-                        height_tone_ratio);
-                std::uint_fast32_t color =
-                    graphics::blend_color(pixel_state.fg_color(), bg_color);
-                bg_color = graphics::increase_brightness(
-                    pixel_state.bg_color(),
-                    static_cast<int>(pixel_state.opaque_height() -
-                                     pixel_state.top_height()) *
-                        height_tone_ratio);
-                color = graphics::blend_color(color, bg_color);
-                image.set_pixel(chunk_x * nbt::biomes::CHUNK_WIDTH + x,
-                                chunk_z * nbt::biomes::CHUNK_WIDTH + z, color);
-            }
+        amount_plane mid_amounts;
+        amount_plane bg_amounts;
+        for (std::size_t i = 0; i < CHUNK_AREA; ++i) {
+            mid_amounts[i] =
+                (planes.mid_height[i] - planes.top_height[i]) *
+                height_tone_ratio;
+            bg_amounts[i] =
+                (planes.opaque_height[i] - planes.top_height[i]) *
+                height_tone_ratio;
         }
-    }
 
-    void worker::generate_chunk(anvil::chunk *chunk, int chunk_x, int chunk_z,
-                                graphics::png &image,
-                                options const &options) const {
-        pixel_states *pixel_states = scan_chunk(chunk, options);
-        process_pipeline(pixel_states);
-        generate_image(chunk_x, chunk_z, pixel_states, image);
-        delete pixel_states;
+        /* Blend foreground, middle and background, each darkened by its
+           depth from the top. */
+        color_plane colors;
+        color_plane layer;
+        graphics::increase_brightness(planes.mid_color.data(),
+                                      mid_amounts.data(), layer.data(),
+                                      CHUNK_AREA);
+        graphics::blend_colors(planes.fg_color.data(), layer.data(),
+                               colors.data(), CHUNK_AREA);
+        graphics::increase_brightness(planes.bg_color.data(),
+                                      bg_amounts.data(), layer.data(),
+                                      CHUNK_AREA);
+        graphics::blend_colors(colors.data(), layer.data(), colors.data(),
+                               CHUNK_AREA);
+
+        for (int z = 0; z < width; ++z) {
+            for (int x = 0; x < width; ++x) {
+                image.set_pixel(chunk_x * width + x, chunk_z * width + z,
+                                colors[z * width + x]);
+            }
+        }
     }
 
     worker::~worker() {
         if (!unknown_blocks_.empty()) {
             ILOG("Unknown blocks:\n");
-            for (std::string const &block : unknown_blocks_) {
-                ILOG(" %s\n", block.c_str());
+            for (block_id id : unknown_blocks_) {
+                ILOG(" %s\n", block_ids.name(id).c_str());
             }
         }
     }
 
-    void worker::generate_region(region_container *item) const {
+    namespace {
+        /* Header of *.ptraw file, followed by RGBA pixels. PNG_SIZE and
+           PNG_MTIME identify the output image the pixels were saved to, so
+           that the cache is discarded if the image was written without
+           it. */
+        struct raw_cache_header {
+            static constexpr std::array<char, 8> MAGIC = {
+                'P', 'T', 'R', 'A', 'W', '\0', '\0', '\0'};
+
+            std::array<char, 8> magic;
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint64_t png_size;
+            std::int64_t png_mtime;
+        };
+
+        constexpr std::size_t RAW_CACHE_PIXELS_SIZE =
+            nbt::biomes::BLOCK_PER_REGION_WIDTH *
+            nbt::biomes::BLOCK_PER_REGION_WIDTH * 4;
+
+        auto raw_cache_path(region_container *item) -> std::filesystem::path {
+            return item->get_options()->cache_dir() /
+                   item->get_output_path()->filename().concat(".ptraw");
+        }
+
+        /* Identify PATH by its size and modification time. Both are 0 if
+           PATH does not exist. */
+        auto stamp_of(std::filesystem::path const &path)
+            -> std::pair<std::uint64_t, std::int64_t> {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(path, ec);
+            if (ec) {
+                return {0, 0};
+            }
+            auto mtime = std::filesystem::last_write_time(path, ec);
+            if (ec) {
+                return {0, 0};
+            }
+            return {size, mtime.time_since_epoch().count()};
+        }
+    } // namespace
+
+    auto worker::load_raw_cache(region_container *item) -> graphics::png * {
+        constexpr unsigned int width = nbt::biomes::BLOCK_PER_REGION_WIDTH;
+
+        if (item->get_options()->cache_dir().empty()) {
+            return nullptr;
+        }
+
+        file<unsigned char> *raw;
+        try {
+            raw = new file<unsigned char>(
+                raw_cache_path(item),
+                sizeof(raw_cache_header) + RAW_CACHE_PIXELS_SIZE, "r+");
+        } catch (std::exception const &e) {
+            DLOG("Cannot open raw cache for %s: %s\n",
+                 item->get_output_path()->filename().string().c_str(),
+                 e.what());
+            return nullptr;
+        }
+
+        raw_cache_header header;
+        std::memcpy(&header, raw->get_raw_data(), sizeof(header));
+        unsigned char *pixels = raw->get_raw_data() + sizeof(header);
+        auto *image = new graphics::png(width, width, pixels);
+
+        auto [png_size, png_mtime] = stamp_of(*item->get_output_path());
+        bool png_exists = png_size != 0;
+        if (header.magic != raw_cache_header::MAGIC || header.width != width ||
+            header.height != width ||
+            (png_exists &&
+             (header.png_size != png_size || header.png_mtime != png_mtime))) {
+            /* Missing or stale; start from the output image. */
+            DLOG("Rebuilding raw cache for %s\n",
+                 item->get_output_path()->filename().string().c_str());
+            std::fill(pixels, pixels + RAW_CACHE_PIXELS_SIZE, 0);
+            if (png_exists) {
+                graphics::png *saved = load_image(item);
+                for (unsigned int y = 0; y < width; ++y) {
+                    for (unsigned int x = 0; x < width; ++x) {
+                        image->set_pixel(x, y, saved->get_pixel(x, y));
+                    }
+                }
+                delete saved;
+            }
+
+            header.magic = raw_cache_header::MAGIC;
+            header.width = width;
+            header.height = width;
+            header.png_size = 0;
+            header.png_mtime = 0;
+            std::memcpy(raw->get_raw_data(), &header, sizeof(header));
+        }
+
+        item->set_raw_cache(raw);
+        return image;
+    }
+
+    auto worker::load_image(region_container *item) -> graphics::png * {
+        graphics::png *image;
+        if (std::filesystem::exists(*item->get_output_path())) {
+            try {
+                image = new graphics::png(*item->get_output_path());
+                image->fit(nbt::biomes::BLOCK_PER_REGION_WIDTH,
+                           nbt::biomes::BLOCK_PER_REGION_WIDTH);
+
+            } catch (std::exception const &) {
+                image = new graphics::png(nbt::biomes::BLOCK_PER_REGION_WIDTH,
+                                          nbt::biomes::BLOCK_PER_REGION_WIDTH);
+            }
+        } else {
+            image = new graphics::png(nbt::biomes::BLOCK_PER_REGION_WIDTH,
+                                      nbt::biomes::BLOCK_PER_REGION_WIDTH);
+        }
+        return image;
+    }
+
+    void worker::save_image(region_container *item, graphics::png *image) {
+        if (!image->save(*item->get_output_path(),
+                         item->get_options()->png_options())) {
+            ELOG("Failed to save %s\n",
+                 item->get_output_path()->string().c_str());
+            return;
+        }
+        item->set_saved();
+
+        file<unsigned char> *raw = item->raw_cache();
+        if (raw != nullptr) {
+            raw_cache_header header;
+            std::memcpy(&header, raw->get_raw_data(), sizeof(header));
+            std::tie(header.png_size, header.png_mtime) =
+                stamp_of(*item->get_output_path());
+            std::memcpy(raw->get_raw_data(), &header, sizeof(header));
+        }
+    }
+
+    namespace {
+        /* Copy opaque heights and top biomes of a chunk into the
+           region-wide planes. */
+        void store_columns(region_planes *planes, int chunk_x, int chunk_z,
+                           pixel_planes const &chunk_planes) {
+            constexpr int width = nbt::biomes::CHUNK_WIDTH;
+            for (int z = 0; z < width; ++z) {
+                for (int x = 0; x < width; ++x) {
+                    int region_x = chunk_x * width + x;
+                    int region_z = chunk_z * width + z;
+                    planes->height(region_x, region_z) =
+                        chunk_planes.opaque_height[z * width + x];
+                    planes->biome(region_x, region_z) =
+                        chunk_planes.top_biome[z * width + x];
+                }
+            }
+        }
+    } // namespace
+
+    auto worker::read_chunk(region_container *item, int chunk_x, int chunk_z,
+                            bool force) -> anvil::chunk * {
         anvil::region *region = item->get_region();
-        DLOG("Generating %s...\n",
-             item->get_output_path()->filename().string().c_str());
+        anvil::chunk *chunk;
+        try {
+            /* Avoid nonexisting chunk to be recorded as reused chunk. */
+            if (region->is_chunk_missing(chunk_x, chunk_z)) {
+                return nullptr;
+            }
 
-        graphics::png *image = nullptr;
+            chunk = region->get_chunk_if_dirty(chunk_x, chunk_z);
+            if (chunk == nullptr && force) {
+                chunk = region->get_chunk(chunk_x, chunk_z);
+            }
+        } catch (std::exception const &e) {
+            DLOG("Warning: parse error in %s\n",
+                 item->get_output_path()->filename().string().c_str());
+            DLOG("%s\n", e.what());
+            return nullptr;
+        }
 
-        /* minumum range of chunk update is radius of 3, so we can capture
-           all updated chunk with step of 6. but, we set this 4 since
-           4 can divide 16, our image (chunk) width. */
-        constexpr int scan_chunk_step = 4;
-        for (int chunk_z = 0; chunk_z < nbt::biomes::CHUNK_PER_REGION_WIDTH;
-             chunk_z += scan_chunk_step) {
-            int prev_chunk_x = -1;
-            for (int chunk_x = 0; chunk_x < nbt::biomes::CHUNK_PER_REGION_WIDTH;
-                 ++chunk_x) {
-                anvil::chunk *chunk;
+        logger::record_stat(chunk != nullptr, item->get_options()->label());
+        return chunk;
+    }
 
-                try {
-                    /* Avoid nonexisting chunk to be recorded as reused chunk.
-                     */
-                    if (region->is_chunk_missing(chunk_x, chunk_z)) {
+    void worker::scan_region_chunk(region_container *item,
+                                   anvil::chunk *chunk, int chunk_x,
+                                   int chunk_z) const {
+        region_planes *planes;
+        {
+            std::unique_lock<std::mutex> lock(item->image_mutex());
+            if (item->planes() == nullptr) {
+                item->set_planes(new region_planes(&planes_pool_));
+            }
+            planes = item->planes();
+        }
+
+        /* Each chunk owns its own planes and pixels of the height plane,
+           so no lock is needed to scan. */
+        item->add_dirty_chunk(chunk_x, chunk_z);
+        pixel_planes *chunk_planes = planes_pool_.acquire();
+        chunk_planes->clear();
+        scan_chunk(chunk, *item->get_options(), chunk_planes);
+        /* Blended colors need neighbors, so they are applied on shading. */
+        if (item->get_options()->biome_blend() == 0) {
+            handle_biomes(chunk_planes);
+        }
+        store_columns(planes, chunk_x, chunk_z, *chunk_planes);
+        planes->chunks[region_planes::chunk_index(chunk_x, chunk_z)] =
+            chunk_planes;
+    }
+
+    void worker::scan_heights(region_container *item, int chunk_x,
+                              int chunk_z) const {
+        anvil::chunk *chunk;
+        try {
+            chunk = item->get_region()->get_chunk(chunk_x, chunk_z);
+        } catch (std::exception const &e) {
+            DLOG("Warning: parse error in %s\n",
+                 item->get_output_path()->filename().string().c_str());
+            DLOG("%s\n", e.what());
+            return;
+        }
+        if (chunk == nullptr) {
+            return;
+        }
+
+        pixel_planes planes;
+        planes.clear();
+        scan_chunk(chunk, *item->get_options(), &planes);
+        store_columns(item->planes(), chunk_x, chunk_z, planes);
+        delete chunk;
+    }
+
+    void worker::rescan_neighbors(region_container *item) const {
+        constexpr int width = nbt::biomes::CHUNK_WIDTH;
+        constexpr int n_chunks = nbt::biomes::CHUNK_PER_REGION_WIDTH;
+
+        region_planes *planes = item->planes();
+        auto rescan = [&](int chunk_x, int chunk_z) {
+            if (chunk_x < 0 || chunk_z < 0 || chunk_x >= n_chunks ||
+                chunk_z >= n_chunks || planes->is_scanned(chunk_x, chunk_z)) {
+                return;
+            }
+            anvil::chunk *chunk = read_chunk(item, chunk_x, chunk_z, true);
+            if (chunk != nullptr) {
+                scan_region_chunk(item, chunk, chunk_x, chunk_z);
+                delete chunk;
+            }
+        };
+
+        /* Blended biome colors of changed chunks reach at most a chunk
+           into their neighbors, whose biomes are the same as before; so
+           only neighbors of chunks scanned so far are redrawn. */
+        if (item->get_options()->biome_blend() > 0) {
+            std::bitset<CHUNKS_PER_REGION> changed;
+            for (std::size_t i = 0; i < CHUNKS_PER_REGION; ++i) {
+                changed[i] = planes->chunks[i] != nullptr;
+            }
+            for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+                for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                    if (!changed.test(
+                            region_planes::chunk_index(chunk_x, chunk_z))) {
                         continue;
                     }
+                    for (int dz = -1; dz <= 1; ++dz) {
+                        for (int dx = -1; dx <= 1; ++dx) {
+                            rescan(chunk_x + dx, chunk_z + dz);
+                        }
+                    }
+                }
+            }
+        }
 
-                    chunk = region->get_chunk_if_dirty(chunk_x, chunk_z);
-                } catch (std::exception const &e) {
-                    DLOG("Warning: parse error in %s\n",
-                         item->get_output_path()->filename().string().c_str());
-                    DLOG("%s\n", e.what());
+        edge_cache *cache = item->get_edge_cache();
+        if (cache == nullptr) {
+            return;
+        }
+
+        /* Edges of rescanned chunks are the same as recorded ones, so one
+           pass is enough. */
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                if (!planes->is_scanned(chunk_x, chunk_z)) {
                     continue;
                 }
 
-                if (chunk == nullptr) {
-                    logger::record_stat(false, item->get_options()->label());
-                    continue;
+                bool east_changed = false;
+                bool south_changed = false;
+                for (int i = 0; i < width; ++i) {
+                    int x = chunk_x * width + width - 1;
+                    int z = chunk_z * width + i;
+                    if (planes->height(x, z) != cache->column(chunk_x)[z]) {
+                        east_changed = true;
+                    }
+
+                    x = chunk_x * width + i;
+                    z = chunk_z * width + width - 1;
+                    if (planes->height(x, z) != cache->row(chunk_z)[x]) {
+                        south_changed = true;
+                    }
+                }
+                if (east_changed) {
+                    rescan(chunk_x + 1, chunk_z);
                 }
+                if (south_changed) {
+                    rescan(chunk_x, chunk_z + 1);
+                }
+            }
+        }
+    }
 
-                if (image == nullptr) {
-                    if (std::filesystem::exists(*item->get_output_path())) {
-                        try {
-                            image = new graphics::png(*item->get_output_path());
-                            image->fit(nbt::biomes::BLOCK_PER_REGION_WIDTH,
-                                       nbt::biomes::BLOCK_PER_REGION_WIDTH);
-
-                        } catch (std::exception const &) {
-                            image = new graphics::png(
-                                nbt::biomes::BLOCK_PER_REGION_WIDTH,
-                                nbt::biomes::BLOCK_PER_REGION_WIDTH);
-                        }
-                    } else {
-                        image = new graphics::png(
-                            nbt::biomes::BLOCK_PER_REGION_WIDTH,
-                            nbt::biomes::BLOCK_PER_REGION_WIDTH);
+    auto worker::neighbor_edges(region_container *item, int dx, int dz) const
+        -> std::optional<region_edges> {
+        options const *options = item->get_options();
+        if (!item->has_coords() || !options->out_path_is_directory()) {
+            return std::nullopt;
+        }
+
+        int x = item->region_x() + dx;
+        int z = item->region_z() + dz;
+        std::optional<region_edges> edges =
+            edges_->find({options->out_path(), x, z});
+        if (!edges && !options->cache_dir().empty()) {
+            edges = edge_cache::read(options->cache_dir(), x, z);
+        }
+        return edges;
+    }
+
+    void worker::shade_region(region_container *item,
+                              graphics::png *image) const {
+        constexpr int width = nbt::biomes::CHUNK_WIDTH;
+        constexpr int n_chunks = nbt::biomes::CHUNK_PER_REGION_WIDTH;
+        constexpr int region_width = nbt::biomes::BLOCK_PER_REGION_WIDTH;
+
+        region_planes *planes = item->planes();
+        edge_cache *cache = item->get_edge_cache();
+        anvil::region *region = item->get_region();
+
+        if (std::optional<region_edges> west = neighbor_edges(item, -1, 0)) {
+            for (int z = 0; z < region_width; ++z) {
+                planes->height(-1, z) = west->east[z];
+            }
+        }
+        if (std::optional<region_edges> north = neighbor_edges(item, 0, -1)) {
+            for (int x = 0; x < region_width; ++x) {
+                planes->height(x, -1) = north->south[x];
+            }
+        }
+
+        /* Fill heights of unchanged chunks next to scanned ones, from the
+           cache if any, or else by scanning them. */
+        std::bitset<CHUNKS_PER_REGION> filled;
+        auto fill = [&](int chunk_x, int chunk_z, bool column) {
+            std::size_t index = region_planes::chunk_index(chunk_x, chunk_z);
+            if (planes->chunks[index] != nullptr || filled.test(index) ||
+                region->is_chunk_missing(chunk_x, chunk_z)) {
+                return;
+            }
+
+            if (cache == nullptr) {
+                filled.set(index);
+                scan_heights(item, chunk_x, chunk_z);
+                return;
+            }
+            for (int i = 0; i < width; ++i) {
+                if (column) {
+                    int z = chunk_z * width + i;
+                    planes->height(chunk_x * width + width - 1, z) =
+                        cache->column(chunk_x)[z];
+                } else {
+                    int x = chunk_x * width + i;
+                    planes->height(x, chunk_z * width + width - 1) =
+                        cache->row(chunk_z)[x];
+                }
+            }
+        };
+        /* Biomes are blended over at most a chunk, so only those of
+           chunks around scanned ones are needed. They are not cached. */
+        int blend = static_cast<int>(item->get_options()->biome_blend());
+        auto fill_biomes = [&](int chunk_x, int chunk_z) {
+            std::size_t index = region_planes::chunk_index(chunk_x, chunk_z);
+            if (planes->chunks[index] != nullptr || filled.test(index) ||
+                region->is_chunk_missing(chunk_x, chunk_z)) {
+                return;
+            }
+            filled.set(index);
+            scan_heights(item, chunk_x, chunk_z);
+        };
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                if (blend == 0 || !planes->is_scanned(chunk_x, chunk_z)) {
+                    continue;
+                }
+                for (int z = std::max(chunk_z - 1, 0);
+                     z <= std::min(chunk_z + 1, n_chunks - 1); ++z) {
+                    for (int x = std::max(chunk_x - 1, 0);
+                         x <= std::min(chunk_x + 1, n_chunks - 1); ++x) {
+                        fill_biomes(x, z);
                     }
                 }
+            }
+        }
+
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                if (!planes->is_scanned(chunk_x, chunk_z)) {
+                    continue;
+                }
+                if (chunk_x > 0) {
+                    fill(chunk_x - 1, chunk_z, true);
+                }
+                if (chunk_z > 0) {
+                    fill(chunk_x, chunk_z - 1, false);
+                }
+            }
+        }
 
-                logger::record_stat(true, item->get_options()->label());
-                generate_chunk(chunk, chunk_x, chunk_z, *image,
-                               *item->get_options());
+        if (blend > 0) {
+            handle_biome_blend(planes, blend);
+        }
 
-                delete chunk;
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                if (!planes->is_scanned(chunk_x, chunk_z)) {
+                    continue;
+                }
 
-                int start_x = chunk_x - scan_chunk_step + 1 > prev_chunk_x
-                                  ? chunk_x - scan_chunk_step + 1
-                                  : prev_chunk_x + 1;
-                int end_x = chunk_x + scan_chunk_step >
-                                    nbt::biomes::CHUNK_PER_REGION_WIDTH
-                                ? nbt::biomes::CHUNK_PER_REGION_WIDTH
-                                : chunk_x + scan_chunk_step;
-
-                for (int t_chunk_x = start_x; t_chunk_x < end_x; ++t_chunk_x) {
-                    for (int t_chunk_z = chunk_z + 1; t_chunk_z < chunk_z + 4;
-                         ++t_chunk_z) {
-                        try {
-                            if (region->is_chunk_missing(t_chunk_x,
-                                                         t_chunk_z)) {
-                                continue;
-                            }
+                std::array<block_height, width> west;
+                std::array<block_height, width> north;
+                for (int i = 0; i < width; ++i) {
+                    west[i] = planes->height(chunk_x * width - 1,
+                                             chunk_z * width + i);
+                    north[i] = planes->height(chunk_x * width + i,
+                                              chunk_z * width - 1);
+                }
 
-                            chunk = region->get_chunk_if_dirty(t_chunk_x,
-                                                               t_chunk_z);
-                        } catch (std::exception const &e) {
-                            DLOG("Parse error in %s\n", item->get_output_path()
-                                                            ->filename()
-                                                            .string()
-                                                            .c_str());
-                            DLOG("%s\n", e.what());
-                            continue;
-                        }
+                pixel_planes &chunk_planes = planes->chunk(chunk_x, chunk_z);
+                handle_inclination(&chunk_planes, west.data(), north.data());
+#if USE_BLOCK_LIGHT_DATA
+                handle_block_light(&chunk_planes);
+#endif
+                generate_image(chunk_x, chunk_z, chunk_planes, *image);
+            }
+        }
+    }
+
+    void worker::update_edges(region_container *item) const {
+        constexpr int width = nbt::biomes::CHUNK_WIDTH;
+        constexpr int n_chunks = nbt::biomes::CHUNK_PER_REGION_WIDTH;
+
+        options const *options = item->get_options();
+        region_planes *planes = item->planes();
+        edge_cache *cache = item->get_edge_cache();
+        anvil::region *region = item->get_region();
+        bool publish = item->has_coords() && options->out_path_is_directory();
+        edge_exchange::key key = {options->out_path(), item->region_x(),
+                                  item->region_z()};
+
+        /* Start from edges known so far, since only scanned chunks are
+           updated. */
+        region_edges edges;
+        if (cache != nullptr) {
+            edges = cache->edges();
+        } else if (publish) {
+            edges = edges_->find(key).value_or(region_edges());
+        }
 
-                        if (chunk == nullptr) {
-                            continue;
+        for (int chunk_z = 0; chunk_z < n_chunks; ++chunk_z) {
+            for (int chunk_x = 0; chunk_x < n_chunks; ++chunk_x) {
+                bool scanned = planes->is_scanned(chunk_x, chunk_z);
+                if (scanned) {
+                    for (int i = 0; i < width; ++i) {
+                        int x = chunk_x * width + width - 1;
+                        int z = chunk_z * width + i;
+                        block_height height = planes->height(x, z);
+                        if (cache != nullptr) {
+                            cache->column(chunk_x)[z] = height;
+                        }
+                        if (chunk_x == n_chunks - 1) {
+                            edges.east[z] = height;
                         }
 
-                        logger::record_stat(true, item->get_options()->label());
-                        generate_chunk(chunk, t_chunk_x, t_chunk_z, *image,
-                                       *item->get_options());
+                        x = chunk_x * width + i;
+                        z = chunk_z * width + width - 1;
+                        height = planes->height(x, z);
+                        if (cache != nullptr) {
+                            cache->row(chunk_z)[x] = height;
+                        }
+                        if (chunk_z == n_chunks - 1) {
+                            edges.south[x] = height;
+                        }
+                    }
+                }
 
-                        delete chunk;
+                /* Heights the border was shaded with. Missing chunks are
+                   recorded too, not to be redrawn for nothing. */
+                if (!scanned && !region->is_chunk_missing(chunk_x, chunk_z)) {
+                    continue;
+                }
+                for (int i = 0; i < width; ++i) {
+                    if (chunk_x == 0) {
+                        int z = chunk_z * width + i;
+                        edges.west_used[z] = planes->height(-1, z);
+                    }
+                    if (chunk_z == 0) {
+                        int x = chunk_x * width + i;
+                        edges.north_used[x] = planes->height(x, -1);
                     }
                 }
-                prev_chunk_x = chunk_x + 3;
             }
         }
 
-        if (image == nullptr) {
+        if (cache != nullptr) {
+            cache->west_used() = edges.west_used;
+            cache->north_used() = edges.north_used;
+        }
+        if (publish) {
+            edges_->publish(key, edges);
+        }
+    }
+
+    void worker::open_region(region_container *item) const {
+        options const *options = item->get_options();
+        if (options->cache_dir().empty() || !item->has_coords() ||
+            !options->out_path_is_directory()) {
+            return;
+        }
+
+        try {
+            auto *cache = new edge_cache(options->cache_dir(), item->region_x(),
+                                         item->region_z());
+            item->set_edge_cache(cache);
+            /* Without recorded edges, unchanged chunks cannot be used to
+               shade their neighbors. */
+            if (cache->fresh()) {
+                item->set_render_all(true);
+            }
+        } catch (std::exception const &e) {
+            DLOG("Cannot open edge cache for %s: %s\n",
+                 item->get_output_path()->filename().string().c_str(),
+                 e.what());
+        }
+    }
+
+    void worker::generate_region_chunk(region_container *item, int chunk_x,
+                                       int chunk_z) const {
+        bool forced = item->is_forced_chunk(chunk_x, chunk_z);
+        if (item->has_forced_chunks() && !forced) {
+            return;
+        }
+
+        anvil::chunk *chunk =
+            read_chunk(item, chunk_x, chunk_z, forced || item->render_all());
+        if (chunk == nullptr) {
+            return;
+        }
+
+        scan_region_chunk(item, chunk, chunk_x, chunk_z);
+        delete chunk;
+    }
+
+    void worker::save_region(region_container *item) const {
+        if (item->planes() == nullptr) {
             DLOG("Exiting without generating; any chunk changed in %s\n",
                  item->get_output_path()->filename().string().c_str());
 
             return;
         }
 
-        image->save(*item->get_output_path());
-        delete image;
+        rescan_neighbors(item);
+
+        graphics::png *image = nullptr;
+        if (item->get_options()->raw_cache()) {
+            image = load_raw_cache(item);
+        }
+        if (image == nullptr) {
+            image = load_image(item);
+        }
+        item->set_image(image);
+
+        shade_region(item, image);
+        save_image(item, image);
+        if (item->saved()) {
+            update_edges(item);
+        }
 
         DLOG("Generated %s\n",
              item->get_output_path()->filename().string().c_str());
     }
 
+    void worker::generate_region(region_container *item) const {
+        DLOG("Generating %s...\n",
+             item->get_output_path()->filename().string().c_str());
+
+        /* Every chunk is checked, since edges of changed chunks may change
+           shading of unchanged ones. */
+        for (int chunk_z = 0; chunk_z < nbt::biomes::CHUNK_PER_REGION_WIDTH;
+             ++chunk_z) {
+            for (int chunk_x = 0;
+                 chunk_x < nbt::biomes::CHUNK_PER_REGION_WIDTH; ++chunk_x) {
+                generate_region_chunk(item, chunk_x, chunk_z);
+            }
+        }
+
+        save_region(item);
+    }
 } // namespace pixel_terrain::image
@@ -4,139 +4,112 @@
 #define WORKER_HH
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "graphics/png.hh"
+#include "image/blocks.hh"
 #include "image/containers.hh"
+#include "image/edges.hh"
+#include "image/planes.hh"
 #include "nbt/chunk.hh"
 #include "nbt/constants.hh"
 
 namespace pixel_terrain::image {
     class worker {
-        class pixel_state {
-            std::uint32_t flags_ = 0;
-            unsigned int top_height_ = 0;
-            unsigned int mid_height_ = 0;
-            unsigned int opaque_height_ = 0;
-            std::uint32_t fg_color_ = 0;
-            std::uint32_t mid_color_ = 0;
-            std::uint32_t bg_color_ = 0;
-            std::int32_t top_biome_ = 0;
-#if USE_BLOCK_LIGHT_DATA
-            std::uint8_t block_light_ = 0;
-#endif
-
-        public:
-            static constexpr std::int32_t IS_TRANSPARENT = 1;
-            static constexpr std::int32_t BIOME_OVERRIDDEN = 1 << 1;
-
-            void add_flags(std::int32_t flags) { this->flags_ |= flags; }
-
-            [[nodiscard]] auto get_flag(std::int32_t field) const -> bool {
-                return static_cast<bool>(this->flags_ & field);
-            }
-
-            void set_top_height(std::uint8_t top_height) {
-                top_height_ = top_height;
-            }
-
-            [[nodiscard]] auto top_height() const -> std::uint8_t {
-                return top_height_;
-            }
+        edge_exchange *edges_;
+        mutable planes_pool planes_pool_;
 
-            void set_mid_height(unsigned int mid_height) {
-                mid_height_ = mid_height;
-            }
-
-            [[nodiscard]] auto mid_height() const -> unsigned int {
-                return mid_height_;
-            }
+        mutable std::mutex unknown_blocks_mutex_;
+        mutable std::set<block_id> unknown_blocks_;
 
-            void set_opaque_height(unsigned int opaque_height) {
-                opaque_height_ = opaque_height;
-            };
+        static auto resolve_palette(std::vector<std::string> const &palette)
+            -> std::vector<block_info>;
 
-            [[nodiscard]] auto opaque_height() const -> unsigned int {
-                return opaque_height_;
-            }
+        void scan_chunk(anvil::chunk *chunk, options const &options,
+                        pixel_planes *planes) const;
 
-            void set_fg_color(std::uint32_t color) { fg_color_ = color; }
+        static void handle_biomes(pixel_planes *planes);
 
-            [[nodiscard]] auto fg_color() const -> std::uint32_t {
-                return fg_color_;
-            }
+        /* Tint biome overridden pixels of scanned chunks with biome colors
+           averaged over the square of RADIUS around them. */
+        static void handle_biome_blend(region_planes *planes, int radius);
 
-            void set_mid_color(std::uint32_t color) { mid_color_ = color; }
+        /* WEST and NORTH are opaque heights of the column and row next to
+           the chunk, UNKNOWN_HEIGHT where not known. */
+        static void handle_inclination(pixel_planes *planes,
+                                       block_height const *west,
+                                       block_height const *north);
 
-            [[nodiscard]] auto mid_color() const -> std::uint32_t {
-                return mid_color_;
-            }
+#if USE_BLOCK_LIGHT_DATA
+        static void handle_block_light(pixel_planes *planes);
+#endif
 
-            void set_bg_color(std::uint32_t color) { bg_color_ = color; }
+        static void generate_image(int chunk_x, int chunk_z,
+                                   pixel_planes const &planes,
+                                   graphics::png &image);
 
-            [[nodiscard]] auto bg_color() const -> std::uint32_t {
-                return bg_color_;
-            }
+        /* Read the chunk if it changed, or FORCE is true. */
+        static auto read_chunk(region_container *item, int chunk_x,
+                               int chunk_z, bool force) -> anvil::chunk *;
 
-            void set_top_biome(std::int32_t biome) { top_biome_ = biome; }
+        void scan_region_chunk(region_container *item, anvil::chunk *chunk,
+                               int chunk_x, int chunk_z) const;
 
-            [[nodiscard]] auto top_biome() const -> std::int32_t {
-                return top_biome_;
-            }
+        /* Read opaque heights and top biomes of an unchanged chunk, to
+           shade its neighbors. */
+        void scan_heights(region_container *item, int chunk_x,
+                          int chunk_z) const;
 
-#if USE_BLOCK_LIGHT_DATA
-            void set_block_light(std::uint8_t level) { block_light_ = level; }
+        /* Scan unchanged chunks whose neighbor's edge height changed, or
+           which are next to a changed chunk if biomes are blended. */
+        void rescan_neighbors(region_container *item) const;
 
-            [[nodiscard]] auto block_light() -> std::uint8_t {
-                return block_light_;
-            }
-#endif
-        };
+        auto neighbor_edges(region_container *item, int dx, int dz) const
+            -> std::optional<region_edges>;
 
-        using pixel_states =
-            std::array<pixel_state, nbt::biomes::CHUNK_WIDTH *
-                                        nbt::biomes::CHUNK_PER_REGION_WIDTH *
-                                        nbt::biomes::CHUNK_WIDTH *
-                                        nbt::biomes::CHUNK_PER_REGION_WIDTH>;
+        void shade_region(region_container *item, graphics::png *image) const;
 
-        mutable std::mutex unknown_blocks_mutex_;
-        mutable std::set<std::string> unknown_blocks_;
+        /* Record edge heights of scanned chunks in the cache, and publish
+           the region's edges to neighbors. */
+        void update_edges(region_container *item) const;
 
-        static inline auto get_pixel_state(pixel_states *states, int x, int y)
-            -> pixel_state & {
-            return (*states)[y * nbt::biomes::CHUNK_WIDTH *
-                                 nbt::biomes::CHUNK_PER_REGION_WIDTH +
-                             x];
-        }
+        static auto load_raw_cache(region_container *item)
+            -> graphics::png *;
 
-        auto scan_chunk(anvil::chunk *chunk, options const &options) const
-            -> pixel_states *;
+        static auto load_image(region_container *item) -> graphics::png *;
 
-        static void handle_biomes(pixel_states *pixel_states);
+        static void save_image(region_container *item,
+                               graphics::png *image);
 
-        static void handle_inclination(pixel_states *pixel_states);
+    public:
+        explicit worker(edge_exchange *edges) : edges_(edges) {}
+        ~worker();
 
-#if USE_BLOCK_LIGHT_DATA
-        static void handle_block_light(pixel_states *pixel_states);
-#endif
+        worker(worker const &) = delete;
+        auto operator=(worker const &) -> worker & = delete;
 
-        static void process_pipeline(pixel_states *pixel_states);
+        /* Prepare ITEM for rendering. Call before any chunk of it is
+           rendered. */
+        void open_region(region_container *item) const;
 
-        static void generate_image(int chunk_x, int chunk_z,
-                                   pixel_states *pixel_states,
-                                   graphics::png &image);
+        void generate_region(region_container *item) const;
 
-        void generate_chunk(anvil::chunk *chunk, int chunk_x, int chunk_z,
-                            graphics::png &image, options const &options) const;
+        /* Scan one chunk of ITEM. Safe to call concurrently for different
+           chunks. */
+        void generate_region_chunk(region_container *item, int chunk_x,
+                                   int chunk_z) const;
 
-    public:
-        ~worker();
-        void generate_region(region_container *item) const;
+        /* Shade and save chunks scanned by generate_region_chunk(), if
+           any. */
+        void save_region(region_container *item) const;
     };
 } // namespace pixel_terrain::image
 
@@ -3,6 +3,7 @@
 #include <cstring>
 #include <exception>
 #include <iostream>
+#include <span>
 
 #include <regetopt.h>
 
@@ -96,10 +97,9 @@ Usage: pixel-terrain nbt-to-xml [OPTION]... [--] FILE
         }
 
 #if USE_V3_NBT_PARSER
-        std::vector<std::uint8_t> data(f->get_raw_data(),
-                                       f->get_raw_data() + f->size());
-        auto [nbt, itr] =
-            nbt::tag_compound::parse_buffer(data.begin(), data.end());
+        /* Parse the mapped file in place. */
+        auto [nbt, itr] = nbt::tag_compound::parse_buffer(
+            std::span<std::uint8_t const>(f->get_raw_data(), f->size()));
         if (nbt == nullptr) {
             std::cerr << "Fatal: Parse error in NBT.\n";
             return false;
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: MIT
+
+/* Table of biomes and their tint colors. Grass and foliage colors are the
+   ones the game derives from temperature and downfall of each biome,
+   with the fixed colors of swamps, badlands and dark forests. */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "nbt/biomes.hh"
+#include "nbt/constants.hh"
+
+namespace pixel_terrain::nbt::biomes {
+    namespace {
+        constexpr std::uint32_t NO_OVERLAY = 0;
+
+        /* Biomes before 1.18 by their names then, followed by the ones
+           added since. Ocean must come first. */
+        constexpr auto table = std::to_array<biome_info>({
+            {"ocean", OCEAN, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff, NO_OVERLAY},
+            {"deep_ocean", DEEP_OCEAN, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"frozen_ocean", FROZEN_OCEAN, 0x80b497ff, 0x60a17bff, 0x3938c9ff,
+             NO_OVERLAY},
+            {"deep_frozen_ocean", DEEP_FROZEN_OCEAN, 0x8eb971ff, 0x71a74dff,
+             0x3938c9ff, NO_OVERLAY},
+            {"cold_ocean", COLD_OCEAN, 0x8eb971ff, 0x71a74dff, 0x3d57d6ff,
+             NO_OVERLAY},
+            {"deep_cold_ocean", DEEP_COLD_OCEAN, 0x8eb971ff, 0x71a74dff,
+             0x3d57d6ff, NO_OVERLAY},
+            {"lukewarm_ocean", LUKEWARM_OCEAN, 0x8eb971ff, 0x71a74dff,
+             0x45adf2ff, NO_OVERLAY},
+            {"deep_lukewarm_ocean", DEEP_LUKEWARM_OCEAN, 0x8eb971ff,
+             0x71a74dff, 0x45adf2ff, NO_OVERLAY},
+            {"warm_ocean", WARM_OCEAN, 0x8eb971ff, 0x71a74dff, 0x43d5eeff,
+             NO_OVERLAY},
+            {"deep_warm_ocean", DEEP_WARM_OCEAN, 0x8eb971ff, 0x71a74dff,
+             0x43d5eeff, NO_OVERLAY},
+            {"river", RIVER, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff, NO_OVERLAY},
+            {"frozen_river", FROZEN_RIVER, 0x80b497ff, 0x60a17bff, 0x3938c9ff,
+             NO_OVERLAY},
+            {"beach", BEACH, 0x91bd59ff, 0x77ab2fff, 0x3f76e4ff, NO_OVERLAY},
+            {"stone_shore", STONE_SHORE, 0x8ab689ff, 0x6da36bff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"snowy_beach", SNOWY_BEACH, 0x83b593ff, 0x64a278ff, 0x3d57d6ff,
+             NO_OVERLAY},
+            {"forest", FOREST, 0x79c05aff, 0x59ae30ff, 0x3f76e4ff, NO_OVERLAY},
+            {"wooded_hills", WOODED_HILLS, 0x79c05aff, 0x59ae30ff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"flower_forest", FLOWER_FOREST, 0x79c05aff, 0x59ae30ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"birch_forest", BIRCH_FOREST, 0x88bb67ff, 0x6ba941ff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"birch_forest_hills", BIRCH_FOREST_HILLS, 0x88bb67ff, 0x6ba941ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"tall_birch_forest", TALL_BIRCH_FOREST, 0x88bb67ff, 0x6ba941ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"tall_birch_hills", TALL_BIRCH_HILLS, 0x88bb67ff, 0x6ba941ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"dark_forest", DARK_FOREST, 0x507a32ff, 0x59ae30ff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"dark_forest_hills", DARK_FOREST_HILLS, 0x507a32ff, 0x59ae30ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"jungle", JUNGLE, 0x59c93cff, 0x30bb0bff, 0x3f76e4ff,
+             overrides::JUNGLE},
+            {"jungle_hills", JUNGLE_HILLS, 0x59c93cff, 0x30bb0bff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"modified_jungle", MODIFIED_JUNGLE, 0x59c93cff, 0x30bb0bff,
+             0x3f76e4ff, overrides::JUNGLE},
+            {"jungle_edge", JUNGLE_EDGE, 0x64c73fff, 0x3eb80fff, 0x3f76e4ff,
+             overrides::JUNGLE},
+            {"modified_jungle_edge", MODIFIED_JUNGLE_EDGE, 0x64c73fff,
+             0x3eb80fff, 0x3f76e4ff, overrides::JUNGLE},
+            {"bamboo_jungle", BAMBOO_JUNGLE, 0x59c93cff, 0x30bb0bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"bamboo_jungle_hills", BAMBOO_JUNGLE_HILLS, 0x59c93cff,
+             0x30bb0bff, 0x3f76e4ff, NO_OVERLAY},
+            {"taiga", TAIGA, 0x86b783ff, 0x68a464ff, 0x3f76e4ff, NO_OVERLAY},
+            {"taiga_hills", TAIGA_HILLS, 0x86b783ff, 0x68a464ff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"taiga_mountains", TAIGA_MOUNTAINS, 0x86b783ff, 0x68a464ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"snowy_taiga", SNOWY_TAIGA, 0x80b497ff, 0x60a17bff, 0x3d57d6ff,
+             NO_OVERLAY},
+            {"snowy_taiga_hills", SNOWY_TAIGA_HILLS, 0x80b497ff, 0x60a17bff,
+             0x3d57d6ff, NO_OVERLAY},
+            {"snowy_taiga_mountains", SNOWY_TAIGA_MOUNTAINS, 0x80b497ff,
+             0x60a17bff, 0x3d57d6ff, NO_OVERLAY},
+            {"giant_tree_taiga", GIANT_TREE_TAIGA, 0x86b87fff, 0x68a55fff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"giant_tree_taiga_hills", GIANT_TREE_TAIGA_HILLS, 0x86b87fff,
+             0x68a55fff, 0x3f76e4ff, NO_OVERLAY},
+            {"giant_spruce_taiga", GIANT_SPRUCE_TAIGA, 0x86b783ff, 0x68a464ff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"giant_spruce_taiga_hills", GIANT_SPRUCE_TAIGA_HILLS, 0x86b783ff,
+             0x68a464ff, 0x3f76e4ff, NO_OVERLAY},
+            {"mushroom_fields", MUSHROOM_FIELDS, 0x55c93fff, 0x2bbb0fff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"mushroom_field_shore", MUSHROOM_FIELD_SHORE, 0x55c93fff,
+             0x2bbb0fff, 0x3f76e4ff, NO_OVERLAY},
+            {"swamp", SWAMP, 0x6a7039ff, 0x6a7039ff, 0x617b64ff,
+             overrides::SWAMP},
+            {"swamp_hills", SWAMP_HILLS, 0x6a7039ff, 0x6a7039ff, 0x617b64ff,
+             overrides::SWAMP},
+            {"savanna", SAVANNA, 0xbfb755ff, 0xaea42aff, 0x3f76e4ff,
+             overrides::SAVANNA},
+            {"savanna_plateau", SAVANNA_PLATEAU, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"shattered_savanna", SHATTERED_SAVANNA, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, overrides::SAVANNA},
+            {"shattered_savanna_plateau", SHATTERED_SAVANNA_PLATEAU,
+             0xbfb755ff, 0xaea42aff, 0x3f76e4ff, NO_OVERLAY},
+            {"plains", PLAINS, 0x91bd59ff, 0x77ab2fff, 0x3f76e4ff, NO_OVERLAY},
+            {"sunflower_plains", SUNFLOWER_PLAINS, 0x91bd59ff, 0x77ab2fff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"desert", DESERT, 0xbfb755ff, 0xaea42aff, 0x3f76e4ff, NO_OVERLAY},
+            {"desert_hills", DESERT_HILLS, 0xbfb755ff, 0xaea42aff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"desert_lakes", DESERT_LAKES, 0xbfb755ff, 0xaea42aff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"snowy_tundra", SNOWY_TUNDRA, 0x80b497ff, 0x60a17bff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"snowy_mountains", SNOWY_MOUNTAINS, 0x80b497ff, 0x60a17bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"ice_spikes", ICE_SPIKES, 0x80b497ff, 0x60a17bff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"mountains", MOUNTAINS, 0x8ab689ff, 0x6da36bff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"wooded_mountains", WOODED_MOUNTAINS, 0x8ab689ff, 0x6da36bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"gravelly_mountains", GRAVELLY_MOUNTAINS, 0x8ab689ff, 0x6da36bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"modified_gravelly_mountains", MODIFIED_GRAVELLY_MOUNTAINS,
+             0x8ab689ff, 0x6da36bff, 0x3f76e4ff, NO_OVERLAY},
+            {"mountain_edge", MOUNTAIN_EDGE, 0x8ab689ff, 0x6da36bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"badlands", BADLANDS, 0x90814dff, 0x9e814dff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"badlands_plateau", BADLANDS_PLATEAU, 0x90814dff, 0x9e814dff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"modified_badlands_plateau", MODIFIED_BADLANDS_PLATEAU,
+             0x90814dff, 0x9e814dff, 0x3f76e4ff, NO_OVERLAY},
+            {"wooded_badlands_plateau", WOODED_BADLANDS_PLATEAU, 0x90814dff,
+             0x9e814dff, 0x3f76e4ff, NO_OVERLAY},
+            {"modified_wooded_badlands_plateau",
+             MODIFIED_WOODED_BADLANDS_PLATEAU, 0x90814dff, 0x9e814dff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"eroded_badlands", ERODED_BADLANDS, 0x90814dff, 0x9e814dff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"nether_wastes", NETHER_WASTES, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"crimson_forest", CRIMSON_FOREST, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"warped_forest", WARPED_FOREST, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"soul_sand_valley", SOUL_SAND_VALLEY, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"basalt_deltas", BASALT_DELTAS, 0xbfb755ff, 0xaea42aff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"the_end", THE_END, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"small_end_islands", SMALL_END_ISLANDS, 0x8eb971ff, 0x71a74dff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"end_midlands", END_MIDLANDS, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"end_highlands", END_HIGHLANDS, 0x8eb971ff, 0x71a74dff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"end_barrens", END_BARRENS, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"the_void", THE_VOID, 0x8eb971ff, 0x71a74dff, 0x3f76e4ff,
+             NO_OVERLAY},
+
+            {"meadow", PLAINS, 0x83bb6dff, 0x63a948ff, 0x0e4ecfff,
+             NO_OVERLAY},
+            {"grove", SNOWY_TAIGA, 0x80b497ff, 0x60a17bff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"snowy_slopes", SNOWY_MOUNTAINS, 0x80b497ff, 0x60a17bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"frozen_peaks", SNOWY_MOUNTAINS, 0x80b497ff, 0x60a17bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"jagged_peaks", SNOWY_MOUNTAINS, 0x80b497ff, 0x60a17bff,
+             0x3f76e4ff, NO_OVERLAY},
+            {"stony_peaks", MOUNTAINS, 0x9abe4bff, 0x82ac1eff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"dripstone_caves", PLAINS, 0x91bd59ff, 0x77ab2fff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"lush_caves", PLAINS, 0x91bd59ff, 0x77ab2fff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"deep_dark", PLAINS, 0x91bd59ff, 0x77ab2fff, 0x3f76e4ff,
+             NO_OVERLAY},
+            {"mangrove_swamp", SWAMP, 0x6a7039ff, 0x8db127ff, 0x3a7a6aff,
+             overrides::SWAMP},
+            {"cherry_grove", FLOWER_FOREST, 0xb6db61ff, 0xb6db61ff,
+             0x5db7efff, NO_OVERLAY},
+            {"pale_garden", DARK_FOREST, 0x778272ff, 0x878d76ff, 0x76889dff,
+             NO_OVERLAY},
+        });
+        static_assert(table.size() <= 256, "Too many biomes for biome_index");
+        static_assert(table[PLAINS_INDEX].name == "plains",
+                      "PLAINS_INDEX is not of plains");
+
+        /* Biomes renamed in 1.18, with their names before. */
+        constexpr auto renames =
+            std::to_array<std::pair<std::string_view, std::string_view>>({
+                {"stony_shore", "stone_shore"},
+                {"old_growth_birch_forest", "tall_birch_forest"},
+                {"sparse_jungle", "jungle_edge"},
+                {"old_growth_pine_taiga", "giant_tree_taiga"},
+                {"old_growth_spruce_taiga", "giant_spruce_taiga"},
+                {"windswept_savanna", "shattered_savanna"},
+                {"snowy_plains", "snowy_tundra"},
+                {"windswept_hills", "mountains"},
+                {"windswept_forest", "wooded_mountains"},
+                {"windswept_gravelly_hills", "gravelly_mountains"},
+                {"wooded_badlands", "wooded_badlands_plateau"},
+            });
+
+        using name_entry = std::pair<std::string_view, biome_index>;
+
+        /* Names of biomes and renamed ones, sorted to be searched. Built
+           at compile time, so that it is usable until the very end of the
+           program, e.g. by workers drained from atexit handlers. */
+        constexpr auto by_name = [] {
+            std::array<name_entry, table.size() + renames.size()> result{};
+            for (std::size_t i = 0; i < table.size(); ++i) {
+                result[i] = {table[i].name, static_cast<biome_index>(i)};
+            }
+            for (std::size_t i = 0; i < renames.size(); ++i) {
+                auto old = std::ranges::find(table, renames[i].second,
+                                             &biome_info::name);
+                result[table.size() + i] = {
+                    renames[i].first,
+                    static_cast<biome_index>(old - table.begin())};
+            }
+            std::ranges::sort(result);
+            return result;
+        }();
+        static_assert(std::ranges::all_of(by_name,
+                                          [](name_entry const &entry) {
+                                              return entry.second <
+                                                     table.size();
+                                          }),
+                      "Renamed biome is not in the table");
+    } // namespace
+
+    auto biome_table() -> std::span<biome_info const> { return table; }
+
+    auto find_biome(std::string_view name) -> biome_index {
+        constexpr std::string_view prefix = "minecraft:";
+        if (name.starts_with(prefix)) {
+            name.remove_prefix(prefix.size());
+        }
+        auto itr =
+            std::ranges::lower_bound(by_name, name, {}, &name_entry::first);
+        return itr == by_name.end() || itr->first != name ? 0 : itr->second;
+    }
+
+    auto find_biome(std::int32_t id) -> biome_index {
+        constexpr std::size_t n_ids = 256;
+        static std::array<biome_index, n_ids> const by_id = [] {
+            std::array<biome_index, n_ids> result{};
+            /* Backwards, so that IDs shared with newer biomes map to the
+               biomes before 1.18. */
+            for (std::size_t i = table.size(); i-- > 0;) {
+                result[table[i].id] = i;
+            }
+            return result;
+        }();
+
+        if (id < 0 || n_ids <= static_cast<std::size_t>(id)) {
+            return 0;
+        }
+        return by_id[id];
+    }
+} // namespace pixel_terrain::nbt::biomes
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef NBT_BIOMES_HH
+#define NBT_BIOMES_HH
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace pixel_terrain::nbt::biomes {
+    /* A biome of the game, and colors blocks are tinted with in it.
+       Colors are RGBA. */
+    struct biome_info {
+        /* Name without namespace. */
+        std::string_view name;
+        /* Numeric ID in chunks before 1.18. Biomes added since then have
+           the ID of the closest older one. */
+        std::int32_t id;
+        std::uint32_t grass;
+        std::uint32_t foliage;
+        std::uint32_t water;
+        /* Color blended into biome-dependent blocks, 0 if none. */
+        std::uint32_t overlay;
+    };
+
+    /* Index of a biome in biome_table(). Index 0 is ocean, which unknown
+       biomes are taken as. */
+    using biome_index = std::uint8_t;
+
+    /* Index of plains, whose colors blocks are drawn with by default. */
+    inline constexpr biome_index PLAINS_INDEX = 49;
+
+    auto biome_table() -> std::span<biome_info const>;
+
+    /* Index of biome NAME, with or without the "minecraft:" namespace.
+       Names before 1.18 are accepted too. */
+    auto find_biome(std::string_view name) -> biome_index;
+
+    /* Index of the biome of numeric ID in chunks before 1.18. */
+    auto find_biome(std::int32_t id) -> biome_index;
+
+    /* Biomes of a chunk in cells of 4x4x4 blocks, which is the
+       resolution chunks store them in, or in columns for chunks before
+       1.15. */
+    class biome_grid {
+        int min_y_ = 0;
+        int layers_ = 0;
+        /* Log2 of the width of cells, 0 for columns. */
+        int cell_shift_ = 2;
+        /* In (layer * 4 + cell_z) * 4 + cell_x order, or z * 16 + x for
+           columns. */
+        std::vector<biome_index> cells_;
+
+    public:
+        static constexpr int CELL_WIDTH = 4;
+        static constexpr int CELLS_PER_LAYER = 16;
+        static constexpr int COLUMNS = 256;
+
+        biome_grid() = default;
+
+        /* Grid of LAYERS layers of cells from block Y = MIN_Y, all
+           ocean. */
+        biome_grid(int min_y, int layers)
+            : min_y_(min_y), layers_(layers),
+              cells_(static_cast<std::size_t>(layers) * CELLS_PER_LAYER, 0) {
+        }
+
+        /* Grid of a biome for each column, all ocean. */
+        static auto columns() -> biome_grid {
+            biome_grid grid;
+            grid.layers_ = 1;
+            grid.cell_shift_ = 0;
+            grid.cells_.assign(COLUMNS, 0);
+            return grid;
+        }
+
+        /* Cells from the bottom, in the order above. */
+        auto cells() -> std::span<biome_index> { return cells_; }
+
+        /* Biome at block (X, Y, Z) of the chunk. Y above or below the
+           grid takes the nearest layer, as the game does. */
+        [[nodiscard]] auto at(int x, int y, int z) const -> biome_index {
+            if (layers_ == 0) {
+                return 0;
+            }
+            int layer = (y - min_y_) >> 2;
+            if (layer < 0) {
+                layer = 0;
+            } else if (layer >= layers_) {
+                layer = layers_ - 1;
+            }
+            int row = (CELL_WIDTH * CELL_WIDTH) >> cell_shift_;
+            return cells_[(layer * row + (z >> cell_shift_)) * row +
+                          (x >> cell_shift_)];
+        }
+    };
+} // namespace pixel_terrain::nbt::biomes
+
+#endif
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MIT
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "nbt/biomes.hh"
+#include "nbt/constants.hh"
+
+using namespace pixel_terrain::nbt::biomes;
+
+BOOST_AUTO_TEST_CASE(find_by_name) {
+    auto table = biome_table();
+    BOOST_TEST(table[0].id == OCEAN);
+    BOOST_TEST(table[find_biome("minecraft:swamp")].id == SWAMP);
+    BOOST_TEST(table[find_biome("swamp")].id == SWAMP);
+    BOOST_TEST(table[find_biome("minecraft:cherry_grove")].name ==
+               "cherry_grove");
+    BOOST_TEST(find_biome("minecraft:no_such_biome") == 0);
+    BOOST_TEST(find_biome("other:swamp") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(find_renamed) {
+    BOOST_TEST(find_biome("minecraft:sparse_jungle") ==
+               find_biome("minecraft:jungle_edge"));
+    BOOST_TEST(find_biome("minecraft:windswept_savanna") ==
+               find_biome(SHATTERED_SAVANNA));
+}
+
+BOOST_AUTO_TEST_CASE(find_by_id) {
+    auto table = biome_table();
+    BOOST_TEST(table[find_biome(JUNGLE)].name == "jungle");
+    /* Shared with mangrove_swamp added later. */
+    BOOST_TEST(table[find_biome(SWAMP)].name == "swamp");
+    BOOST_TEST(find_biome(-1) == 0);
+    BOOST_TEST(find_biome(1000) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(overlays) {
+    auto table = biome_table();
+    BOOST_TEST(table[find_biome("mangrove_swamp")].overlay ==
+               overrides::SWAMP);
+    BOOST_TEST(table[find_biome(JUNGLE_EDGE)].overlay == overrides::JUNGLE);
+    BOOST_TEST(table[find_biome(SAVANNA_PLATEAU)].overlay == 0);
+    BOOST_TEST(table[find_biome(PLAINS)].overlay == 0);
+}
+
+BOOST_AUTO_TEST_CASE(grid_lookup) {
+    biome_grid grid(-64, 8);
+    auto cells = grid.cells();
+    BOOST_TEST(cells.size() == 8U * biome_grid::CELLS_PER_LAYER);
+    cells[0] = 3;
+    cells[biome_grid::CELLS_PER_LAYER + 5] = 4;
+    cells[7 * biome_grid::CELLS_PER_LAYER + 15] = 5;
+
+    BOOST_TEST(grid.at(3, -64, 3) == 3);
+    BOOST_TEST(grid.at(0, -1000, 0) == 3);
+    BOOST_TEST(grid.at(4, -60, 4) == 4);
+    BOOST_TEST(grid.at(7, -57, 7) == 4);
+    BOOST_TEST(grid.at(15, -33, 15) == 5);
+    BOOST_TEST(grid.at(15, 300, 15) == 5);
+    BOOST_TEST(biome_grid().at(0, 0, 0) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(column_lookup) {
+    biome_grid grid = biome_grid::columns();
+    auto cells = grid.cells();
+    BOOST_TEST(cells.size() == std::size_t{biome_grid::COLUMNS});
+    cells[1] = 3;
+    cells[15 * 16 + 14] = 4;
+
+    BOOST_TEST(grid.at(1, 0, 0) == 3);
+    BOOST_TEST(grid.at(1, -64, 0) == 3);
+    BOOST_TEST(grid.at(1, 300, 0) == 3);
+    BOOST_TEST(grid.at(0, 0, 0) == 0);
+    BOOST_TEST(grid.at(2, 0, 0) == 0);
+    BOOST_TEST(grid.at(14, 70, 15) == 4);
+    BOOST_TEST(grid.at(15, 70, 15) == 0);
+}
@@ -4,34 +4,99 @@
    This implementation based on matcool/anvil-parser with
    performance tuning and biome support. */
 
-#include <cmath>
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
+#include <cstring>
 #include <exception>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "nbt/biomes.hh"
 #include "nbt/chunk.hh"
 #include "nbt/constants.hh"
+#include "nbt/section.hh"
 #if USE_V3_NBT_PARSER
+#include "nbt/nbt-path.hh"
 #include "nbt/nbt.hh"
 #include "nbt/tag.hh"
+#include "nbt/utils.hh"
 #else
 #include "nbt/pull_parser/nbt_pull_parser.hh"
 #endif
 
 namespace pixel_terrain::anvil {
+    namespace {
+        std::string const air_block = "minecraft:air";
+
+        /* Grid of Biomes of chunks before 1.18, which have a biome for
+           each cell from Y = 0, or for each column before 1.15. */
+        auto level_biome_grid(std::vector<std::int32_t> const &ids)
+            -> nbt::biomes::biome_grid {
+            using nbt::biomes::biome_grid;
+
+            biome_grid grid;
+            if (ids.size() == nbt::biomes::BIOME_DATA_NEW_VERSION_SIZE) {
+                grid = biome_grid(0, static_cast<int>(ids.size()) /
+                                         biome_grid::CELLS_PER_LAYER);
+            } else if (ids.size() ==
+                       nbt::biomes::BIOME_DATA_OLD_VERSION_SIZE) {
+                grid = biome_grid::columns();
+            } else {
+                return {};
+            }
+            std::ranges::transform(ids, grid.cells().begin(),
+                                   [](std::int32_t id) {
+                                       return nbt::biomes::find_biome(id);
+                                   });
+            return grid;
+        }
+    } // namespace
+
 #if USE_V3_NBT_PARSER
-    chunk::chunk(std::vector<std::uint8_t> const &data) {
-        palettes.fill(nullptr);
-        block_states.fill(nullptr);
+    namespace {
+        /* Tags read by index_sections() and init_fields(). Others, such
+           as entities, are skipped without being decoded. Sections are
+           only located, and indexed by index_sections() from there. */
+        nbt::nbt_selection const chunk_selection(
+            {
+                nbt::nbt_path::compile("//DataVersion"),
+                nbt::nbt_path::compile("//yPos"),
+                nbt::nbt_path::compile("//Level/LastUpdate"),
+                nbt::nbt_path::compile("//Level/Biomes"),
+                nbt::nbt_path::compile("//Level/Heightmaps/WORLD_SURFACE"),
+                nbt::nbt_path::compile("//Level/Heightmaps/MOTION_BLOCKING"),
+                nbt::nbt_path::compile("//LastUpdate"),
+                nbt::nbt_path::compile("//Heightmaps/WORLD_SURFACE"),
+                nbt::nbt_path::compile("//Heightmaps/MOTION_BLOCKING"),
+            },
+            {
+                nbt::nbt_path::compile("//Level/Sections"),
+                nbt::nbt_path::compile("//sections"),
+            });
+
+        /* Raw paths of chunk_selection, in the order above. */
+        constexpr std::size_t LEVEL_SECTIONS = 0;
+        constexpr std::size_t ROOT_SECTIONS = 1;
+    } // namespace
+
+    chunk::chunk(std::span<std::uint8_t const> data) {
+        heightmaps_.fill(nullptr);
 
-        auto *nbt_file = nbt::nbt::from_iterator(data.begin(), data.end());
+        auto *nbt_file = nbt::nbt::from_buffer(data, chunk_selection);
         if (nbt_file == nullptr) {
             throw chunk_parse_error("Parse error");
         }
         try {
+            index_sections(*nbt_file);
             init_fields(*nbt_file);
         } catch (...) {
             delete nbt_file;
@@ -43,8 +108,22 @@ namespace pixel_terrain::anvil {
     chunk::chunk(std::vector<std::uint8_t> *data)
         : parser(nbt::nbt_pull_parser(data->data(), data->size())),
           chunk_data_(data) {
-        palettes.fill(nullptr);
-        block_states.fill(nullptr);
+        /* Only the level layout is read here, whose sections are at
+           Y = 0 to 15. */
+        palettes.resize(nbt::biomes::PALETTE_Y_MAX, nullptr);
+        block_states.resize(nbt::biomes::PALETTE_Y_MAX, nullptr);
+        sections_.resize(nbt::biomes::PALETTE_Y_MAX, nullptr);
+#if USE_BLOCK_LIGHT_DATA
+        block_lights_.resize(nbt::biomes::PALETTE_Y_MAX);
+#endif
+        heightmaps_.fill(nullptr);
+
+        /* Chunks of 1.18 onward have no Level/Sections; reject them here,
+           where callers expect chunk errors, rather than on first use. */
+        if (!parse_field_if_exists(FIELD_SECTIONS)) {
+            delete chunk_data_;
+            throw not_generated_chunk_error("Sections data not found");
+        }
     }
 #endif
 
@@ -58,143 +137,436 @@ namespace pixel_terrain::anvil {
         for (std::vector<std::uint64_t> *e : block_states) {
             delete e;
         }
+        for (section_indices *e : sections_) {
+            delete e;
+        }
+        for (heightmap *e : heightmaps_) {
+            delete e;
+        }
     }
 
 #if USE_V3_NBT_PARSER
     namespace {
-        auto const sections_path =
-            nbt::nbt_path::compile("//Level/Sections").set_ignore_empty_list();
-        auto const last_update_path =
-            nbt::nbt_path::compile("//Level/LastUpdate")
-                .set_ignore_empty_list();
-        auto const y_path =
-            nbt::nbt_path::compile("/Y").set_ignore_empty_list();
-        auto const block_states_path =
-            nbt::nbt_path::compile("/BlockStates").set_ignore_empty_list();
-        auto const palette_path =
-            nbt::nbt_path::compile("/Palette").set_ignore_empty_list();
-#if USE_BLOCK_LIGHT_DATA
-        auto const block_light_path =
-            nbt::nbt_path::compile("/BlockLight").set_ignore_empty_list();
-#endif
-        auto const name_path =
-            nbt::nbt_path::compile("/Name").set_ignore_empty_list();
-        auto const biomes_path =
-            nbt::nbt_path::compile("//Level/Biomes").set_ignore_empty_list();
-        auto const data_version_path =
-            nbt::nbt_path::compile("//DataVersion").set_ignore_empty_list();
+        auto path(std::string const &expr) -> nbt::nbt_path {
+            return nbt::nbt_path::compile(expr).set_ignore_empty_list();
+        }
+
+        /* Paths below are indexed by chunk::layout, LEVEL first. */
+        std::array<nbt::nbt_path, 2> const last_update_paths = {
+            path("//Level/LastUpdate"),
+            path("//LastUpdate"),
+        };
+        auto const biomes_path = path("//Level/Biomes");
+        auto const data_version_path = path("//DataVersion");
+        auto const y_pos_path = path("//yPos");
+        std::array<std::array<nbt::nbt_path, 2>, 2> const heightmap_paths = {{
+            {path("//Level/Heightmaps/WORLD_SURFACE"),
+             path("//Level/Heightmaps/MOTION_BLOCKING")},
+            {path("//Heightmaps/WORLD_SURFACE"),
+             path("//Heightmaps/MOTION_BLOCKING")},
+        }};
     } // namespace
 
-#if USE_BLOCK_LIGHT_DATA
-    auto decode_nibble(std::vector<std::uint8_t> input)
-        -> std::vector<std::uint8_t> {
-        std::vector<uint8_t> result;
-        for (auto const &e : input) {
-            result.push_back(e & 0xf);
-            result.push_back(e >> 4);
+    namespace {
+        using data_iterator = nbt::tag::data_iterator;
+
+        /* Calls VISIT with the type, name and payload of each child of the
+           compound payload at FIRST. VISIT returns the end of the payload
+           if it read it, or nullopt to have it skipped. Returns the end of
+           the compound. */
+        template <class Visitor>
+        auto visit_compound(data_iterator first, data_iterator last,
+                            Visitor visit) -> data_iterator {
+            data_iterator itr = first;
+            for (;;) {
+                if (last <= itr) {
+                    throw chunk_parse_error("Parse error");
+                }
+                if (static_cast<nbt::tag_type>(*itr) ==
+                    nbt::tag_type::TAG_END) {
+                    return itr + 1;
+                }
+
+                auto [hdr, payload] = nbt::parse_type_and_name(itr, last);
+                if (!hdr) {
+                    throw chunk_parse_error("Parse error");
+                }
+                std::optional<data_iterator> end =
+                    visit(hdr->first, hdr->second, payload);
+                if (!end) {
+                    end = nbt::skip_payload(hdr->first, payload, last);
+                    if (!end) {
+                        throw chunk_parse_error("Parse error");
+                    }
+                }
+                itr = *end;
+            }
         }
-        return result;
-    }
-#endif
 
-    void chunk::init_fields(nbt::nbt const &nbt_file) noexcept(false) {
-        auto *sections_node =
-            nbt_file.query<nbt::tag_list_payload>(sections_path);
-        if (sections_node == nullptr) {
-            throw not_generated_chunk_error("Sections data not found");
+        /* Longs of the long array payload DATA, which may be empty if the
+           array is missing. */
+        auto read_long_array(std::span<std::uint8_t const> data)
+            -> std::vector<std::uint64_t> {
+            std::vector<std::uint64_t> result;
+            if (data.size() < sizeof(std::uint32_t)) {
+                return result;
+            }
+            result.resize((data.size() - sizeof(std::uint32_t)) /
+                          sizeof(std::uint64_t));
+            data_iterator itr = data.data() + sizeof(std::uint32_t);
+            for (std::uint64_t &e : result) {
+                std::memcpy(&e, itr, sizeof(e));
+                e = nbt::utils::to_host_byte_order(e);
+                itr += sizeof(e);
+            }
+            return result;
         }
-        if (sections_node->payload_type() != nbt::tag_type::TAG_COMPOUND) {
-            nbt::tag_type got_type = sections_node->payload_type();
-            delete sections_node;
-            throw broken_chunk_error("Invalid Sections data type: " +
-                                     nbt::tag_type_repr(got_type));
+
+        /* List header at FIRST, which must fit before LAST. */
+        auto list_header(data_iterator first)
+            -> std::pair<nbt::tag_type, std::uint32_t> {
+            std::int32_t len;
+            std::memcpy(&len, first + 1, sizeof(len));
+            return std::make_pair(
+                static_cast<nbt::tag_type>(*first),
+                static_cast<std::uint32_t>(
+                    nbt::utils::to_host_byte_order(len)));
         }
-        for (std::size_t i = 0, E = (*sections_node)->size(); i < E; ++i) {
-            auto *node = sections_node->get<nbt::tag_compound_payload>(i);
+    } // namespace
 
-            auto *y_node = node->query<nbt::tag_byte_payload>(y_path);
-            if (y_node == nullptr) {
-                continue;
+    void chunk::index_sections(nbt::nbt const &nbt_file) {
+        auto read_int =
+            [&](nbt::nbt_path const &path) -> std::optional<std::int32_t> {
+            auto *node = nbt_file.query<nbt::tag_int_payload>(path);
+            if (node == nullptr) {
+                return std::nullopt;
+            }
+            std::int32_t result = **node;
+            delete node;
+            return result;
+        };
+        auto read_list = [&](std::size_t index)
+            -> std::optional<std::span<std::uint8_t const>> {
+            nbt::raw_tag const &tag = nbt_file.raw(index);
+            if (tag.type != nbt::tag_type::TAG_LIST) {
+                return std::nullopt;
             }
+            return tag.payload;
+        };
+
+        std::optional<std::int32_t> version = read_int(data_version_path);
+        std::optional<std::int32_t> min_section = read_int(y_pos_path);
+
+        std::optional<std::span<std::uint8_t const>> sections =
+            read_list(LEVEL_SECTIONS);
+        int max_section = std::numeric_limits<std::int8_t>::max();
+        if (version &&
+            *version >= nbt::biomes::ROOT_SECTIONS_DATA_VERSION_THRESHOLD) {
+            layout_ = layout::ROOT;
+            sections = read_list(ROOT_SECTIONS);
+        } else {
+            /* Worlds before 1.18 span Y = 0 to 255. */
+            min_section = 0;
+            max_section = nbt::biomes::PALETTE_Y_MAX - 1;
+        }
+        if (!sections) {
+            throw not_generated_chunk_error("Sections data not found");
+        }
 
-            /* TODO: y can be negative because negative Y is allowed in current
-             * version. */
-            std::uint8_t y = **y_node;
-            delete y_node;
+        auto [element_type, len] = list_header(sections->data());
+        if (element_type == nbt::tag_type::TAG_END && len == 0) {
+            /* Empty list, same as missing. */
+            throw not_generated_chunk_error("Sections data not found");
+        }
+        if (element_type != nbt::tag_type::TAG_COMPOUND) {
+            throw broken_chunk_error("Invalid Sections data type: " +
+                                     nbt::tag_type_repr(element_type));
+        }
 
-            if (16 <= y) {
-                /* Out of range. */
-                continue;
-            }
+        std::vector<std::pair<int, raw_section>> found;
+        data_iterator last = sections->data() + sections->size();
+        data_iterator itr = sections->data() + 1 + sizeof(std::uint32_t);
+        for (std::uint32_t i = 0; i < len; ++i) {
+            itr = index_section(itr, last, &found);
+        }
 
-            auto *block_states_node =
-                node->query<nbt::tag_long_array_payload>(block_states_path);
-            if (block_states_node == nullptr) {
-                /* If there's no BlockStates, there's no way to
-                   refer to Palette, so we continue here. */
-                continue;
+        /* Sections below the world only carry light, as do the ones
+           above it. */
+        if (!min_section) {
+            min_section = 0;
+            for (auto const &[y, section] : found) {
+                min_section = std::min(*min_section, y);
             }
-            auto *states = new std::vector<std::uint64_t>;
-            for (std::uint64_t state : **block_states_node) {
-                states->push_back(state);
+        }
+        min_section_ = *min_section;
+        auto in_world = [&](int y) {
+            return min_section_ <= y && y <= max_section;
+        };
+        int count = 0;
+        for (auto const &[y, section] : found) {
+            if (in_world(y)) {
+                count = std::max(count, y - min_section_ + 1);
             }
-            block_states[static_cast<std::size_t>(y)] = states;
-            delete block_states_node;
-
-            auto *palette_node =
-                node->query<nbt::tag_list_payload>(palette_path);
-            if (palette_node == nullptr ||
-                palette_node->payload_type() != nbt::tag_type::TAG_COMPOUND) {
-                delete palette_node;
-                continue;
+        }
+
+        raw_sections_.resize(count);
+        for (auto const &[y, section] : found) {
+            if (in_world(y)) {
+                raw_sections_[y - min_section_] = section;
             }
+        }
+        palettes.resize(count, nullptr);
+        block_states.resize(count, nullptr);
+        sections_.resize(count, nullptr);
+#if USE_BLOCK_LIGHT_DATA
+        block_lights_.resize(count);
+#endif
+    }
 
-            auto *palette = new std::vector<std::string>;
-            for (std::size_t j = 0, F = (*palette_node)->size(); j < F; ++j) {
-                auto *element_node =
-                    palette_node->get<nbt::tag_compound_payload>(j);
-                auto *name_node =
-                    element_node->query<nbt::tag_string_payload>(name_path);
-                if (name_node == nullptr) {
-                    continue;
+    auto chunk::index_section(data_iterator first, data_iterator last,
+                              std::vector<std::pair<int, raw_section>> *found)
+        -> data_iterator {
+        std::size_t mark = raw_data_.size();
+        auto copy = [&](data_iterator payload_first,
+                        data_iterator payload_last) -> raw_payload {
+            raw_payload result{raw_data_.size(),
+                               static_cast<std::size_t>(payload_last -
+                                                        payload_first)};
+            raw_data_.insert(raw_data_.end(), payload_first, payload_last);
+            return result;
+        };
+        auto is_list_of = [](data_iterator payload, nbt::tag_type type) {
+            return static_cast<nbt::tag_type>(*payload) == type;
+        };
+
+        std::optional<int> y;
+        raw_section section;
+        /* Palette and packed indices, nested in the root layout. */
+        auto visit_paletted = [&](raw_payload *palette, raw_payload *data,
+                                  nbt::tag_type element_type) {
+            return [=, &copy](nbt::tag_type type, std::string_view name,
+                              data_iterator payload)
+                       -> std::optional<data_iterator> {
+                auto payload_end = nbt::skip_payload(type, payload, last);
+                if (!payload_end) {
+                    throw chunk_parse_error("Parse error");
+                }
+                if (type == nbt::tag_type::TAG_LIST && name == "palette" &&
+                    is_list_of(payload, element_type)) {
+                    *palette = copy(payload, *payload_end);
+                } else if (type == nbt::tag_type::TAG_LONG_ARRAY &&
+                           name == "data") {
+                    *data = copy(payload, *payload_end);
+                }
+                return payload_end;
+            };
+        };
+        data_iterator end = visit_compound(
+            first, last,
+            [&](nbt::tag_type type, std::string_view name,
+                data_iterator payload) -> std::optional<data_iterator> {
+                if (layout_ == layout::ROOT &&
+                    type == nbt::tag_type::TAG_COMPOUND) {
+                    if (name == "block_states") {
+                        return visit_compound(
+                            payload, last,
+                            visit_paletted(&section.palette,
+                                           &section.block_states,
+                                           nbt::tag_type::TAG_COMPOUND));
+                    }
+                    if (name == "biomes") {
+                        return visit_compound(
+                            payload, last,
+                            visit_paletted(&section.biome_palette,
+                                           &section.biome_data,
+                                           nbt::tag_type::TAG_STRING));
+                    }
                 }
-                palette->push_back(**name_node);
-                delete name_node;
-            }
-            palettes[static_cast<std::size_t>(y)] = palette;
 
-            delete palette_node;
+                auto payload_end = nbt::skip_payload(type, payload, last);
+                if (!payload_end) {
+                    throw chunk_parse_error("Parse error");
+                }
 
+                if (type == nbt::tag_type::TAG_BYTE && name == "Y") {
+                    y = static_cast<std::int8_t>(*payload);
+                } else if (layout_ == layout::LEVEL &&
+                           type == nbt::tag_type::TAG_LONG_ARRAY &&
+                           name == "BlockStates") {
+                    section.block_states = copy(payload, *payload_end);
+                } else if (layout_ == layout::LEVEL &&
+                           type == nbt::tag_type::TAG_LIST &&
+                           name == "Palette" &&
+                           is_list_of(payload, nbt::tag_type::TAG_COMPOUND)) {
+                    section.palette = copy(payload, *payload_end);
+                }
 #if USE_BLOCK_LIGHT_DATA
-            auto *block_light_node =
-                node->query<nbt::tag_byte_array_payload>(block_light_path);
-            if (block_light_node != nullptr) {
-                if ((*block_light_node)->size() == 2048) {
-                    std::vector<std::uint8_t> nibbles =
-                        decode_nibble(**block_light_node);
-                    block_lights_[y] = std::move(nibbles);
+                else if (type == nbt::tag_type::TAG_BYTE_ARRAY &&
+                         name == "BlockLight" &&
+                         *payload_end - payload ==
+                             sizeof(std::uint32_t) + 2048) {
+                    section.block_light = copy(payload, *payload_end);
                 }
-                delete block_light_node;
-            }
 #endif
+                return payload_end;
+            });
+
+        /* There's no way to refer to Palette without BlockStates in the
+           level layout, while the root layout omits data of uniform
+           sections. */
+        bool has_blocks = layout_ == layout::LEVEL
+                              ? section.block_states.size != 0
+                              : section.palette.size != 0;
+        if (!y || !has_blocks) {
+            raw_data_.resize(mark);
+            return end;
         }
-        delete sections_node;
+#if USE_BLOCK_LIGHT_DATA
+        if (section.palette.size == 0) {
+            section.block_light = raw_payload();
+        }
+#endif
+        found->emplace_back(*y, section);
+
+        return end;
+    }
+
+    auto chunk::raw_view(raw_payload const &payload) const
+        -> std::span<std::uint8_t const> {
+        return {raw_data_.data() + payload.offset, payload.size};
+    }
+
+    void chunk::decode_section(std::size_t slot) {
+        raw_section &raw = raw_sections_[slot];
+        if (raw.decoded) {
+            return;
+        }
+        raw.decoded = true;
+        if (raw.block_states.size == 0 && raw.palette.size == 0) {
+            return;
+        }
+
+        /* Empty if the root layout omits data of a uniform section. */
+        block_states[slot] = new std::vector<std::uint64_t>(
+            read_long_array(raw_view(raw.block_states)));
+
+        if (raw.palette.size == 0) {
+            return;
+        }
+
+        std::span<std::uint8_t const> palette_data = raw_view(raw.palette);
+        data_iterator last = palette_data.data() + palette_data.size();
+        std::uint32_t len = list_header(palette_data.data()).second;
+        data_iterator itr = palette_data.data() + 1 + sizeof(std::uint32_t);
+
+        auto *palette = new std::vector<std::string>;
+        palette->reserve(len);
+        for (std::uint32_t i = 0; i < len; ++i) {
+            bool named = false;
+            itr = visit_compound(
+                itr, last,
+                [&](nbt::tag_type type, std::string_view name,
+                    data_iterator payload) -> std::optional<data_iterator> {
+                    if (named || type != nbt::tag_type::TAG_STRING ||
+                        name != "Name") {
+                        return std::nullopt;
+                    }
+                    auto end = nbt::skip_payload(type, payload, last);
+                    if (!end) {
+                        throw chunk_parse_error("Parse error");
+                    }
+                    palette->emplace_back(
+                        reinterpret_cast<char const *>(payload) +
+                            sizeof(std::uint16_t),
+                        reinterpret_cast<char const *>(*end));
+                    named = true;
+                    return end;
+                });
+        }
+        palettes[slot] = palette;
+    }
+
+    void chunk::decode_biomes(std::size_t slot,
+                              std::span<nbt::biomes::biome_index> cells) {
+        raw_section const &raw = raw_sections_[slot];
+        if (raw.biome_palette.size == 0) {
+            return;
+        }
+
+        std::span<std::uint8_t const> palette_data =
+            raw_view(raw.biome_palette);
+        data_iterator last = palette_data.data() + palette_data.size();
+        std::uint32_t len = list_header(palette_data.data()).second;
+        data_iterator itr = palette_data.data() + 1 + sizeof(std::uint32_t);
+        std::vector<nbt::biomes::biome_index> ids;
+        ids.reserve(len);
+        for (std::uint32_t i = 0; i < len; ++i) {
+            auto end = nbt::skip_payload(nbt::tag_type::TAG_STRING, itr, last);
+            if (!end) {
+                throw chunk_parse_error("Parse error");
+            }
+            ids.push_back(nbt::biomes::find_biome(std::string_view(
+                reinterpret_cast<char const *>(itr) + sizeof(std::uint16_t),
+                reinterpret_cast<char const *>(*end))));
+            itr = *end;
+        }
+        if (ids.empty()) {
+            return;
+        }
+
+        std::array<std::uint16_t, nbt::biomes::BIOME_CELLS_PER_SECTION>
+            indices;
+        unsigned int bits =
+            std::max<unsigned int>(1, std::bit_width(ids.size() - 1));
+        unpack_indices(read_long_array(raw_view(raw.biome_data)), bits,
+                       false, ids.size(), indices.data(), indices.size());
+        for (std::size_t i = 0; i < indices.size(); ++i) {
+            cells[i] = ids[indices[i]];
+        }
+    }
+
+#if USE_BLOCK_LIGHT_DATA
+    auto decode_nibble(std::span<std::uint8_t const> input)
+        -> std::vector<std::uint8_t> {
+        std::vector<uint8_t> result;
+        for (auto const &e : input) {
+            result.push_back(e & 0xf);
+            result.push_back(e >> 4);
+        }
+        return result;
+    }
+
+    void chunk::decode_block_light(std::size_t slot) {
+        raw_payload const &raw = raw_sections_[slot].block_light;
+        if (raw.size == 0 || !block_lights_[slot].empty()) {
+            return;
+        }
+        block_lights_[slot] =
+            decode_nibble(raw_view(raw).subspan(sizeof(std::uint32_t)));
+    }
+#endif
+
+    void chunk::init_fields(nbt::nbt const &nbt_file) noexcept(false) {
+        auto l = static_cast<std::size_t>(layout_);
 
         auto *last_update_node =
-            nbt_file.query<nbt::tag_long_payload>(last_update_path);
+            nbt_file.query<nbt::tag_long_payload>(last_update_paths[l]);
         if (last_update_node == nullptr) {
             throw broken_chunk_error("LastUpdate data not found");
         }
         last_update = **last_update_node;
         delete last_update_node;
 
-        auto *biomes_node =
-            nbt_file.query<nbt::tag_int_array_payload>(biomes_path);
-        if (biomes_node == nullptr) {
-            throw broken_chunk_error("Biomes data not found");
+        /* Biomes are in each section in the root layout. */
+        if (layout_ == layout::LEVEL) {
+            auto *biomes_node =
+                nbt_file.query<nbt::tag_int_array_payload>(biomes_path);
+            if (biomes_node == nullptr) {
+                throw broken_chunk_error("Biomes data not found");
+            }
+            biomes.assign((*biomes_node)->begin(), (*biomes_node)->end());
+            delete biomes_node;
         }
-        biomes = **biomes_node;
-        delete biomes_node;
 
         auto *data_version_node =
             nbt_file.query<nbt::tag_int_payload>(data_version_path);
@@ -203,6 +575,18 @@ namespace pixel_terrain::anvil {
         }
         data_version = **data_version_node;
         delete data_version_node;
+
+        for (std::size_t i = 0; i < HEIGHTMAP_TYPE_COUNT; ++i) {
+            auto *heightmap_node = nbt_file.query<nbt::tag_long_array_payload>(
+                heightmap_paths[l][i]);
+            if (heightmap_node == nullptr) {
+                continue;
+            }
+            for (std::uint64_t e : **heightmap_node) {
+                heightmap_data_[i].push_back(e);
+            }
+            delete heightmap_node;
+        }
     }
 #endif
 
@@ -284,16 +668,7 @@ namespace pixel_terrain::anvil {
                                     /* parser_event::TAG_END */
                                     parser.next();
                                 } else {
-                                    for (int i = 1; i != 0;) {
-                                        ev = parser.next();
-                                        if (ev ==
-                                            nbt::parser_event::TAG_START) {
-                                            ++i;
-                                        } else if (ev ==
-                                                   nbt::parser_event::TAG_END) {
-                                            --i;
-                                        }
-                                    }
+                                    ev = parser.skip();
                                 }
                             }
                             ev = parser.next();
@@ -312,14 +687,7 @@ namespace pixel_terrain::anvil {
                     }
                 } else {
                     /* skip others because they aren't needed. */
-                    for (int i = 1; i != 0;) {
-                        ev = parser.next();
-                        if (ev == nbt::parser_event::TAG_START) {
-                            ++i;
-                        } else if (ev == nbt::parser_event::TAG_END) {
-                            --i;
-                        }
-                    }
+                    ev = parser.skip();
                 }
 
                 ev = parser.next();
@@ -345,6 +713,38 @@ namespace pixel_terrain::anvil {
         }
     }
 
+    void chunk::parse_heightmaps() {
+        if (parser.get_tag_type() != nbt::TAG_COMPOUND) {
+            throw std::runtime_error("Heightmaps is not TAG_Compound");
+        }
+        for (nbt::parser_event ev = parser.next();
+             ev != nbt::parser_event::TAG_END; ev = parser.next()) {
+            if (ev != nbt::parser_event::TAG_START) {
+                throw std::runtime_error("Broken Heightmaps");
+            }
+
+            std::vector<std::uint64_t> *dest = nullptr;
+            if (parser.get_tag_type() == nbt::TAG_LONG_ARRAY) {
+                if (parser.get_tag_name() == "WORLD_SURFACE") {
+                    dest = &heightmap_data_[static_cast<std::size_t>(
+                        heightmap_type::WORLD_SURFACE)];
+                } else if (parser.get_tag_name() == "MOTION_BLOCKING") {
+                    dest = &heightmap_data_[static_cast<std::size_t>(
+                        heightmap_type::MOTION_BLOCKING)];
+                }
+            }
+
+            if (dest != nullptr) {
+                for (; parser.next() == nbt::parser_event::DATA;) {
+                    dest->push_back(parser.get_long());
+                }
+            } else {
+                /* skip other heightmaps. */
+                ev = parser.skip();
+            }
+        }
+    }
+
     void chunk::parse_fields() {
         nbt::parser_event ev = parser.get_event_type();
         while (ev != nbt::parser_event::DOCUMENT_END) {
@@ -358,6 +758,11 @@ namespace pixel_terrain::anvil {
 
                     return;
                 }
+                if (f == FIELD_HEIGHTMAPS) {
+                    parse_heightmaps();
+
+                    return;
+                }
                 if (f == FIELD_LAST_UPDATE) {
                     ev = parser.next();
                     if (ev != nbt::parser_event::DATA ||
@@ -391,6 +796,11 @@ namespace pixel_terrain::anvil {
                     parser.next();
                     return;
                 }
+                if (!on_field_path()) {
+                    /* Entities and others contain no field. */
+                    ev = parser.skip();
+                    continue;
+                }
             } else if (ev == nbt::parser_event::TAG_END) {
                 tag_structure.pop_back();
             }
@@ -399,18 +809,22 @@ namespace pixel_terrain::anvil {
         }
     }
 
-    void chunk::make_sure_field_parsed(unsigned char field) noexcept(false) {
+    auto chunk::parse_field_if_exists(unsigned char field) -> bool {
         if ((loaded_fields & field) == 0) {
             do {
                 parse_fields();
             } while ((loaded_fields & field) == 0 &&
                      parser.get_event_type() !=
                          nbt::parser_event::DOCUMENT_END);
+        }
 
-            if ((loaded_fields & field) == 0) {
-                throw std::runtime_error("Tag not found: " +
-                                         std::to_string(field));
-            }
+        return (loaded_fields & field) != 0;
+    }
+
+    void chunk::make_sure_field_parsed(unsigned char field) noexcept(false) {
+        if (!parse_field_if_exists(field)) {
+            throw chunk_parse_error("Tag not found: " +
+                                    std::to_string(field));
         }
     }
 
@@ -431,121 +845,203 @@ namespace pixel_terrain::anvil {
                 result = FIELD_LAST_UPDATE;
             } else if (tag_structure[2] == "Biomes") {
                 result = FIELD_BIOMES;
+            } else if (tag_structure[2] == "Heightmaps") {
+                result = FIELD_HEIGHTMAPS;
             }
         }
         loaded_fields |= result;
 
         return result;
     }
+
+    auto chunk::on_field_path() const -> bool {
+        if (tag_structure.empty() || !tag_structure[0].empty()) {
+            return false;
+        }
+        return tag_structure.size() == 1 ||
+               (tag_structure.size() == 2 && tag_structure[1] == "Level");
+    }
 #endif // not USE_V3_NBT_PARSER
 
-    auto chunk::get_palette(unsigned char y) -> std::vector<std::string> * {
-        if (y >= nbt::biomes::PALETTE_Y_MAX) {
+    auto chunk::section_slot(int y) const -> std::optional<std::size_t> {
+        if (y < min_section_ ||
+            static_cast<std::size_t>(y - min_section_) >= palettes.size()) {
+            return std::nullopt;
+        }
+        return y - min_section_;
+    }
+
+    auto chunk::get_palette(int y) -> std::vector<std::string> * {
+        auto slot = section_slot(y);
+        if (!slot) {
             return nullptr;
         }
 
-#if !USE_V3_NBT_PARSER
+#if USE_V3_NBT_PARSER
+        decode_section(*slot);
+#else
         make_sure_field_parsed(FIELD_SECTIONS);
 #endif
 
-        return palettes[y];
+        return palettes[*slot];
     }
 
-    auto chunk::get_biome(int32_t x, int32_t y, int32_t z) -> int32_t {
-#if !USE_V3_NBT_PARSER
+    auto chunk::get_biomes() -> nbt::biomes::biome_grid const & {
+        if (biomes_decoded_) {
+            return biome_grid_;
+        }
+
+#if USE_V3_NBT_PARSER
+        if (layout_ == layout::ROOT) {
+            constexpr int layers = nbt::biomes::BLOCK_PER_SECTION /
+                                   nbt::biomes::biome_grid::CELL_WIDTH;
+            biome_grid_ = nbt::biomes::biome_grid(
+                get_min_height(),
+                static_cast<int>(raw_sections_.size()) * layers);
+            std::span<nbt::biomes::biome_index> cells = biome_grid_.cells();
+            for (std::size_t slot = 0; slot < raw_sections_.size(); ++slot) {
+                decode_biomes(
+                    slot,
+                    cells.subspan(slot * nbt::biomes::BIOME_CELLS_PER_SECTION,
+                                  nbt::biomes::BIOME_CELLS_PER_SECTION));
+            }
+            biomes_decoded_ = true;
+            return biome_grid_;
+        }
+#else
         make_sure_field_parsed(FIELD_BIOMES);
 #endif
 
-        if (biomes.size() == nbt::biomes::BIOME_DATA_OLD_VERSION_SIZE) {
-            return biomes[(z / 2) * 16 + (x / 2)]; // NOLINT
-        }
-        if (biomes.size() == nbt::biomes::BIOME_DATA_NEW_VERSION_SIZE) {
-            return biomes[(y / 64) * 256 + (z / 4) * 4 + (x / 4)]; // NOLINT
-        }
-        return 0;
+        biome_grid_ = level_biome_grid(biomes);
+        biomes_decoded_ = true;
+        return biome_grid_;
     }
 
-    auto chunk::get_block(int32_t x, int32_t y, int32_t z) -> std::string {
-        if (x < 0 || 15 < x || y < 0 || 255 < y || z < 0 || 15 < z) { // NOLINT
-            return "";
+    auto chunk::get_section(int y) -> std::uint16_t const * {
+        auto slot = section_slot(y);
+        if (!slot) {
+            return nullptr;
+        }
+        if (sections_[*slot] != nullptr) {
+            return sections_[*slot]->data();
         }
 
-#if !USE_V3_NBT_PARSER
+#if USE_V3_NBT_PARSER
+        decode_section(*slot);
+#else
         make_sure_field_parsed(FIELD_DATA_VERSION);
+        make_sure_field_parsed(FIELD_SECTIONS);
 #endif
 
-        unsigned char section_no = y / nbt::biomes::PALETTE_Y_MAX;
+        std::vector<std::string> *palette = palettes[*slot];
+        std::vector<std::uint64_t> *states = block_states[*slot];
+        if (palette == nullptr || palette->empty() || states == nullptr) {
+            return nullptr;
+        }
 
-        y %= nbt::biomes::PALETTE_Y_MAX;
+        auto *indices = new section_indices;
+        unpack_indices(
+            *states, block_state_bits(palette->size()),
+            data_version < nbt::biomes::NEED_STRETCH_DATA_VERSION_THRESHOLD,
+            palette->size(), indices->data(), indices->size());
+        sections_[*slot] = indices;
 
-        std::vector<std::string> *palette = palettes[section_no];
-        if (palette == nullptr || palette->empty()) {
-            return "minecraft:air";
+        return indices->data();
+    }
+
+    auto chunk::get_uniform_block(int y) -> std::string const * {
+        auto slot = section_slot(y);
+        if (!slot) {
+            return &air_block;
         }
 
-        unsigned int bits = 4;
-        if (palette->size() - 1 > 15) { // NOLINT
-            bits = palette->size() - 1;
+#if USE_V3_NBT_PARSER
+        decode_section(*slot);
+#else
+        make_sure_field_parsed(FIELD_SECTIONS);
+#endif
 
-            /* calculate next squared number, in squared numbers larger than
-               BITS. if BITS is already squared in this step, calculate next
-               one. */
-            bits = bits | (bits >> 1);
-            bits = bits | (bits >> 2);
-            bits = bits | (bits >> 4);
-            bits = bits | (bits >> 8);  // NOLINT
-            bits = bits | (bits >> 16); // NOLINT
-            bits += 1;
+        std::vector<std::string> *palette = palettes[*slot];
+        if (palette == nullptr || palette->empty() ||
+            block_states[*slot] == nullptr) {
+            return &air_block;
+        }
+        if (palette->size() == 1) {
+            return &palette->front();
+        }
+        return nullptr;
+    }
 
-            bits = static_cast<int>(log2(bits));
+    auto chunk::get_heightmap(heightmap_type type) -> std::uint16_t const * {
+        auto i = static_cast<std::size_t>(type);
+        if (heightmaps_[i] != nullptr) {
+            return heightmaps_[i]->data();
         }
 
-        int index = y * 16 * 16 + z * 16 + x; // NOLINT
 #if !USE_V3_NBT_PARSER
-        make_sure_field_parsed(FIELD_SECTIONS);
+        make_sure_field_parsed(FIELD_DATA_VERSION);
+        if (!parse_field_if_exists(FIELD_HEIGHTMAPS)) {
+            return nullptr;
+        }
 #endif
-        std::vector<std::uint64_t> *states = block_states[section_no];
-        int state;
+
+        std::vector<std::uint64_t> const &data = heightmap_data_[i];
         bool stretches =
             data_version < nbt::biomes::NEED_STRETCH_DATA_VERSION_THRESHOLD;
-        if (stretches) {
-            state = index * bits / 64; // NOLINT
-        } else {
-            state = index / (64 / bits); // NOLINT
+        auto packed_size = [stretches](unsigned int bits) -> std::size_t {
+            std::size_t per_long = 64 / bits;
+            constexpr std::size_t size = nbt::biomes::HEIGHTMAP_SIZE;
+            return stretches ? (size * bits + 63) / 64
+                             : (size + per_long - 1) / per_long;
+        };
+        /* Entries are wide enough for the world height, which is at least
+           the height of the sections; taller worlds are told by the
+           length of the array. */
+        unsigned int bits = std::max<unsigned int>(
+            nbt::biomes::HEIGHTMAP_ENTRY_BITS,
+            std::bit_width(palettes.size() * nbt::biomes::BLOCK_PER_SECTION));
+        while (!stretches && bits < 16 && data.size() > packed_size(bits)) {
+            ++bits;
         }
-
-        if (static_cast<std::uint64_t>(state) >= states->size()) {
-            return "minecraft:air";
+        if (data.size() < packed_size(bits)) {
+            /* Missing or truncated; entries would decode as 0 which is
+               indistinguishable from empty columns. */
+            return nullptr;
         }
 
-        std::uint64_t data = (*states)[state];
+        auto *heights = new heightmap;
+        unpack_indices(data, bits, stretches, std::size_t{1} << bits,
+                       heights->data(), heights->size());
+        heightmaps_[i] = heights;
 
-        std::uint64_t shifted_data;
-        if (stretches) {
-            shifted_data = data >> ((bits * index) % 64); // NOLINT
-        } else {
-            shifted_data = data >> (index % (64 / bits) * bits); // NOLINT
-        }
-
-        if (stretches && 64 - ((bits * index) % 64) < bits) { // NOLINT
-            data = (*states)[state + 1];
+        return heights->data();
+    }
 
-            int leftover = (bits - ((state + 1) * 64 % bits)) % bits; // NOLINT
-            shifted_data =
-                ((data & (static_cast<std::int64_t>(pow(2, leftover)) - 1))
-                 << (bits - leftover)) |
-                shifted_data;
+    auto chunk::get_block(int32_t x, int32_t y, int32_t z) -> std::string {
+        if (x < 0 || 15 < x || z < 0 || 15 < z) { // NOLINT
+            return "";
         }
 
-        std::int64_t palette_id =
-            shifted_data & (static_cast<std::int64_t>(pow(2, bits)) - 1);
+        int section_y = y >> 4;
+#if !USE_V3_NBT_PARSER
+        make_sure_field_parsed(FIELD_SECTIONS);
+#endif
+        auto slot = section_slot(section_y);
+        if (!slot) {
+            return y < get_min_height() ? "" : air_block;
+        }
 
-        if (palette_id <= 0 ||
-            (*palette).size() <= static_cast<std::size_t>(palette_id)) {
-            return "minecraft:air";
+        std::uint16_t const *indices = get_section(section_y);
+        if (indices == nullptr) {
+            return air_block;
         }
 
-        return (*palette)[palette_id];
+        std::size_t index = ((y & 15) * 16 + z) * 16 + x; // NOLINT
+        return (*palettes[*slot])[indices[index]];
+    }
+
+    auto chunk::get_min_height() -> int {
+        return min_section_ * nbt::biomes::BLOCK_PER_SECTION;
     }
 
     auto chunk::get_max_height() -> int {
@@ -553,26 +1049,35 @@ namespace pixel_terrain::anvil {
         make_sure_field_parsed(FIELD_SECTIONS);
 #endif
 
-        for (int y = nbt::biomes::SECTIONS_Y_DIV_COUNT - 1; y >= 0; --y) {
-            if (palettes[y] != nullptr) {
-                return (y + 1) * nbt::biomes::BLOCK_PER_SECTION - 1;
+        for (std::size_t slot = palettes.size(); slot-- > 0;) {
+#if USE_V3_NBT_PARSER
+            if (raw_sections_[slot].palette.size != 0) {
+#else
+            if (palettes[slot] != nullptr) {
+#endif
+                return (min_section_ + static_cast<int>(slot) + 1) *
+                           nbt::biomes::BLOCK_PER_SECTION -
+                       1;
             }
         }
-        return 0;
+        return get_min_height() - 1;
     }
 
 #if USE_BLOCK_LIGHT_DATA
     [[nodiscard]] auto chunk::get_block_light(std::int32_t x, std::int32_t y,
                                               std::int32_t z) -> std::uint8_t {
-        if (y < 0 || 255 < y) {
+        auto slot = section_slot(y >> 4);
+        if (!slot) {
             return 0;
         }
-        auto block_light = block_lights_[y / nbt::biomes::BLOCK_STATES_COUNT];
+#if USE_V3_NBT_PARSER
+        decode_block_light(*slot);
+#endif
+        std::vector<std::uint8_t> const &block_light = block_lights_[*slot];
         if (block_light.empty()) {
             return 0;
         }
-        return block_light[(y % nbt::biomes::BLOCK_STATES_COUNT) * 16 * 16 +
-                           z * 16 + x];
+        return block_light[(y & 15) * 16 * 16 + z * 16 + x]; // NOLINT
     }
 #endif
 } // namespace pixel_terrain::anvil
@@ -7,10 +7,16 @@
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "nbt/biomes.hh"
 #include "nbt/constants.hh"
+#include "nbt/section.hh"
 #if USE_V3_NBT_PARSER
 #include "nbt/nbt.hh"
 #else
@@ -39,26 +45,83 @@ namespace pixel_terrain::anvil {
         broken_chunk_error(std::string const &msg) : chunk_exception(msg) {}
     };
 
+    enum class heightmap_type { WORLD_SURFACE, MOTION_BLOCKING };
+
+    using heightmap = std::array<std::uint16_t, nbt::biomes::HEIGHTMAP_SIZE>;
+
     class chunk {
+        static inline constexpr std::size_t HEIGHTMAP_TYPE_COUNT = 2;
+
 #if !USE_V3_NBT_PARSER
         nbt::nbt_pull_parser parser;
         std::vector<std::uint8_t> *chunk_data_;
 #endif
 
+        /* Section Y of the first entry of the per-section vectors below,
+           and the lowest section of the world the chunk was saved in. */
+        int min_section_ = 0;
+
 #if USE_BLOCK_LIGHT_DATA
-        std::array<std::vector<std::uint8_t>, nbt::biomes::BLOCK_STATES_COUNT>
-            block_lights_;
+        std::vector<std::vector<std::uint8_t>> block_lights_;
 #endif
 
-        std::array<std::vector<std::string> *, nbt::biomes::PALETTE_Y_MAX>
-            palettes;
-        std::array<std::vector<std::uint64_t> *,
-                   nbt::biomes::BLOCK_STATES_COUNT>
-            block_states;
+        std::vector<std::vector<std::string> *> palettes;
+        std::vector<std::vector<std::uint64_t> *> block_states;
+        std::vector<section_indices *> sections_;
+        std::array<std::vector<std::uint64_t>, HEIGHTMAP_TYPE_COUNT>
+            heightmap_data_;
+        std::array<heightmap *, HEIGHTMAP_TYPE_COUNT> heightmaps_;
         std::vector<std::int32_t> biomes;
+        nbt::biomes::biome_grid biome_grid_;
+        bool biomes_decoded_ = false;
         std::uint64_t last_update;
         std::int32_t data_version;
 #if USE_V3_NBT_PARSER
+        /* Range of RAW_DATA_ holding the payload of a tag, or empty if
+           the tag is missing. */
+        struct raw_payload {
+            std::size_t offset = 0;
+            std::size_t size = 0;
+        };
+
+        /* Tags of a section copied as they are in the chunk, decoded when
+           the section is first touched. */
+        struct raw_section {
+            /* Packed indices, missing in the root layout if the palette
+               has a single entry. */
+            raw_payload block_states;
+            /* Empty unless it is a list of compounds. */
+            raw_payload palette;
+            /* Biome names and their packed indices, in the root layout. */
+            raw_payload biome_palette;
+            raw_payload biome_data;
+#if USE_BLOCK_LIGHT_DATA
+            raw_payload block_light;
+#endif
+            bool decoded = false;
+        };
+
+        /* Where sections and fields are. Chunks from 1.18 onward have
+           them at the root, with paletted biomes in each section. */
+        enum class layout { LEVEL, ROOT };
+
+        layout layout_ = layout::LEVEL;
+        std::vector<std::uint8_t> raw_data_;
+        std::vector<raw_section> raw_sections_;
+
+        void index_sections(nbt::nbt const &nbt_file) noexcept(false);
+        auto index_section(nbt::tag::data_iterator first,
+                           nbt::tag::data_iterator last,
+                           std::vector<std::pair<int, raw_section>> *found)
+            -> nbt::tag::data_iterator;
+        [[nodiscard]] auto raw_view(raw_payload const &payload) const
+            -> std::span<std::uint8_t const>;
+        void decode_section(std::size_t slot);
+        void decode_biomes(std::size_t slot,
+                           std::span<nbt::biomes::biome_index> cells);
+#if USE_BLOCK_LIGHT_DATA
+        void decode_block_light(std::size_t slot);
+#endif
         void init_fields(nbt::nbt const &nbt_file) noexcept(false);
 #else
         unsigned char loaded_fields = 0;
@@ -68,28 +131,58 @@ namespace pixel_terrain::anvil {
         static inline constexpr unsigned char FIELD_LAST_UPDATE = 1 << 1;
         static inline constexpr unsigned char FIELD_BIOMES = 1 << 2;
         static inline constexpr unsigned char FIELD_DATA_VERSION = 1 << 3;
+        static inline constexpr unsigned char FIELD_HEIGHTMAPS = 1 << 4;
 
         void parse_fields();
         void parse_sections();
+        void parse_heightmaps();
         auto current_field() -> unsigned char;
+        /* True if fields may be inside the tag at TAG_STRUCTURE. */
+        [[nodiscard]] auto on_field_path() const -> bool;
+        auto parse_field_if_exists(unsigned char field) -> bool;
         void make_sure_field_parsed(unsigned char field) noexcept(false);
 #endif
 
+        /* Index of section Y in the per-section vectors, if any. */
+        [[nodiscard]] auto section_slot(int y) const
+            -> std::optional<std::size_t>;
+
     public:
 #if USE_V3_NBT_PARSER
-        chunk(std::vector<std::uint8_t> const &data);
+        /* DATA is parsed in place, and not referred after return. */
+        explicit chunk(std::span<std::uint8_t const> data);
 #else
         chunk(std::vector<std::uint8_t> *data);
 #endif
         ~chunk();
 
         [[nodiscard]] auto get_last_update() noexcept(false) -> std::uint64_t;
-        [[nodiscard]] auto get_palette(unsigned char y)
-            -> std::vector<std::string> *;
+        /* Section accessors below take the section Y, i.e. the block Y
+           divided by 16 rounding down, which may be negative. */
+        [[nodiscard]] auto get_palette(int y) -> std::vector<std::string> *;
+        /* Returns palette indices of section Y decoded at once, or nullptr
+           if the section has no block data. Decoded sections are cached
+           until this chunk is destroyed. */
+        [[nodiscard]] auto get_section(int y) -> std::uint16_t const *;
+        /* Returns the only block in section Y if the section is uniform,
+           that is, it has a single-entry palette or no block data at all
+           (all air). Returns nullptr if the section mixes blocks. */
+        [[nodiscard]] auto get_uniform_block(int y) -> std::string const *;
+        /* Returns heightmap TYPE indexed by z * 16 + x, where each entry
+           is one above the highest matching block counted from
+           get_min_height() (0 if there is none), or nullptr if the chunk
+           does not carry that heightmap. */
+        [[nodiscard]] auto get_heightmap(heightmap_type type)
+            -> std::uint16_t const *;
         [[nodiscard]] auto get_block(std::int32_t x, std::int32_t y,
                                      std::int32_t z) -> std::string;
-        [[nodiscard]] auto get_biome(std::int32_t x, std::int32_t y,
-                                     std::int32_t z) -> std::int32_t;
+        /* Returns biomes of the chunk, decoded at once when first
+           called. */
+        [[nodiscard]] auto get_biomes() -> nbt::biomes::biome_grid const &;
+        /* Lowest block Y of the world the chunk was saved in. */
+        [[nodiscard]] auto get_min_height() -> int;
+        /* Highest block Y of sections with blocks, or below
+           get_min_height() if there is none. */
         [[nodiscard]] auto get_max_height() -> int;
 
 #if USE_BLOCK_LIGHT_DATA
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "nbt/biomes.hh"
+#include "nbt/chunk.hh"
+#include "nbt/constants.hh"
+#include "nbt/tag.hh"
+#include "nbt/test_writer.hh"
+
+using namespace pixel_terrain;
+using anvil::chunk;
+using nbt::tag_type;
+using nbt::testing::block_palette;
+using nbt::testing::nbt_writer;
+using nbt::testing::pack;
+
+namespace {
+    /* Chunk of 1.18 onward spanning Y = -64 to 319, with stone at the
+       bottom section, dirt at (1, -46, 3) and swamp at the lowest cell of
+       the second section. */
+    auto make_root_chunk() -> std::vector<std::uint8_t> {
+        nbt_writer w;
+        w.compound("");
+        w.int_("DataVersion", 2975);
+        w.int_("yPos", -4);
+        w.long_("LastUpdate", 42);
+
+        w.list("sections", tag_type::TAG_COMPOUND, 4);
+        /* Light only, below the world. */
+        w.byte("Y", -5);
+        w.end();
+
+        w.byte("Y", -4);
+        w.compound("block_states");
+        block_palette(&w, "palette", {"minecraft:stone"});
+        w.end();
+        w.compound("biomes");
+        w.list("palette", tag_type::TAG_STRING, 1);
+        w.string_payload("minecraft:plains");
+        w.end();
+        w.end();
+
+        w.compound("block_states");
+        block_palette(&w, "palette", {"minecraft:air", "minecraft:dirt"});
+        std::vector<std::uint16_t> blocks(nbt::biomes::SECTION_BLOCK_COUNT);
+        blocks[(2 * 16 + 3) * 16 + 1] = 1;
+        w.long_array("data", pack(blocks, 4));
+        w.end();
+        w.compound("biomes");
+        w.list("palette", tag_type::TAG_STRING, 2);
+        w.string_payload("minecraft:plains");
+        w.string_payload("minecraft:swamp");
+        std::vector<std::uint16_t> cells(
+            nbt::biomes::BIOME_CELLS_PER_SECTION);
+        cells[0] = 1;
+        w.long_array("data", pack(cells, 1));
+        w.end();
+        w.byte("Y", -3);
+        w.end();
+
+        w.byte("Y", 20);
+        w.compound("block_states");
+        block_palette(&w, "palette", {"minecraft:air"});
+        w.end();
+        w.end();
+
+        w.compound("Heightmaps");
+        std::vector<std::uint16_t> heights(nbt::biomes::HEIGHTMAP_SIZE);
+        heights[3 * 16 + 1] = -46 + 64 + 1;
+        w.long_array("WORLD_SURFACE", pack(heights, 9));
+        w.end();
+        w.end();
+        return w.data();
+    }
+
+    auto biome_name(nbt::biomes::biome_grid const &grid, int x, int y, int z)
+        -> std::string_view {
+        return nbt::biomes::biome_table()[grid.at(x, y, z)].name;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(root_layout) {
+    std::vector<std::uint8_t> data = make_root_chunk();
+    chunk c(data);
+
+    BOOST_TEST(c.get_last_update() == 42U);
+    BOOST_TEST(c.get_min_height() == -64);
+    BOOST_TEST(c.get_max_height() == 335);
+
+    BOOST_TEST(*c.get_uniform_block(-4) == "minecraft:stone");
+    BOOST_TEST(*c.get_uniform_block(-5) == "minecraft:air");
+    BOOST_TEST(*c.get_uniform_block(20) == "minecraft:air");
+    BOOST_TEST(c.get_uniform_block(-3) == nullptr);
+    BOOST_TEST(c.get_section(-3) != nullptr);
+    BOOST_TEST(c.get_block(1, -46, 3) == "minecraft:dirt");
+    BOOST_TEST(c.get_block(1, -47, 3) == "minecraft:air");
+    BOOST_TEST(c.get_block(15, -64, 15) == "minecraft:stone");
+    BOOST_TEST(c.get_block(0, 0, 0) == "minecraft:air");
+    BOOST_TEST(c.get_block(0, -65, 0).empty());
+
+    nbt::biomes::biome_grid const &biomes = c.get_biomes();
+    BOOST_TEST(biome_name(biomes, 0, -48, 0) == "swamp");
+    BOOST_TEST(biome_name(biomes, 3, -45, 3) == "swamp");
+    BOOST_TEST(biome_name(biomes, 4, -48, 0) == "plains");
+    BOOST_TEST(biome_name(biomes, 0, -64, 0) == "plains");
+    BOOST_TEST(biome_name(biomes, 0, -100, 0) == "plains");
+    /* Section 20 has no biomes. */
+    BOOST_TEST(biome_name(biomes, 0, 330, 0) == "ocean");
+    BOOST_TEST(&c.get_biomes() == &biomes);
+
+    std::uint16_t const *surface =
+        c.get_heightmap(anvil::heightmap_type::WORLD_SURFACE);
+    BOOST_TEST_REQUIRE(surface != nullptr);
+    BOOST_TEST(c.get_min_height() + surface[3 * 16 + 1] - 1 == -46);
+    BOOST_TEST(c.get_heightmap(anvil::heightmap_type::MOTION_BLOCKING) ==
+               nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(level_layout) {
+    nbt_writer w;
+    w.compound("");
+    w.int_("DataVersion", 2586);
+    w.compound("Level");
+    w.long_("LastUpdate", 7);
+    w.int_array("Biomes", std::vector<std::int32_t>(
+                              nbt::biomes::BIOME_DATA_NEW_VERSION_SIZE,
+                              nbt::biomes::JUNGLE));
+    w.list("Sections", tag_type::TAG_COMPOUND, 2);
+    w.byte("Y", -1);
+    w.end();
+    w.byte("Y", 1);
+    block_palette(&w, "Palette", {"minecraft:air", "minecraft:stone"});
+    std::vector<std::uint16_t> blocks(nbt::biomes::SECTION_BLOCK_COUNT);
+    blocks[(5 * 16 + 2) * 16 + 3] = 1;
+    w.long_array("BlockStates", pack(blocks, 4));
+    w.end();
+    w.end();
+    w.end();
+
+    chunk c(w.data());
+    BOOST_TEST(c.get_last_update() == 7U);
+    BOOST_TEST(c.get_min_height() == 0);
+    BOOST_TEST(c.get_max_height() == 31);
+    BOOST_TEST(c.get_block(3, 21, 2) == "minecraft:stone");
+    BOOST_TEST(c.get_block(3, 5, 2) == "minecraft:air");
+    BOOST_TEST(c.get_block(3, -1, 2).empty());
+    BOOST_TEST(biome_name(c.get_biomes(), 3, 21, 2) == "jungle");
+}
+
+BOOST_AUTO_TEST_CASE(sections_missing) {
+    nbt_writer w;
+    w.compound("");
+    w.int_("DataVersion", 2975);
+    w.long_("LastUpdate", 0);
+    /* Sections in the level layout are not looked at for new chunks. */
+    w.compound("Level");
+    w.list("Sections", tag_type::TAG_COMPOUND, 0);
+    w.end();
+    w.end();
+
+    BOOST_CHECK_THROW(chunk(w.data()), anvil::not_generated_chunk_error);
+}
@@ -79,6 +79,7 @@ namespace pixel_terrain::nbt {
         inline constexpr std::int32_t CRIMSON_FOREST = 171;
         inline constexpr std::int32_t WARPED_FOREST = 172;
         inline constexpr std::int32_t SOUL_SAND_VALLEY = 170;
+        inline constexpr std::int32_t BASALT_DELTAS = 173;
         inline constexpr std::int32_t THE_END = 9;
         inline constexpr std::int32_t SMALL_END_ISLANDS = 40;
         inline constexpr std::int32_t END_MIDLANDS = 41;
@@ -104,10 +105,17 @@ namespace pixel_terrain::nbt {
         inline constexpr int PALETTE_Y_MAX = 16;
         inline constexpr int SECTIONS_Y_DIV_COUNT = 16;
         inline constexpr int BLOCK_PER_SECTION = 16;
+        inline constexpr int SECTION_BLOCK_COUNT = 4096;
 
         inline constexpr int BLOCK_STATES_COUNT = 16;
 
+        inline constexpr int HEIGHTMAP_ENTRY_BITS = 9;
+        inline constexpr int HEIGHTMAP_SIZE = 256;
+
         inline constexpr int NEED_STRETCH_DATA_VERSION_THRESHOLD = 2529;
+        inline constexpr int ROOT_SECTIONS_DATA_VERSION_THRESHOLD = 2844;
+
+        inline constexpr int BIOME_CELLS_PER_SECTION = 64;
     } // namespace biomes
 } // namespace pixel_terrain::nbt
 
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: MIT
+
+/* Compare inflate backends on chunk-sized zlib and gzip streams.
+   Streams are built from NBT test data, and from chunks of region files
+   given as arguments if any. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "nbt/utils.hh"
+#include "nbt_test_testdata.hh"
+
+using namespace pixel_terrain::nbt::utils;
+
+namespace {
+    struct sample {
+        std::vector<std::uint8_t> data;
+        compression type;
+    };
+
+    auto deflate_data(std::vector<std::uint8_t> const &input, bool gzip)
+        -> std::vector<std::uint8_t> {
+        z_stream strm;
+        std::memset(&strm, 0, sizeof(strm));
+        constexpr int window_bits = 15;
+        constexpr int gzip_window_bits = window_bits + 16;
+        constexpr int mem_level = 8;
+        deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     gzip ? gzip_window_bits : window_bits, mem_level,
+                     Z_DEFAULT_STRATEGY);
+
+        std::vector<std::uint8_t> result(deflateBound(&strm, input.size()));
+        strm.next_in = const_cast<std::uint8_t *>(input.data());
+        strm.avail_in = input.size();
+        strm.next_out = result.data();
+        strm.avail_out = result.size();
+        deflate(&strm, Z_FINISH);
+        result.resize(result.size() - strm.avail_out);
+        deflateEnd(&strm);
+
+        return result;
+    }
+
+    void add_testdata_samples(std::vector<sample> *samples) {
+        constexpr std::size_t chunk_size = 96 * 1024;
+        std::vector<std::string_view> names = {
+            "complex-1.nbt",
+            "complex-2.nbt",
+            "complex-3.nbt",
+            "nbt-file.nbt",
+            "nested-list.nbt",
+            "single-tag-int-array.nbt",
+            "single-tag-long-array.nbt",
+            "tag-multiple.nbt",
+        };
+
+        /* Test data are tiny, so repeat them to the size of a typical
+           chunk. */
+        std::vector<std::uint8_t> payload;
+        while (payload.size() < chunk_size) {
+            for (std::string_view name : names) {
+                auto data = get_embedded_data(name);
+                if (data) {
+                    payload.insert(payload.end(), data->begin(), data->end());
+                }
+            }
+        }
+
+        samples->push_back({deflate_data(payload, false), compression::ZLIB});
+        samples->push_back({deflate_data(payload, true), compression::GZIP});
+    }
+
+    void add_region_samples(std::filesystem::path const &path,
+                            std::vector<sample> *samples) {
+        constexpr std::size_t sector_size = 4096;
+        constexpr int n_chunks = 1024;
+
+        std::ifstream in(path, std::ios::binary);
+        std::vector<std::uint8_t> file((std::istreambuf_iterator<char>(in)),
+                                       std::istreambuf_iterator<char>());
+        if (file.size() < 2 * sector_size) {
+            std::fprintf(stderr, "%s: too small\n", path.string().c_str());
+            return;
+        }
+
+        for (int i = 0; i < n_chunks; ++i) {
+            std::size_t off = (std::size_t{file[i * 4]} << 16 |
+                               std::size_t{file[i * 4 + 1]} << 8 |
+                               std::size_t{file[i * 4 + 2]}) *
+                              sector_size;
+            if (off == 0 || off + 5 > file.size()) {
+                continue;
+            }
+            std::size_t len = std::size_t{file[off]} << 24 |
+                              std::size_t{file[off + 1]} << 16 |
+                              std::size_t{file[off + 2]} << 8 |
+                              std::size_t{file[off + 3]};
+            auto type = static_cast<compression>(file[off + 4]);
+            if (len < 1 || off + 4 + len > file.size() ||
+                (type != compression::ZLIB && type != compression::GZIP)) {
+                continue;
+            }
+            samples->push_back(
+                {std::vector<std::uint8_t>(file.begin() + off + 5,
+                                           file.begin() + off + 4 + len),
+                 type});
+        }
+    }
+
+    void run(inflate_backend *backend, std::vector<sample> const &samples) {
+        constexpr std::size_t target_bytes = 128 * 1024 * 1024;
+
+        std::size_t per_round = 0;
+        for (sample const &s : samples) {
+            per_round += s.data.size();
+        }
+        std::size_t rounds = std::max<std::size_t>(1, target_bytes / per_round);
+
+        decompressor inflater(backend);
+        std::size_t n_out = 0;
+        std::size_t n_failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (sample const &s : samples) {
+                if (!inflater.decompress(s.data.data(), s.data.size(),
+                                         s.type)) {
+                    ++n_failed;
+                    continue;
+                }
+                n_out += inflater.view().size();
+            }
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        std::printf("%-12s %8zu streams %10.1f MiB/s out %10.0f streams/s",
+                    backend->name(), rounds * samples.size(),
+                    n_out / elapsed.count() / (1024 * 1024),
+                    rounds * samples.size() / elapsed.count());
+        if (n_failed != 0) {
+            std::printf(" (%zu failed)", n_failed);
+        }
+        std::printf("\n");
+    }
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    std::vector<sample> samples;
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) {
+            add_region_samples(argv[i], &samples);
+        }
+    } else {
+        add_testdata_samples(&samples);
+    }
+    if (samples.empty()) {
+        std::fprintf(stderr, "No chunk found.\n");
+        return 1;
+    }
+
+    run(new zlib_backend, samples);
+#if USE_LIBDEFLATE
+    run(new libdeflate_backend, samples);
+#endif
+
+    return 0;
+}
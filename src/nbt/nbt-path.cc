@@ -204,4 +204,58 @@ namespace pixel_terrain::nbt {
         result.valid_ = true;
         return result;
     }
+
+    nbt_selection::nbt_selection(std::initializer_list<nbt_path> paths) {
+        for (nbt_path const &path : paths) {
+            add(path);
+        }
+    }
+
+    nbt_selection::nbt_selection(std::initializer_list<nbt_path> paths,
+                                 std::initializer_list<nbt_path> raw_paths)
+        : nbt_selection(paths) {
+        for (nbt_path const &path : raw_paths) {
+            node *n = add(path);
+            if (n != nullptr) {
+                n->raw = static_cast<int>(raw_count_);
+            }
+            ++raw_count_;
+        }
+    }
+
+    nbt_selection::nbt_selection(std::vector<nbt_path> const &paths) {
+        for (nbt_path const &path : paths) {
+            add(path);
+        }
+    }
+
+    auto nbt_selection::add(nbt_path const &path) -> node * {
+        if (!path) {
+            return nullptr;
+        }
+
+        node *current = &root_;
+        for (nbt_path::pathspec spec : path.path()) {
+            if (current->all ||
+                spec.category() != nbt_path::pathspec::category::KEY) {
+                break;
+            }
+
+            node *child = nullptr;
+            for (node &n : current->children) {
+                if (n.key == spec.key()) {
+                    child = &n;
+                    break;
+                }
+            }
+            if (child == nullptr) {
+                current->children.push_back(node{spec.key(), false, {}});
+                child = &current->children.back();
+            }
+            current = child;
+        }
+        current->all = true;
+        current->children.clear();
+        return current;
+    }
 } // namespace pixel_terrain::nbt
@@ -3,9 +3,12 @@
 #ifndef NBT_NBT_PATH_HH
 #define NBT_NBT_PATH_HH
 
+#include <cstddef>
+#include <initializer_list>
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace pixel_terrain::nbt {
@@ -136,6 +139,55 @@ namespace pixel_terrain::nbt {
             return *this;
         }
     };
+
+    /* Set of paths of tags to decode, for parsing only part of a
+       document. A key after a list applies to each compound in it, so that
+       "//Level/Sections/Y" selects Y of every section. An index selects
+       the whole array or list it is applied to. Tags on raw paths are not
+       decoded at all; the parser only reports where their payloads are,
+       for callers that walk them by themselves. */
+    class nbt_selection {
+    public:
+        struct node {
+            std::string key;
+            /* The whole tag is selected, not only some of its children. */
+            bool all = false;
+            std::vector<node> children;
+            /* Index of the raw path ending here, or -1. */
+            int raw = -1;
+
+            [[nodiscard]] auto find(std::string_view k) const
+                -> node const * {
+                for (node const &child : children) {
+                    if (child.key == k) {
+                        return &child;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+    private:
+        node root_;
+        std::size_t raw_count_ = 0;
+
+        auto add(nbt_path const &path) -> node *;
+
+    public:
+        nbt_selection(std::initializer_list<nbt_path> paths);
+        /* RAW_PATHS are numbered in order, as indices of raw tags. They
+           should not be under other paths. */
+        nbt_selection(std::initializer_list<nbt_path> paths,
+                      std::initializer_list<nbt_path> raw_paths);
+        explicit nbt_selection(std::vector<nbt_path> const &paths);
+
+        /* Node whose children are the root tags selected. */
+        [[nodiscard]] auto root() const -> node const & { return root_; }
+
+        [[nodiscard]] auto raw_count() const -> std::size_t {
+            return raw_count_;
+        }
+    };
 } // namespace pixel_terrain::nbt
 
 #endif
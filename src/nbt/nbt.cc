@@ -1,19 +1,41 @@
 // SPDX-License-Identifier: MIT
 
-#include <optional>
-#include <type_traits>
-#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 
 #include "nbt.hh"
 #include "nbt/tag.hh"
 
 namespace pixel_terrain::nbt {
-    auto nbt::parse_buffer(std::vector<std::uint8_t>::const_iterator first,
-                           std::vector<std::uint8_t>::const_iterator last)
-        -> bool {
-        auto [root, itr] = tag_compound::parse_buffer(first, last);
-        if (root == nullptr || last < itr) {
-            delete root;
+    namespace {
+        /* Initial size of the arena for a document of SIZE bytes, so that
+           typical chunks fit in one block. Tags take more room in memory
+           than in the file, mostly for names and headers. */
+        auto arena_size_hint(std::size_t size) -> std::size_t {
+            constexpr std::size_t ratio = 2;
+            constexpr std::size_t min_size = 1024;
+            return std::max(size * ratio, min_size);
+        }
+
+        /* Initial size of the arena for selective parses, which keep only
+           a few tags whatever the size of the document. Enough for
+           Biomes and heightmaps of a chunk. */
+        constexpr std::size_t SELECTED_ARENA_SIZE = 8192;
+    } // namespace
+
+    auto nbt::parse_buffer(std::span<std::uint8_t const> data,
+                           nbt_selection const *selection) -> bool {
+        if (selection != nullptr) {
+            raw_tags_.resize(selection->raw_count());
+        }
+        auto [root, itr] =
+            selection != nullptr
+                ? parse_selected(data, *selection, tag_allocator(&arena_),
+                                 raw_tags_)
+                : tag_compound::parse_buffer(data, tag_allocator(&arena_));
+        if (root == nullptr || data.data() + data.size() < itr) {
             return false;
         }
 
@@ -22,11 +44,20 @@ namespace pixel_terrain::nbt {
         return true;
     }
 
-    auto nbt::from_iterator(std::vector<std::uint8_t>::const_iterator first,
-                            std::vector<std::uint8_t>::const_iterator last)
-        -> nbt * {
-        auto *result = new nbt;
-        if (!result->parse_buffer(first, last)) {
+    auto nbt::from_buffer(std::span<std::uint8_t const> data) -> nbt * {
+        auto *result = new nbt(arena_size_hint(data.size()));
+        if (!result->parse_buffer(data, nullptr)) {
+            delete result;
+            return nullptr;
+        }
+
+        return result;
+    }
+
+    auto nbt::from_buffer(std::span<std::uint8_t const> data,
+                          nbt_selection const &selection) -> nbt * {
+        auto *result = new nbt(SELECTED_ARENA_SIZE);
+        if (!result->parse_buffer(data, &selection)) {
             delete result;
             return nullptr;
         }
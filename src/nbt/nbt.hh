@@ -3,8 +3,12 @@
 #ifndef NBT_HH
 #define NBT_HH
 
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <span>
 #include <type_traits>
 #include <vector>
 
@@ -13,20 +17,46 @@
 
 namespace pixel_terrain::nbt {
     class nbt {
+        /* All tags of the document and their values, freed at once. */
+        std::pmr::monotonic_buffer_resource arena_;
         tag_compound *root_ = nullptr;
+        std::vector<raw_tag> raw_tags_;
 
-        auto parse_buffer(std::vector<std::uint8_t>::const_iterator first,
-                          std::vector<std::uint8_t>::const_iterator last)
-            -> bool;
+        auto parse_buffer(std::span<std::uint8_t const> data,
+                          nbt_selection const *selection) -> bool;
 
-        nbt() = default;
+        explicit nbt(std::size_t arena_size) : arena_(arena_size) {}
 
     public:
-        ~nbt() { delete root_; }
+        /* Tags are not destructed; they own nothing outside of ARENA_. */
+        ~nbt() = default;
 
-        static auto
-        from_iterator(std::vector<std::uint8_t>::const_iterator first,
-                      std::vector<std::uint8_t>::const_iterator last) -> nbt *;
+        nbt(nbt const &) = delete;
+        auto operator=(nbt const &) -> nbt & = delete;
+
+        /* Parse DATA in place. Parsed tags own their values, so DATA may
+           be released afterwards. Returns nullptr on parse error.
+           Results of query() are copies owned by the caller, and may
+           outlive the document. */
+        static auto from_buffer(std::span<std::uint8_t const> data) -> nbt *;
+
+        /* Same as above, but only tags on paths of SELECTION are decoded.
+           Others are skipped by their length, and are missing from the
+           document. Tags on raw paths of SELECTION are found by raw(),
+           and point into DATA. */
+        static auto from_buffer(std::span<std::uint8_t const> data,
+                                nbt_selection const &selection) -> nbt *;
+
+        template <std::contiguous_iterator Iterator>
+        static auto from_iterator(Iterator first, Iterator last) -> nbt * {
+            return from_buffer(byte_span(first, last));
+        }
+
+        /* Tag on raw path INDEX of the selection the document was parsed
+           with. */
+        [[nodiscard]] auto raw(std::size_t index) const -> raw_tag const & {
+            return raw_tags_[index];
+        }
 
         template <class Tp, class = std::is_convertible<Tp, tag_payload>>
         auto query(nbt_path path) const -> Tp * {
@@ -144,4 +144,86 @@ BOOST_FIXTURE_TEST_SUITE(query, F)
         delete tag;
     }
 
+    BOOST_AUTO_TEST_CASE(outlives_document) {
+        auto path = nbt_path::compile("//baz");
+        auto *tag = file->query<tag_compound_payload>(path);
+        BOOST_TEST(tag != nullptr);
+        delete file;
+        file = nullptr;
+        path = nbt_path::compile("/bar/abc[1]");
+        auto *inner = tag->query<tag_byte_payload>(path);
+        BOOST_TEST(inner != nullptr);
+        BOOST_TEST(**inner == 4);
+        delete inner;
+        delete tag;
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(selection)
+
+    BOOST_AUTO_TEST_CASE(selected_only) {
+        auto data = *get_embedded_data("nbt-file.nbt");
+        nbt_selection selection = {
+            nbt_path::compile("//foo/foo1"),
+            nbt_path::compile("//baz/bar"),
+        };
+        auto *file = nbt::from_buffer(data, selection);
+        BOOST_TEST(file != nullptr);
+
+        auto *foo1 = file->query<tag_byte_payload>(
+            nbt_path::compile("//foo/foo1"));
+        BOOST_TEST(foo1 != nullptr);
+        BOOST_TEST(**foo1 == 2);
+        delete foo1;
+
+        auto *ghi = file->query<tag_int_payload>(
+            nbt_path::compile("//baz/bar/ghi<1>"));
+        BOOST_TEST(ghi != nullptr);
+        BOOST_TEST(**ghi == 2);
+        delete ghi;
+
+        BOOST_TEST(file->query<tag_byte_payload>(
+                       nbt_path::compile("//foo/foo2")) == nullptr);
+        BOOST_TEST(file->query<tag_int_array_payload>(
+                       nbt_path::compile("//bar")) == nullptr);
+        BOOST_TEST(file->query<tag_int_payload>(
+                       nbt_path::compile("//baz/foo")) == nullptr);
+
+        delete file;
+    }
+
+    BOOST_AUTO_TEST_CASE(raw_paths) {
+        auto data = *get_embedded_data("nbt-file.nbt");
+        nbt_selection selection(
+            {nbt_path::compile("//foo/foo1")},
+            {nbt_path::compile("//bar"), nbt_path::compile("//qux")});
+        auto *file = nbt::from_buffer(data, selection);
+        BOOST_TEST_REQUIRE(file != nullptr);
+
+        /* Length and 3 ints. */
+        raw_tag const &bar = file->raw(0);
+        BOOST_TEST((bar.type == tag_type::TAG_INT_ARRAY));
+        BOOST_TEST(bar.payload.size() == 16U);
+        BOOST_TEST(bar.payload[4 + 3] == 3);
+        BOOST_TEST((file->raw(1).type == tag_type::TAG_END));
+        BOOST_TEST(file->query<tag_int_array_payload>(
+                       nbt_path::compile("//bar")) == nullptr);
+
+        auto *foo1 = file->query<tag_byte_payload>(
+            nbt_path::compile("//foo/foo1"));
+        BOOST_TEST(foo1 != nullptr);
+        delete foo1;
+
+        delete file;
+    }
+
+    BOOST_AUTO_TEST_CASE(truncated) {
+        auto data = *get_embedded_data("nbt-file.nbt");
+        nbt_selection selection = {nbt_path::compile("//foo")};
+        /* Skipped tags are still bounds checked. */
+        data.resize(data.size() - 3);
+        BOOST_TEST(nbt::from_buffer(data, selection) == nullptr);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -364,6 +364,133 @@ namespace pixel_terrain::nbt {
         return current_event;
     }
 
+    void nbt_pull_parser::require(std::size_t n) const {
+        if (n > length - offset) {
+            throw std::out_of_range("buffer exhausted on skipped tag");
+        }
+    }
+
+    void nbt_pull_parser::skip_array(unsigned char type, std::int32_t len) {
+        if (len <= 0) {
+            return;
+        }
+        std::size_t size = sizeof(std::uint8_t);
+        if (type == TAG_INT_ARRAY) {
+            size = sizeof(std::int32_t);
+        } else if (type == TAG_LONG_ARRAY) {
+            size = sizeof(std::uint64_t);
+        }
+        require(static_cast<std::size_t>(len) * size);
+        offset += static_cast<std::size_t>(len) * size;
+    }
+
+    void nbt_pull_parser::skip_list(unsigned char payload_type,
+                                    std::int32_t len) {
+        if (payload_type == TAG_END) {
+            return;
+        }
+        for (std::int32_t i = 0; i < len; ++i) {
+            skip_payload(payload_type);
+        }
+    }
+
+    void nbt_pull_parser::skip_payload(unsigned char type) {
+        std::size_t n;
+        switch (type) {
+        case TAG_END:
+            return;
+
+        case TAG_BYTE:
+            n = sizeof(std::uint8_t);
+            break;
+
+        case TAG_SHORT:
+            n = sizeof(std::int16_t);
+            break;
+
+        case TAG_INT:
+        case TAG_FLOAT:
+            n = sizeof(std::int32_t);
+            break;
+
+        case TAG_LONG:
+        case TAG_DOUBLE:
+            n = sizeof(std::uint64_t);
+            break;
+
+        case TAG_BYTE_ARRAY:
+        case TAG_INT_ARRAY:
+        case TAG_LONG_ARRAY:
+            require(sizeof(std::int32_t));
+            skip_array(type, read_int(data, &offset));
+            return;
+
+        case TAG_STRING:
+            require(sizeof(std::uint16_t));
+            n = static_cast<std::uint16_t>(read_short(data, &offset));
+            break;
+
+        case TAG_LIST: {
+            require(1 + sizeof(std::int32_t));
+            unsigned char payload_type = read_byte(data, &offset);
+            skip_list(payload_type, read_int(data, &offset));
+            return;
+        }
+
+        case TAG_COMPOUND:
+            for (;;) {
+                require(1);
+                unsigned char child_type = read_byte(data, &offset);
+                if (child_type == TAG_END) {
+                    return;
+                }
+                require(sizeof(std::uint16_t));
+                n = static_cast<std::uint16_t>(read_short(data, &offset));
+                require(n);
+                offset += n;
+                skip_payload(child_type);
+            }
+
+        default:
+            throw std::runtime_error("unknown tag type on skipped tag");
+        }
+        require(n);
+        offset += n;
+    }
+
+    auto nbt_pull_parser::skip() noexcept(false) -> parser_event {
+        if (current_event != parser_event::TAG_START || types.empty()) {
+            throw std::logic_error("skip() is called out of tag start");
+        }
+
+        unsigned char type = types.top();
+        if (is_array_type(type) || type == TAG_LIST) {
+            /* Header is already read. */
+            std::int32_t rest = lengths.top() - indices.top();
+            if (type == TAG_LIST) {
+                skip_list(payload_types.top(), rest);
+                payload_types.pop();
+            } else {
+                skip_array(type, rest);
+            }
+            indices.pop();
+            lengths.pop();
+        } else {
+            skip_payload(type);
+        }
+
+        /* Strings are not read, so there is nothing to free. */
+        last_tag_name = names.top();
+        names.pop();
+        last_tag_type = type;
+        types.pop();
+        tag_ended = true;
+        end_emitted = true;
+
+        current_event = parser_event::TAG_END;
+        return current_event;
+    }
+
     auto nbt_pull_parser::get_event_type() noexcept -> parser_event {
         return current_event;
     }
@@ -3,6 +3,7 @@
 #ifndef NBT_PULL_PARSER_HH
 #define NBT_PULL_PARSER_HH
 
+#include <cstddef>
 #include <cstdint>
 #include <stack>
 #include <string>
@@ -66,11 +67,19 @@ namespace pixel_terrain::nbt {
         void parse_list_header();
         auto parse_list_data() -> parser_event;
         void handle_tag_end();
+        void require(std::size_t n) const;
+        void skip_array(unsigned char type, std::int32_t len);
+        void skip_list(unsigned char payload_type, std::int32_t len);
+        void skip_payload(unsigned char type);
 
     public:
         nbt_pull_parser(unsigned char *data, size_t length);
 
         auto next() noexcept(false) -> parser_event;
+        /* Jump over the tag just started, as if next() had been called
+           until its TAG_END, but without reading its contents. Lengths in
+           the tag are used to find its end. Returns TAG_END. */
+        auto skip() noexcept(false) -> parser_event;
 
         [[nodiscard]] auto get_event_type() noexcept -> parser_event;
         [[nodiscard]] auto get_tag_name() -> std::string;
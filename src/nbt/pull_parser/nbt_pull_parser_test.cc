@@ -741,3 +741,47 @@ BOOST_AUTO_TEST_CASE(parser_complex_3) {
     ev = p.next();
     BOOST_TEST(ev == parser_event::DOCUMENT_END);
 }
+
+BOOST_AUTO_TEST_CASE(skip) {
+    /* Compound "" of list "foo" of a compound with string "a", int array
+       "bar" and byte "baz". */
+    // NOLINTNEXTLINE
+    unsigned char data[] = {
+        10, 0,   0,                                     //
+        9,  0,   3,   'f', 'o', 'o', 10, 0, 0, 0, 1,    //
+        8,  0,   1,   'a', 0,   2,   'x', 'y', 0,       //
+        11, 0,   3,   'b', 'a', 'r', 0, 0, 0, 1, 0, 0, 0, 7, //
+        1,  0,   3,   'b', 'a', 'z', 5,                 //
+        0};
+    nbt_pull_parser p(data, sizeof(data));
+
+    BOOST_TEST(p.next() == parser_event::TAG_START);
+    BOOST_TEST(p.next() == parser_event::TAG_START);
+    BOOST_TEST(p.get_tag_name() == "foo");
+    BOOST_TEST(p.skip() == parser_event::TAG_END);
+    BOOST_TEST(p.get_tag_name() == "foo");
+    BOOST_TEST(p.get_tag_type() == TAG_LIST);
+
+    BOOST_TEST(p.next() == parser_event::TAG_START);
+    BOOST_TEST(p.get_tag_name() == "bar");
+    BOOST_TEST(p.skip() == parser_event::TAG_END);
+
+    BOOST_TEST(p.next() == parser_event::TAG_START);
+    BOOST_TEST(p.get_tag_name() == "baz");
+    BOOST_TEST(p.next() == parser_event::DATA);
+    BOOST_TEST(p.get_byte() == 5);
+    BOOST_TEST(p.next() == parser_event::TAG_END);
+    BOOST_TEST(p.next() == parser_event::TAG_END);
+    BOOST_TEST(p.next() == parser_event::DOCUMENT_END);
+}
+
+BOOST_AUTO_TEST_CASE(skip_truncated) {
+    // NOLINTNEXTLINE
+    unsigned char data[] = {10, 0, 0, 11, 0, 3, 'b', 'a', 'r', 0, 0, 0, 2,
+                            0,  0, 0, 7,  0};
+    nbt_pull_parser p(data, sizeof(data));
+
+    BOOST_TEST(p.next() == parser_event::TAG_START);
+    BOOST_TEST(p.next() == parser_event::TAG_START);
+    BOOST_CHECK_THROW(p.skip(), std::out_of_range);
+}
@@ -12,7 +12,9 @@
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <span>
 #include <stdexcept>
+#include <system_error>
 
 #include <fcntl.h>
 #include <utility>
@@ -24,6 +26,7 @@
 #include "nbt/file.hh"
 #include "nbt/region.hh"
 #include "nbt/utils.hh"
+#include "nbt/xxhash.hh"
 
 namespace pixel_terrain::anvil {
     region::region(std::filesystem::path const &filename) {
@@ -32,7 +35,8 @@ namespace pixel_terrain::anvil {
     }
 
     region::region(std::filesystem::path const &filename,
-                   std::filesystem::path const &journal_dir) {
+                   std::filesystem::path const &journal_dir, journal_key key)
+        : key_(key) {
         data = new file<unsigned char>(filename);
         len = data->size();
 
@@ -40,19 +44,33 @@ namespace pixel_terrain::anvil {
         journal_path /=
             std::filesystem::path(filename).filename().concat(".ptcache");
         try {
-            last_update =
-                new file<std::uint64_t>(journal_path,
-                                        nbt::biomes::CHUNK_PER_REGION_WIDTH *
-                                            nbt::biomes::CHUNK_PER_REGION_WIDTH,
-                                        "r+");
+            /* Journals of other sizes are from older versions; start over
+               rather than misreading them. */
+            std::error_code ec;
+            auto journal_size = std::filesystem::file_size(journal_path, ec);
+            if (!ec && journal_size != sizeof(journal)) {
+                std::filesystem::remove(journal_path);
+            }
+
+            journal_file = new file<journal>(journal_path, 1, "r+");
         } catch (...) {
             delete data;
             std::rethrow_exception(std::current_exception());
         }
+
+        journal_ = journal_file->get_raw_data();
+        if (journal_->magic != journal::MAGIC ||
+            journal_->version != journal::VERSION ||
+            journal_->entry_size != sizeof(journal_entry)) {
+            std::memset(journal_, 0, sizeof(journal));
+            journal_->magic = journal::MAGIC;
+            journal_->version = journal::VERSION;
+            journal_->entry_size = sizeof(journal_entry);
+        }
     }
 
     region::~region() {
-        delete last_update;
+        delete journal_file;
         delete data;
     }
 
@@ -90,18 +108,47 @@ namespace pixel_terrain::anvil {
         return (*data)[b_off + 3];
     }
 
-    auto region::chunk_data(int chunk_x, int chunk_z)
-        -> std::vector<std::uint8_t> * {
+    /* Raw location field in region header, offset and size together. */
+    auto region::chunk_location(int chunk_x, int chunk_z) -> std::uint32_t {
+        std::size_t b_off = header_offset(chunk_x, chunk_z);
+
+        if (b_off + 3 >= len) {
+            return 0;
+        }
+
+        std::int32_t result;
+        std::memcpy(&result, data->get_raw_data() + b_off,
+                    sizeof(std::int32_t));
+        return nbt::utils::to_host_byte_order(result);
+    }
+
+    auto region::chunk_timestamp(int chunk_x, int chunk_z) -> std::uint32_t {
+        constexpr std::size_t timestamp_table_off = 4096;
+        std::size_t b_off =
+            timestamp_table_off + header_offset(chunk_x, chunk_z);
+
+        if (b_off + 3 >= len) {
+            return 0;
+        }
+
+        std::int32_t result;
+        std::memcpy(&result, data->get_raw_data() + b_off,
+                    sizeof(std::int32_t));
+        return nbt::utils::to_host_byte_order(result);
+    }
+
+    auto region::chunk_payload(int chunk_x, int chunk_z)
+        -> std::span<std::uint8_t const> {
         std::size_t location_off = chunk_location_off(chunk_x, chunk_z);
         std::size_t location_sec = chunk_location_sectors(chunk_x, chunk_z);
         if (location_off == 0 || location_sec == 0) {
-            return nullptr;
+            return {};
         }
 
         location_off *= 4096; // NOLINT
 
         if (location_off + 4 >= len) {
-            return nullptr;
+            return {};
         }
 
         std::int32_t length;
@@ -110,32 +157,60 @@ namespace pixel_terrain::anvil {
         length = nbt::utils::to_host_byte_order(length);
         location_off += 4;
 
-        int compression = (*data)[location_off];
-        if (compression == 1) {
+        if (length < 1 || location_off + length > len) {
+            return {};
+        }
+        return {data->get_raw_data() + location_off,
+                static_cast<std::size_t>(length)};
+    }
+
+    auto region::inflate_chunk(int chunk_x, int chunk_z)
+        -> nbt::utils::decompressor * {
+        std::span<std::uint8_t const> payload =
+            chunk_payload(chunk_x, chunk_z);
+        if (payload.empty()) {
             return nullptr;
         }
-        ++location_off;
 
-        if (location_off + length - 1 > len) {
+        auto compression = static_cast<nbt::utils::compression>(payload[0]);
+        if (compression != nbt::utils::compression::GZIP &&
+            compression != nbt::utils::compression::ZLIB &&
+            compression != nbt::utils::compression::NONE) {
+            /* Unsupported, or stored in external file. */
             return nullptr;
         }
 
-        return nbt::utils::zlib_decompress(data->get_raw_data() + location_off,
-                                           length - 1);
+        nbt::utils::decompressor &decompressor =
+            nbt::utils::thread_decompressor();
+        if (!decompressor.decompress(payload.data() + 1, payload.size() - 1,
+                                     compression)) {
+            return nullptr;
+        }
+        return &decompressor;
+    }
+
+    auto region::chunk_data(int chunk_x, int chunk_z)
+        -> std::span<std::uint8_t const> {
+        nbt::utils::decompressor *data = inflate_chunk(chunk_x, chunk_z);
+        if (data == nullptr) {
+            return {};
+        }
+        return data->view();
     }
 
     auto region::get_chunk(int chunk_x, int chunk_z) -> chunk * {
-        auto data = chunk_data(chunk_x, chunk_z);
+        nbt::utils::decompressor *data = inflate_chunk(chunk_x, chunk_z);
 
         if (data == nullptr) {
             return nullptr;
         }
 
 #if USE_V3_NBT_PARSER
-        auto *cur_chunk = new chunk(*data);
-        delete data;
+        auto *cur_chunk = new chunk(data->view());
 #else
-        auto *cur_chunk = new chunk(data);
+        /* Pull parser reads lazily, so the chunk needs its own copy. */
+        auto *cur_chunk = new chunk(
+            new std::vector<std::uint8_t>(data->begin(), data->end()));
 #endif
         return cur_chunk;
     }
@@ -146,7 +221,35 @@ namespace pixel_terrain::anvil {
     }
 
     auto region::get_chunk_if_dirty(int chunk_x, int chunk_z) -> chunk * {
-        std::vector<std::uint8_t> *data = chunk_data(chunk_x, chunk_z);
+        journal_entry *entry = nullptr;
+        std::uint32_t timestamp = chunk_timestamp(chunk_x, chunk_z);
+        std::uint32_t location = chunk_location(chunk_x, chunk_z);
+        std::uint64_t payload_hash = 0;
+        if (journal_ != nullptr) {
+            std::size_t index =
+                chunk_z * nbt::biomes::CHUNK_PER_REGION_WIDTH + chunk_x;
+            entry = &journal_->entries[index];
+            bool up_to_date = entry->matches(key_);
+            /* Minecraft rewrites both timestamp and location whenever it
+               saves a chunk, so the chunk is unchanged if they match. */
+            if (up_to_date && timestamp != 0 &&
+                entry->timestamp == timestamp && entry->location == location) {
+                return nullptr;
+            }
+
+            std::span<std::uint8_t const> payload =
+                chunk_payload(chunk_x, chunk_z);
+            payload_hash =
+                nbt::utils::xxhash64(payload.data(), payload.size());
+            if (up_to_date && entry->payload_hash == payload_hash) {
+                /* Saved again without change. */
+                entry->timestamp = timestamp;
+                entry->location = location;
+                return nullptr;
+            }
+        }
+
+        nbt::utils::decompressor *data = inflate_chunk(chunk_x, chunk_z);
         if (data == nullptr) {
             return nullptr;
         }
@@ -154,38 +257,33 @@ namespace pixel_terrain::anvil {
 #if USE_V3_NBT_PARSER
         chunk *cur_chunk;
         try {
-            cur_chunk = new chunk(*data);
+            cur_chunk = new chunk(data->view());
         } catch (chunk_parse_error const &e) {
             ELOG("Error parsing chunk: %s\n", e.what());
-            delete data;
             return nullptr;
         } catch (broken_chunk_error const &e) {
             ELOG("Error parsing chunk: broken chunk: %s\n", e.what());
-            delete data;
             return nullptr;
         } catch (chunk_exception const &) {
             /* Ignore this because it won't be a very big problem. */
-            delete data;
             return nullptr;
         } catch (std::runtime_error const &e) {
             ELOG("Error parsing chunk: unknown error occurred!: %s\n",
                  e.what());
-            delete data;
             return nullptr;
         }
-        delete data;
 #else
-        auto *cur_chunk = new chunk(data);
+        /* Pull parser reads lazily, so the chunk needs its own copy. */
+        auto *cur_chunk = new chunk(
+            new std::vector<std::uint8_t>(data->begin(), data->end()));
 #endif
-        if (last_update != nullptr) {
-            if ((*last_update)[chunk_z * nbt::biomes::CHUNK_PER_REGION_WIDTH +
-                               chunk_x] >= cur_chunk->get_last_update()) {
-                delete cur_chunk;
-                return nullptr;
-            }
-
-            (*last_update)[chunk_z * nbt::biomes::CHUNK_PER_REGION_WIDTH +
-                           chunk_x] = cur_chunk->get_last_update();
+        if (entry != nullptr) {
+            entry->payload_hash = payload_hash;
+            entry->options = key_.options;
+            entry->color_table = key_.color_table;
+            entry->timestamp = timestamp;
+            entry->location = location;
+            entry->flags = journal_entry::VALID;
         }
 
         return cur_chunk;
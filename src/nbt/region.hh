@@ -3,35 +3,93 @@
 #ifndef REGION_HH
 #define REGION_HH
 
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "nbt/chunk.hh"
+#include "nbt/constants.hh"
 #include "nbt/file.hh"
+#include "nbt/utils.hh"
 #include "utils/path_hack.hh"
 
 namespace pixel_terrain::anvil {
+    /* Inputs other than chunk data that affect rendered pixels. Journal
+       entries recorded with different key are stale. */
+    struct journal_key {
+        std::uint64_t options = 0;
+        std::uint32_t color_table = 0;
+    };
+
+    /* Per-chunk record in *.ptcache journal. */
+    struct journal_entry {
+        static constexpr std::uint32_t VALID = 1;
+
+        /* xxHash of compression type and compressed data. */
+        std::uint64_t payload_hash;
+        std::uint64_t options;
+        std::uint32_t color_table;
+        /* Copied from region header. */
+        std::uint32_t timestamp;
+        std::uint32_t location;
+        std::uint32_t flags;
+
+        [[nodiscard]] auto matches(journal_key const &key) const -> bool {
+            return (flags & VALID) != 0 && options == key.options &&
+                   color_table == key.color_table;
+        }
+    };
+
+    /* Layout of *.ptcache journal, stored in host byte order. */
+    struct journal {
+        static constexpr std::array<char, 8> MAGIC = {'P', 'T', 'C', 'A',
+                                                      'C', 'H', 'E', '\0'};
+        static constexpr std::uint32_t VERSION = 2;
+
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t entry_size;
+        std::array<journal_entry, nbt::biomes::CHUNK_PER_REGION_WIDTH *
+                                      nbt::biomes::CHUNK_PER_REGION_WIDTH>
+            entries;
+    };
+
     class region {
         file<unsigned char> *data = nullptr;
         std::size_t len;
-        file<std::uint64_t> *last_update = nullptr;
+        file<journal> *journal_file = nullptr;
+        journal *journal_ = nullptr;
+        journal_key key_;
 
         static auto header_offset(int chunk_x, int chunk_z) -> std::size_t;
         auto chunk_location_off(int chunk_x, int chunk_z) -> std::size_t;
         auto chunk_location_sectors(int chunk_x, int chunk_z) -> std::size_t;
+        auto chunk_location(int chunk_x, int chunk_z) -> std::uint32_t;
+        auto chunk_timestamp(int chunk_x, int chunk_z) -> std::uint32_t;
+        auto chunk_payload(int chunk_x, int chunk_z)
+            -> std::span<std::uint8_t const>;
+        auto inflate_chunk(int chunk_x, int chunk_z)
+            -> nbt::utils::decompressor *;
 
     public:
         /* Construct new region object from given buffer of *.mca file content
          */
         region(std::filesystem::path const &filename);
+        /* Chunks are reported dirty only if their data or KEY changed
+           since recorded in the journal in JOURNAL_DIR. */
         region(std::filesystem::path const &filename,
-               std::filesystem::path const &journal_dir);
+               std::filesystem::path const &journal_dir, journal_key key);
         ~region();
+        /* Returns decompressed data of the chunk, or empty span if the
+           chunk does not exist or cannot be read. The data lives in a
+           buffer owned by the calling thread and is valid until the thread
+           reads another chunk. */
         auto chunk_data(int chunk_x, int chunk_z)
-            -> std::vector<std::uint8_t> *;
+            -> std::span<std::uint8_t const>;
         auto get_chunk(int chunk_x, int chunk_z) -> chunk *;
         auto get_chunk_if_dirty(int chunk_x, int chunk_z) -> chunk *;
         auto is_chunk_missing(int chunk_x, int chunk_z) -> bool;
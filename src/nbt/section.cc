@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: MIT
+
+/* Decoder for packed BlockStates arrays.
+   Whole section is unpacked at once so that callers can look up blocks
+   with plain array access. */
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "nbt/section.hh"
+
+namespace pixel_terrain::anvil {
+    auto block_state_bits(std::size_t palette_size) -> unsigned int {
+        constexpr unsigned int min_bits = 4;
+
+        if (palette_size < 2) {
+            return min_bits;
+        }
+        return std::max<unsigned int>(min_bits,
+                                      std::bit_width(palette_size - 1));
+    }
+
+    void unpack_indices(std::vector<std::uint64_t> const &data,
+                        unsigned int bits, bool stretches,
+                        std::size_t palette_size, std::uint16_t *out,
+                        std::size_t count) {
+        std::uint64_t const mask = (std::uint64_t{1} << bits) - 1;
+        std::size_t i = 0;
+
+        if (stretches) {
+            std::size_t avail = std::min(count, data.size() * 64 / bits);
+            for (std::size_t bit = 0; i < avail; ++i, bit += bits) {
+                std::size_t word = bit / 64;
+                unsigned int shift = bit % 64;
+                std::uint64_t v = data[word] >> shift;
+                if (shift + bits > 64) {
+                    v |= data[word + 1] << (64 - shift);
+                }
+                v &= mask;
+                out[i] = v < palette_size ? v : 0;
+            }
+        } else {
+            unsigned int per_word = 64 / bits;
+            for (std::uint64_t word : data) {
+                for (unsigned int j = 0; j < per_word && i < count; ++j) {
+                    std::uint64_t v = word & mask;
+                    word >>= bits;
+                    out[i++] = v < palette_size ? v : 0;
+                }
+                if (i == count) {
+                    break;
+                }
+            }
+        }
+
+        std::fill(out + i, out + count, 0);
+    }
+} // namespace pixel_terrain::anvil
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef SECTION_HH
+#define SECTION_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "nbt/constants.hh"
+
+namespace pixel_terrain::anvil {
+    /* Dense palette indices of one 16x16x16 section,
+       in (y * 16 + z) * 16 + x order. */
+    using section_indices =
+        std::array<std::uint16_t, nbt::biomes::SECTION_BLOCK_COUNT>;
+
+    /* Number of bits used to pack an index into a palette of
+       PALETTE_SIZE entries. */
+    auto block_state_bits(std::size_t palette_size) -> unsigned int;
+
+    /* Unpack COUNT indices of BITS width from DATA into OUT.
+       If STRETCHES is true, indices may span two longs (format before
+       DataVersion 2529); otherwise each long holds floor(64 / BITS)
+       indices and remaining bits are padding.
+       Indices not covered by DATA, or not less than PALETTE_SIZE, are
+       stored as 0. */
+    void unpack_indices(std::vector<std::uint64_t> const &data,
+                        unsigned int bits, bool stretches,
+                        std::size_t palette_size, std::uint16_t *out,
+                        std::size_t count);
+} // namespace pixel_terrain::anvil
+
+#endif
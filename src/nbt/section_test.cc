@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "nbt/section.hh"
+
+using namespace pixel_terrain::anvil;
+
+namespace {
+    auto pack(std::vector<std::uint16_t> const &values, unsigned int bits,
+              bool stretches) -> std::vector<std::uint64_t> {
+        std::vector<std::uint64_t> result;
+        if (stretches) {
+            result.resize((values.size() * bits + 63) / 64);
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                std::size_t bit = i * bits;
+                result[bit / 64] |= std::uint64_t{values[i]} << (bit % 64);
+                if (bit % 64 + bits > 64) {
+                    result[bit / 64 + 1] |=
+                        std::uint64_t{values[i]} >> (64 - bit % 64);
+                }
+            }
+        } else {
+            unsigned int per_word = 64 / bits;
+            result.resize((values.size() + per_word - 1) / per_word);
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                result[i / per_word] |= std::uint64_t{values[i]}
+                                        << (i % per_word * bits);
+            }
+        }
+        return result;
+    }
+
+    auto make_indices(std::size_t palette_size) -> std::vector<std::uint16_t> {
+        std::vector<std::uint16_t> result(4096);
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            result[i] = (i * 7 + i / 13) % palette_size;
+        }
+        return result;
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(block_state_bits_test) {
+    BOOST_TEST(block_state_bits(1) == 4);
+    BOOST_TEST(block_state_bits(16) == 4);
+    BOOST_TEST(block_state_bits(17) == 5);
+    BOOST_TEST(block_state_bits(32) == 5);
+    BOOST_TEST(block_state_bits(33) == 6);
+    BOOST_TEST(block_state_bits(300) == 9);
+}
+
+BOOST_AUTO_TEST_CASE(unpack_stretched) {
+    for (std::size_t palette_size : {2, 16, 17, 40, 300}) {
+        auto expected = make_indices(palette_size);
+        unsigned int bits = block_state_bits(palette_size);
+        auto packed = pack(expected, bits, true);
+
+        section_indices out;
+        unpack_indices(packed, bits, true, palette_size, out.data(),
+                       out.size());
+        BOOST_TEST(std::vector<std::uint16_t>(out.begin(), out.end()) ==
+                   expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unpack_padded) {
+    for (std::size_t palette_size : {2, 16, 17, 40, 300}) {
+        auto expected = make_indices(palette_size);
+        unsigned int bits = block_state_bits(palette_size);
+        auto packed = pack(expected, bits, false);
+
+        section_indices out;
+        unpack_indices(packed, bits, false, palette_size, out.data(),
+                       out.size());
+        BOOST_TEST(std::vector<std::uint16_t>(out.begin(), out.end()) ==
+                   expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unpack_short_data) {
+    std::vector<std::uint64_t> packed{0x1111111111111111};
+    section_indices out;
+    out.fill(0xffff);
+    unpack_indices(packed, 4, false, 2, out.data(), out.size());
+    for (std::size_t i = 0; i < 16; ++i) {
+        BOOST_TEST(out[i] == 1);
+    }
+    for (std::size_t i = 16; i < out.size(); ++i) {
+        BOOST_TEST(out[i] == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unpack_out_of_palette) {
+    std::vector<std::uint64_t> packed{0xf};
+    section_indices out;
+    unpack_indices(packed, 4, false, 3, out.data(), out.size());
+    BOOST_TEST(out[0] == 0);
+}
@@ -7,6 +7,7 @@
 #include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -186,20 +187,38 @@ namespace pixel_terrain::nbt {
             return static_cast<Tp *>(
                 std::memcpy(result, tmp.data(), sizeof(Tp)));
         }
+
+        /* Bytes left in [FIRST, LAST). Data may be a mapped file, so
+           bounds are checked by sizes rather than by moving iterators past
+           LAST. */
+        auto remaining(tag::data_iterator first, tag::data_iterator last)
+            -> std::size_t {
+            return first < last ? static_cast<std::size_t>(last - first) : 0;
+        }
+
+        /* Sizes of payloads of fixed size, or 0. */
+        constexpr std::array<std::size_t, num_types> fixed_payload_sizes = {
+            0, 1, 2, 4, 8, 4, 8, 0, 0, 0, 0, 0, 0,
+        };
+
+        /* Sizes of elements of array types, or 0. */
+        constexpr std::array<std::size_t, num_types> array_element_sizes = {
+            0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 4, 8,
+        };
     } // namespace
 
     auto parse_type_and_name(tag::data_iterator const &first,
                              tag::data_iterator const &last)
-        -> std::pair<std::optional<std::pair<tag_type, std::string>>,
+        -> std::pair<std::optional<std::pair<tag_type, std::string_view>>,
                      tag::data_iterator> {
-        if (last <= first + 3) {
+        if (remaining(first, last) <= 3) {
             return std::make_pair(std::nullopt, first);
         }
 
         std::uint8_t type_id = *first;
         tag::data_iterator itr = first + 1;
 
-        if (num_types < static_cast<std::size_t>(type_id)) {
+        if (num_types <= static_cast<std::size_t>(type_id)) {
             return std::make_pair(std::nullopt, first);
         }
 
@@ -212,118 +231,160 @@ namespace pixel_terrain::nbt {
         ordered_copy(itr, itr + sizeof(std::uint16_t), &name_len);
         itr += sizeof(std::uint16_t);
 
-        if (last < itr + name_len) {
+        if (remaining(itr, last) < name_len) {
             return std::make_pair(std::nullopt, first);
         }
 
-        std::string name(itr, itr + name_len);
+        std::string_view name(reinterpret_cast<char const *>(itr), name_len);
         itr += name_len;
 
         return std::make_pair(std::make_pair(ty, name), itr);
     }
 
-    namespace factory {
-        namespace {
-            template <tag_type TT>
-            auto make_tag(tag::data_iterator const &first,
-                          tag::data_iterator const &last)
-                -> std::pair<tag *, tag::data_iterator> {
-                auto [t, itr] = nbt::basic_tag<TT>::parse_buffer(first, last);
-                if (t == nullptr) {
-                    delete t;
-                    return std::make_pair(nullptr, first);
-                }
+    auto skip_payload(tag_type type, tag::data_iterator first,
+                      tag::data_iterator last)
+        -> std::optional<tag::data_iterator> {
+        auto type_id = static_cast<std::size_t>(type);
+        if (num_types <= type_id) {
+            return std::nullopt;
+        }
 
-                return std::make_pair(t, itr);
+        if (std::size_t size = fixed_payload_sizes[type_id]; size != 0) {
+            if (remaining(first, last) < size) {
+                return std::nullopt;
             }
+            return first + size;
+        }
 
-            auto make_tag_end_payload(
-                tag::data_iterator const &first,
-                [[maybe_unused]] tag::data_iterator const &last)
-                -> std::pair<tag_payload *, tag::data_iterator> {
-                return std::make_pair(new tag_null_payload, first);
+        if (std::size_t size = array_element_sizes[type_id]; size != 0) {
+            if (remaining(first, last) < sizeof(std::uint32_t)) {
+                return std::nullopt;
+            }
+            std::uint32_t len;
+            ordered_copy(first, first + sizeof(std::uint32_t), &len);
+            tag::data_iterator itr = first + sizeof(std::uint32_t);
+            if (remaining(itr, last) / size < len) {
+                return std::nullopt;
             }
+            return itr + len * size;
+        }
 
-            auto make_tag_byte_payload(tag::data_iterator const &first,
-                                       tag::data_iterator const &last)
-                -> std::pair<tag_payload *, tag::data_iterator> {
-                if (first <= last) {
-                    auto *p = new nbt::tag_byte_payload;
-                    **p = *first;
-                    return std::make_pair(p, first + 1);
-                }
-                return std::make_pair(nullptr, first);
+        if (type == tag_type::TAG_END) {
+            return first;
+        }
+
+        if (type == tag_type::TAG_STRING) {
+            if (remaining(first, last) < sizeof(std::uint16_t)) {
+                return std::nullopt;
             }
+            std::uint16_t len;
+            ordered_copy(first, first + sizeof(std::uint16_t), &len);
+            tag::data_iterator itr = first + sizeof(std::uint16_t);
+            if (remaining(itr, last) < len) {
+                return std::nullopt;
+            }
+            return itr + len;
+        }
 
-            auto make_tag_short_payload(tag::data_iterator const &first,
-                                        tag::data_iterator const &last)
-                -> std::pair<tag_payload *, tag::data_iterator> {
-                if (first + sizeof(std::int16_t) <= last) {
-                    auto *p = new nbt::tag_short_payload;
-                    std::int16_t result;
-                    ordered_copy(first, first + sizeof(std::int16_t), &result);
-                    **p = result;
-                    return std::make_pair(p, first + sizeof(std::int16_t));
+        if (type == tag_type::TAG_LIST) {
+            if (remaining(first, last) < 1 + sizeof(std::uint32_t)) {
+                return std::nullopt;
+            }
+            std::uint8_t payload_type_id = *first;
+            std::uint32_t len;
+            ordered_copy(first + 1, first + 1 + sizeof(std::uint32_t),
+                         &len);
+            tag::data_iterator itr = first + 1 + sizeof(std::uint32_t);
+            if (num_types <= payload_type_id) {
+                return std::nullopt;
+            }
+            if (static_cast<tag_type>(payload_type_id) ==
+                tag_type::TAG_END) {
+                return itr;
+            }
+            if (std::size_t size = fixed_payload_sizes[payload_type_id];
+                size != 0) {
+                if (remaining(itr, last) / size < len) {
+                    return std::nullopt;
                 }
-                return std::make_pair(nullptr, first);
+                return itr + len * size;
             }
-
-            auto make_tag_int_payload(tag::data_iterator const &first,
-                                      tag::data_iterator const &last)
-                -> std::pair<tag_payload *, tag::data_iterator> {
-                if (first + sizeof(std::int32_t) <= last) {
-                    auto *p = new nbt::tag_int_payload;
-                    std::int32_t result;
-                    ordered_copy(first, first + sizeof(std::int32_t), &result);
-                    **p = result;
-                    return std::make_pair(p, first + sizeof(std::int32_t));
+            for (std::uint32_t i = 0; i < len; ++i) {
+                auto next = skip_payload(
+                    static_cast<tag_type>(payload_type_id), itr, last);
+                if (!next) {
+                    return std::nullopt;
                 }
-                return std::make_pair(nullptr, first);
+                itr = *next;
             }
+            return itr;
+        }
 
-            auto make_tag_long_payload(tag::data_iterator const &first,
-                                       tag::data_iterator const &last)
-                -> std::pair<tag_payload *, tag::data_iterator> {
-                if (first + sizeof(std::int32_t) <= last) {
-                    auto *p = new nbt::tag_long_payload;
-                    std::uint64_t result;
-                    ordered_copy(first, first + sizeof(std::uint64_t), &result);
-                    **p = result;
-                    return std::make_pair(p, first + sizeof(std::uint64_t));
+        /* TAG_Compound */
+        tag::data_iterator itr = first;
+        for (;;) {
+            if (remaining(itr, last) == 0) {
+                return std::nullopt;
+            }
+            if (static_cast<tag_type>(*itr) == tag_type::TAG_END) {
+                return itr + 1;
+            }
+            auto [hdr, payload] = parse_type_and_name(itr, last);
+            if (!hdr) {
+                return std::nullopt;
+            }
+            auto next = skip_payload(hdr->first, payload, last);
+            if (!next) {
+                return std::nullopt;
+            }
+            itr = *next;
+        }
+    }
+
+    namespace factory {
+        namespace {
+            template <tag_type TT>
+            auto make_tag(tag::data_iterator const &first,
+                          tag::data_iterator const &last, tag_allocator alloc)
+                -> std::pair<tag *, tag::data_iterator> {
+                auto [t, itr] =
+                    nbt::basic_tag<TT>::parse_buffer(first, last, alloc);
+                if (t == nullptr) {
+                    return std::make_pair(nullptr, first);
                 }
-                return std::make_pair(nullptr, first);
+
+                return std::make_pair(t, itr);
             }
 
-            auto make_tag_float_payload(tag::data_iterator const &first,
-                                        tag::data_iterator const &last)
+            auto make_tag_end_payload(
+                tag::data_iterator const &first,
+                [[maybe_unused]] tag::data_iterator const &last,
+                tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                if (first + sizeof(std::int32_t) <= last) {
-                    auto *p = new nbt::tag_float_payload;
-                    float result;
-                    ordered_copy(first, first + sizeof(float), &result);
-                    **p = result;
-                    return std::make_pair(p, first + sizeof(float));
-                }
-                return std::make_pair(nullptr, first);
+                return std::make_pair(alloc.make<tag_null_payload>(), first);
             }
 
-            auto make_tag_double_payload(tag::data_iterator const &first,
-                                         tag::data_iterator const &last)
+            /* Payload of fixed size TP. */
+            template <class Payload, typename Tp>
+            auto make_scalar_payload(tag::data_iterator const &first,
+                                     tag::data_iterator const &last,
+                                     tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                if (first + sizeof(double) <= last) {
-                    auto *p = new nbt::tag_double_payload;
-                    double result;
-                    ordered_copy(first, first + sizeof(double), &result);
-                    **p = result;
-                    return std::make_pair(p, first + sizeof(double));
+                if (remaining(first, last) < sizeof(Tp)) {
+                    return std::make_pair(nullptr, first);
                 }
-                return std::make_pair(nullptr, first);
+
+                Tp result;
+                ordered_copy(first, first + sizeof(Tp), &result);
+                return std::make_pair(alloc.make<Payload>(result),
+                                      first + sizeof(Tp));
             }
 
             auto make_tag_byte_array_payload(tag::data_iterator const &first,
-                                             tag::data_iterator const &last)
+                                             tag::data_iterator const &last,
+                                             tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                if (last < first + sizeof(std::uint32_t)) {
+                if (remaining(first, last) < sizeof(std::uint32_t)) {
                     return std::make_pair(nullptr, first);
                 }
 
@@ -331,24 +392,22 @@ namespace pixel_terrain::nbt {
                 ordered_copy(first, first + sizeof(std::uint32_t), &len);
                 tag::data_iterator itr = first + sizeof(std::uint32_t);
 
-                if (last < itr + len) {
+                if (remaining(itr, last) < len) {
                     return std::make_pair(nullptr, first);
                 }
 
-                auto *p = new nbt::tag_byte_array_payload;
-                for (unsigned int i = 0; i < len; ++i) {
-                    std::uint8_t item = *itr;
-                    ++itr;
-                    (*p)->push_back(item);
-                }
+                auto *p =
+                    alloc.make<nbt::tag_byte_array_payload>(alloc.resource());
+                (*p)->assign(itr, itr + len);
 
-                return std::make_pair(p, itr);
+                return std::make_pair(p, itr + len);
             }
 
             auto make_tag_string_payload(tag::data_iterator const &first,
-                                         tag::data_iterator const &last)
+                                         tag::data_iterator const &last,
+                                         tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                if (last < first + sizeof(std::uint16_t)) {
+                if (remaining(first, last) < sizeof(std::uint16_t)) {
                     return std::make_pair(nullptr, first);
                 }
 
@@ -356,20 +415,21 @@ namespace pixel_terrain::nbt {
                 ordered_copy(first, first + sizeof(std::uint16_t), &len);
                 tag::data_iterator itr = first + sizeof(std::uint16_t);
 
-                if (last < itr + len) {
+                if (remaining(itr, last) < len) {
                     return std::make_pair(nullptr, first);
                 }
 
-                auto *p = new nbt::tag_string_payload;
-                **p = std::string(itr, itr + len);
+                auto *p = alloc.make<nbt::tag_string_payload>(alloc.resource());
+                (**p).assign(itr, itr + len);
 
                 return std::make_pair(p, itr + len);
             }
 
             auto make_tag_list_payload(tag::data_iterator const &first,
-                                       tag::data_iterator const &last)
+                                       tag::data_iterator const &last,
+                                       tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                if (last < first + 3) {
+                if (remaining(first, last) < 1 + sizeof(std::uint32_t)) {
                     return std::make_pair(nullptr, first);
                 }
                 std::uint8_t payload_type_id = *first;
@@ -383,14 +443,19 @@ namespace pixel_terrain::nbt {
                 ordered_copy(itr, itr + sizeof(std::uint32_t), &len);
                 itr += sizeof(std::uint32_t);
 
-                auto *p = new nbt::tag_list_payload;
+                auto *p = alloc.make<nbt::tag_list_payload>(alloc.resource());
                 p->set_payload_type(payload_type);
+                /* Each element takes at least a byte, except TAG_End. */
+                if (payload_type != tag_type::TAG_END) {
+                    (*p)->reserve(std::min<std::size_t>(
+                        len, remaining(itr, last)));
+                }
 
                 for (unsigned int i = 0; i < len; ++i) {
                     auto [item, out_itr] =
-                        payload_factories[payload_type_id](itr, last);
+                        payload_factories[payload_type_id](itr, last, alloc);
                     if (item == nullptr) {
-                        delete p;
+                        alloc.destroy(p);
                         return std::make_pair(nullptr, first);
                     }
                     (*p)->push_back(item);
@@ -401,21 +466,23 @@ namespace pixel_terrain::nbt {
             }
 
             auto make_tag_compound_payload(tag::data_iterator const &first,
-                                           tag::data_iterator const &last)
+                                           tag::data_iterator const &last,
+                                           tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                auto *p = new nbt::tag_compound_payload;
+                auto *p =
+                    alloc.make<nbt::tag_compound_payload>(alloc.resource());
 
                 tag::data_iterator itr = first;
 
                 for (;;) {
-                    if (last < itr) {
-                        delete p;
+                    if (remaining(itr, last) == 0) {
+                        alloc.destroy(p);
                         return std::make_pair(nullptr, first);
                     }
 
                     std::uint8_t tag_type_id = *itr;
                     if (12 < tag_type_id) {
-                        delete p;
+                        alloc.destroy(p);
                         return std::make_pair(nullptr, first);
                     }
                     if (static_cast<tag_type>(tag_type_id) ==
@@ -425,9 +492,9 @@ namespace pixel_terrain::nbt {
                     }
 
                     auto [item, out_itr] =
-                        tag_factories[tag_type_id](itr, last);
+                        tag_factories[tag_type_id](itr, last, alloc);
                     if (item == nullptr) {
-                        delete p;
+                        alloc.destroy(p);
                         return std::make_pair(nullptr, first);
                     }
 
@@ -438,10 +505,13 @@ namespace pixel_terrain::nbt {
                 return std::make_pair(p, itr);
             }
 
-            auto make_tag_int_array_payload(tag::data_iterator const &first,
-                                            tag::data_iterator const &last)
+            /* Array of big endian TP. */
+            template <class Payload, typename Tp>
+            auto make_array_payload(tag::data_iterator const &first,
+                                    tag::data_iterator const &last,
+                                    tag_allocator alloc)
                 -> std::pair<tag_payload *, tag::data_iterator> {
-                if (last <= first + sizeof(std::uint32_t)) {
+                if (remaining(first, last) < sizeof(std::uint32_t)) {
                     return std::make_pair(nullptr, first);
                 }
 
@@ -449,42 +519,15 @@ namespace pixel_terrain::nbt {
                 ordered_copy(first, first + sizeof(std::uint32_t), &len);
                 tag::data_iterator itr = first + sizeof(std::uint32_t);
 
-                if (last < first + len * sizeof(std::int32_t)) {
+                if (remaining(itr, last) / sizeof(Tp) < len) {
                     return std::make_pair(nullptr, first);
                 }
 
-                auto *p = new nbt::tag_int_array_payload;
-                for (unsigned int i = 0; i < len; ++i) {
-                    std::int32_t item;
-                    ordered_copy(itr, itr + sizeof(std::int32_t), &item);
-                    itr += sizeof(std::int32_t);
-                    (*p)->push_back(item);
-                }
-
-                return std::make_pair(p, itr);
-            }
-
-            auto make_tag_long_array_payload(tag::data_iterator const &first,
-                                             tag::data_iterator const &last)
-                -> std::pair<tag_payload *, tag::data_iterator> {
-                if (last < first + sizeof(std::uint32_t)) {
-                    return std::make_pair(nullptr, first);
-                }
-
-                std::uint32_t len;
-                ordered_copy(first, first + sizeof(std::uint32_t), &len);
-                tag::data_iterator itr = first + sizeof(std::uint32_t);
-
-                if (last < itr + len * sizeof(std::uint64_t)) {
-                    return std::make_pair(nullptr, first);
-                }
-
-                auto *p = new nbt::tag_long_array_payload;
-                for (unsigned int i = 0; i < len; ++i) {
-                    std::uint64_t item;
-                    ordered_copy(itr, itr + sizeof(std::int64_t), &item);
-                    itr += sizeof(std::uint64_t);
-                    (*p)->push_back(item);
+                auto *p = alloc.make<Payload>(alloc.resource());
+                (*p)->resize(len);
+                for (Tp &item : **p) {
+                    ordered_copy(itr, itr + sizeof(Tp), &item);
+                    itr += sizeof(Tp);
                 }
 
                 return std::make_pair(p, itr);
@@ -493,7 +536,8 @@ namespace pixel_terrain::nbt {
 
         // NOLINTNEXTLINE
         std::pair<tag *, tag::data_iterator> (*tag_factories[])(
-            tag::data_iterator const &first, tag::data_iterator const &last) = {
+            tag::data_iterator const &first, tag::data_iterator const &last,
+            tag_allocator alloc) = {
             &make_tag<tag_type::TAG_END>,
             &make_tag<tag_type::TAG_BYTE>,
             &make_tag<tag_type::TAG_SHORT>,
@@ -511,14 +555,176 @@ namespace pixel_terrain::nbt {
 
         // NOLINTNEXTLINE
         std::pair<tag_payload *, tag::data_iterator> (*payload_factories[])(
-            tag::data_iterator const &first, tag::data_iterator const &last) = {
-            &make_tag_end_payload,        &make_tag_byte_payload,
-            &make_tag_short_payload,      &make_tag_int_payload,
-            &make_tag_long_payload,       &make_tag_float_payload,
-            &make_tag_double_payload,     &make_tag_byte_array_payload,
-            &make_tag_string_payload,     &make_tag_list_payload,
-            &make_tag_compound_payload,   &make_tag_int_array_payload,
-            &make_tag_long_array_payload,
+            tag::data_iterator const &first, tag::data_iterator const &last,
+            tag_allocator alloc) = {
+            &make_tag_end_payload,
+            &make_scalar_payload<tag_byte_payload, std::uint8_t>,
+            &make_scalar_payload<tag_short_payload, std::int16_t>,
+            &make_scalar_payload<tag_int_payload, std::int32_t>,
+            &make_scalar_payload<tag_long_payload, std::uint64_t>,
+            &make_scalar_payload<tag_float_payload, float>,
+            &make_scalar_payload<tag_double_payload, double>,
+            &make_tag_byte_array_payload,
+            &make_tag_string_payload,
+            &make_tag_list_payload,
+            &make_tag_compound_payload,
+            &make_array_payload<tag_int_array_payload, std::int32_t>,
+            &make_array_payload<tag_long_array_payload, std::uint64_t>,
         };
     } // namespace factory
+
+    namespace {
+        auto make_selected_tag(tag::data_iterator const &first,
+                               tag::data_iterator const &last,
+                               tag_allocator alloc,
+                               nbt_selection::node const &selected,
+                               std::span<raw_tag> raw_tags)
+            -> std::pair<tag *, tag::data_iterator>;
+
+        /* Compound with children in SELECTED. */
+        auto make_selected_compound_payload(
+            tag::data_iterator const &first, tag::data_iterator const &last,
+            tag_allocator alloc, nbt_selection::node const &selected,
+            std::span<raw_tag> raw_tags)
+            -> std::pair<tag_payload *, tag::data_iterator> {
+            auto *p = alloc.make<nbt::tag_compound_payload>(alloc.resource());
+
+            tag::data_iterator itr = first;
+            for (;;) {
+                if (remaining(itr, last) == 0) {
+                    alloc.destroy(p);
+                    return std::make_pair(nullptr, first);
+                }
+                if (static_cast<tag_type>(*itr) == tag_type::TAG_END) {
+                    ++itr;
+                    break;
+                }
+
+                auto [hdr, payload] = parse_type_and_name(itr, last);
+                if (!hdr) {
+                    alloc.destroy(p);
+                    return std::make_pair(nullptr, first);
+                }
+
+                nbt_selection::node const *child = selected.find(hdr->second);
+                if (child == nullptr || child->raw >= 0) {
+                    auto next = skip_payload(hdr->first, payload, last);
+                    if (!next) {
+                        alloc.destroy(p);
+                        return std::make_pair(nullptr, first);
+                    }
+                    if (child != nullptr) {
+                        raw_tags[child->raw] = {
+                            hdr->first,
+                            std::span<std::uint8_t const>(payload, *next)};
+                    }
+                    itr = *next;
+                    continue;
+                }
+
+                auto [item, out_itr] =
+                    make_selected_tag(itr, last, alloc, *child, raw_tags);
+                if (item == nullptr) {
+                    alloc.destroy(p);
+                    return std::make_pair(nullptr, first);
+                }
+                (*p)->push_back(item);
+                itr = out_itr;
+            }
+
+            return std::make_pair(p, itr);
+        }
+
+        /* List of compounds, each with children in SELECTED. */
+        auto make_selected_list_payload(tag::data_iterator const &first,
+                                        tag::data_iterator const &last,
+                                        tag_allocator alloc,
+                                        nbt_selection::node const &selected,
+                                        std::span<raw_tag> raw_tags)
+            -> std::pair<tag_payload *, tag::data_iterator> {
+            if (remaining(first, last) < 1 + sizeof(std::uint32_t)) {
+                return std::make_pair(nullptr, first);
+            }
+            std::uint32_t len;
+            ordered_copy(first + 1, first + 1 + sizeof(std::uint32_t), &len);
+            tag::data_iterator itr = first + 1 + sizeof(std::uint32_t);
+
+            auto *p = alloc.make<nbt::tag_list_payload>(alloc.resource());
+            p->set_payload_type(tag_type::TAG_COMPOUND);
+            (*p)->reserve(std::min<std::size_t>(len, remaining(itr, last)));
+
+            for (std::uint32_t i = 0; i < len; ++i) {
+                auto [item, out_itr] = make_selected_compound_payload(
+                    itr, last, alloc, selected, raw_tags);
+                if (item == nullptr) {
+                    alloc.destroy(p);
+                    return std::make_pair(nullptr, first);
+                }
+                (*p)->push_back(item);
+                itr = out_itr;
+            }
+
+            return std::make_pair(p, itr);
+        }
+
+        auto make_selected_tag(tag::data_iterator const &first,
+                               tag::data_iterator const &last,
+                               tag_allocator alloc,
+                               nbt_selection::node const &selected,
+                               std::span<raw_tag> raw_tags)
+            -> std::pair<tag *, tag::data_iterator> {
+            auto [hdr, itr] = parse_type_and_name(first, last);
+            if (!hdr) {
+                return std::make_pair(nullptr, first);
+            }
+            auto [type, name] = *hdr;
+
+            if (!selected.all && type == tag_type::TAG_COMPOUND) {
+                auto [p, out_itr] = make_selected_compound_payload(
+                    itr, last, alloc, selected, raw_tags);
+                if (p == nullptr) {
+                    return std::make_pair(nullptr, first);
+                }
+                return std::make_pair(tag_compound::make(name, p, alloc),
+                                      out_itr);
+            }
+
+            if (!selected.all && type == tag_type::TAG_LIST &&
+                remaining(itr, last) != 0 &&
+                static_cast<tag_type>(*itr) == tag_type::TAG_COMPOUND) {
+                auto [p, out_itr] = make_selected_list_payload(
+                    itr, last, alloc, selected, raw_tags);
+                if (p == nullptr) {
+                    return std::make_pair(nullptr, first);
+                }
+                return std::make_pair(tag_list::make(name, p, alloc), out_itr);
+            }
+
+            return factory::tag_factories[static_cast<std::uint8_t>(type)](
+                first, last, alloc);
+        }
+    } // namespace
+
+    auto parse_selected(std::span<std::uint8_t const> data,
+                        nbt_selection const &selection, tag_allocator alloc,
+                        std::span<raw_tag> raw_tags)
+        -> std::pair<tag_compound *, tag::data_iterator> {
+        tag::data_iterator first = data.data();
+        tag::data_iterator last = data.data() + data.size();
+
+        auto hdr = parse_type_and_name(first, last).first;
+        if (!hdr || hdr->first != tag_type::TAG_COMPOUND) {
+            return std::make_pair(nullptr, first);
+        }
+
+        /* An unselected root is still parsed, with all children
+           skipped. */
+        nbt_selection::node const none;
+        nbt_selection::node const *root = selection.root().find(hdr->second);
+        if (root == nullptr) {
+            root = &none;
+        }
+        auto [t, itr] = make_selected_tag(first, last, alloc, *root, raw_tags);
+        return std::make_pair(static_cast<tag_compound *>(t), itr);
+    }
 } // namespace pixel_terrain::nbt
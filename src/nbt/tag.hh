@@ -8,9 +8,13 @@
 #include <cstdint>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <ostream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -42,6 +46,51 @@ namespace pixel_terrain::nbt {
         return tag_type_repr_table[static_cast<std::size_t>(ty)];
     }
 
+    /* Bytes in [FIRST, LAST) of any contiguous range of bytes, such as a
+       vector, a mapped file or a decompression buffer. */
+    template <std::contiguous_iterator Iterator>
+    auto byte_span(Iterator first, Iterator last)
+        -> std::span<std::uint8_t const> {
+        static_assert(sizeof(std::iter_value_t<Iterator>) == 1);
+        return {reinterpret_cast<std::uint8_t const *>(std::to_address(first)),
+                static_cast<std::size_t>(last - first)};
+    }
+
+    /* Where parsed tags are allocated. Without an arena, each tag is
+       allocated with new and deletes its children. With an arena, tags and
+       their values are placed in it, and are freed at once with the arena
+       without their destructors run. */
+    class tag_allocator {
+        std::pmr::memory_resource *arena_;
+
+    public:
+        explicit tag_allocator(std::pmr::memory_resource *arena = nullptr)
+            : arena_(arena) {}
+
+        /* Resource for values of tags. */
+        [[nodiscard]] auto resource() const -> std::pmr::memory_resource * {
+            return arena_ != nullptr ? arena_
+                                     : std::pmr::get_default_resource();
+        }
+
+        template <class Tp, class... Args>
+        auto make(Args &&...args) -> Tp * {
+            if (arena_ == nullptr) {
+                return new Tp(std::forward<Args>(args)...);
+            }
+            return new (arena_->allocate(sizeof(Tp), alignof(Tp)))
+                Tp(std::forward<Args>(args)...);
+        }
+
+        /* Free P made by make(), on parse error. */
+        template <class Tp>
+        void destroy(Tp *p) {
+            if (arena_ == nullptr) {
+                delete p;
+            }
+        }
+    };
+
     class tag_payload;
 
     template <class Tp, class = std::is_convertible<Tp, tag_payload>>
@@ -107,20 +156,24 @@ namespace pixel_terrain::nbt {
 
     class tag {
     public:
-        using data_iterator = std::vector<std::uint8_t>::const_iterator;
+        /* Tags are parsed in place from contiguous bytes. */
+        using data_iterator = std::uint8_t const *;
 
     protected:
-        std::string name_;
+        std::pmr::string name_;
 
         auto query_internal(nbt_path *path) -> tag_payload *;
 
+        tag() = default;
+        explicit tag(std::pmr::memory_resource *resource) : name_(resource) {}
+
     public:
         virtual ~tag() = default;
 
         [[nodiscard]] virtual auto data() -> tag_payload * = 0;
 
         [[nodiscard]] auto type() -> tag_type { return data()->type(); }
-        [[nodiscard]] auto name() const -> std::string const & { return name_; }
+        [[nodiscard]] auto name() const -> std::string_view { return name_; }
 
         [[nodiscard]] virtual auto clone() const -> tag * = 0;
 
@@ -131,10 +184,12 @@ namespace pixel_terrain::nbt {
     namespace factory {
         // NOLINTNEXTLINE
         extern std::pair<tag *, tag::data_iterator> (*tag_factories[])(
-            tag::data_iterator const &first, tag::data_iterator const &last);
+            tag::data_iterator const &first, tag::data_iterator const &last,
+            tag_allocator alloc);
         extern std::pair<tag_payload *, tag::data_iterator> (
             *payload_factories[])(tag::data_iterator const &first, // NOLINT
-                                  tag::data_iterator const &last);
+                                  tag::data_iterator const &last,
+                                  tag_allocator alloc);
     } // namespace factory
 
     class tag_byte_payload : public tag_payload {
@@ -307,19 +362,25 @@ namespace pixel_terrain::nbt {
     };
 
     class tag_byte_array_payload : public tag_payload {
-        std::vector<std::uint8_t> data_;
+        std::pmr::vector<std::uint8_t> data_;
 
     public:
         tag_byte_array_payload() { type_ = tag_type::TAG_BYTE_ARRAY; }
+        explicit tag_byte_array_payload(std::pmr::memory_resource *resource)
+            : data_(resource) {
+            type_ = tag_type::TAG_BYTE_ARRAY;
+        }
         tag_byte_array_payload(decltype(data_) const &data) : data_(data) {
             type_ = tag_type::TAG_BYTE_ARRAY;
         }
 
-        [[nodiscard]] auto operator*() -> std::vector<std::uint8_t> & {
+        [[nodiscard]] auto operator*() -> std::pmr::vector<std::uint8_t> & {
             return data_;
         }
 
-        auto operator->() -> std::vector<std::uint8_t> * { return &data_; }
+        auto operator->() -> std::pmr::vector<std::uint8_t> * {
+            return &data_;
+        }
 
         [[nodiscard]] auto operator[](std::size_t index) -> std::uint8_t & {
             return data_[index];
@@ -345,15 +406,19 @@ namespace pixel_terrain::nbt {
     };
 
     class tag_string_payload : public tag_payload {
-        std::string data_;
+        std::pmr::string data_;
 
     public:
         tag_string_payload() { type_ = tag_type::TAG_STRING; }
+        explicit tag_string_payload(std::pmr::memory_resource *resource)
+            : data_(resource) {
+            type_ = tag_type::TAG_STRING;
+        }
         tag_string_payload(decltype(data_) const &data) : data_(data) {
             type_ = tag_type::TAG_STRING;
         }
 
-        [[nodiscard]] auto operator*() -> std::string & { return data_; }
+        [[nodiscard]] auto operator*() -> std::pmr::string & { return data_; }
 
         static constexpr auto tag_type() -> tag_type {
             return tag_type::TAG_STRING;
@@ -373,11 +438,15 @@ namespace pixel_terrain::nbt {
     };
 
     class tag_list_payload : public tag_payload {
-        std::vector<tag_payload *> data_;
+        std::pmr::vector<tag_payload *> data_;
         tag_type payload_type_;
 
     public:
         tag_list_payload() { type_ = tag_type::TAG_LIST; }
+        explicit tag_list_payload(std::pmr::memory_resource *resource)
+            : data_(resource) {
+            type_ = tag_type::TAG_LIST;
+        }
         tag_list_payload(tag_type payload_type) : payload_type_(payload_type) {
             type_ = tag_type::TAG_LIST;
         }
@@ -388,11 +457,13 @@ namespace pixel_terrain::nbt {
             }
         }
 
-        [[nodiscard]] auto operator*() -> std::vector<tag_payload *> & {
+        [[nodiscard]] auto operator*() -> std::pmr::vector<tag_payload *> & {
             return data_;
         }
 
-        auto operator->() -> std::vector<tag_payload *> * { return &data_; }
+        auto operator->() -> std::pmr::vector<tag_payload *> * {
+            return &data_;
+        }
 
         template <class Tp, class = std::is_convertible<Tp, tag_payload>>
         [[nodiscard]] auto get(std::size_t index) -> Tp * {
@@ -444,10 +515,14 @@ namespace pixel_terrain::nbt {
     };
 
     class tag_compound_payload : public tag_payload {
-        std::vector<tag *> data_;
+        std::pmr::vector<tag *> data_;
 
     public:
         tag_compound_payload() { type_ = tag_type::TAG_COMPOUND; }
+        explicit tag_compound_payload(std::pmr::memory_resource *resource)
+            : data_(resource) {
+            type_ = tag_type::TAG_COMPOUND;
+        }
 
         ~tag_compound_payload() override {
             for (tag *t : data_) {
@@ -455,11 +530,13 @@ namespace pixel_terrain::nbt {
             }
         }
 
-        [[nodiscard]] auto operator*() -> std::vector<tag *> & { return data_; }
+        [[nodiscard]] auto operator*() -> std::pmr::vector<tag *> & {
+            return data_;
+        }
 
-        auto operator->() -> std::vector<tag *> * { return &data_; }
+        auto operator->() -> std::pmr::vector<tag *> * { return &data_; }
 
-        [[nodiscard]] auto operator[](std::string const &key) -> tag * {
+        [[nodiscard]] auto operator[](std::string_view key) -> tag * {
             auto found = std::find_if(
                 data_.begin(), data_.end(),
                 [&key](tag const *t) -> bool { return t->name() == key; });
@@ -474,7 +551,7 @@ namespace pixel_terrain::nbt {
         }
 
         template <class Tp, class = std::is_convertible<Tp, tag>>
-        auto get_typed(std::string const &key) -> Tp & {
+        auto get_typed(std::string_view key) -> Tp & {
             return *static_cast<Tp *>(operator[](key));
         }
 
@@ -504,19 +581,25 @@ namespace pixel_terrain::nbt {
     };
 
     class tag_int_array_payload : public tag_payload {
-        std::vector<std::int32_t> data_;
+        std::pmr::vector<std::int32_t> data_;
 
     public:
         tag_int_array_payload() { type_ = tag_type::TAG_INT_ARRAY; }
+        explicit tag_int_array_payload(std::pmr::memory_resource *resource)
+            : data_(resource) {
+            type_ = tag_type::TAG_INT_ARRAY;
+        }
         tag_int_array_payload(decltype(data_) const &data) : data_(data) {
             type_ = tag_type::TAG_INT_ARRAY;
         }
 
-        [[nodiscard]] auto operator*() -> std::vector<std::int32_t> & {
+        [[nodiscard]] auto operator*() -> std::pmr::vector<std::int32_t> & {
             return data_;
         }
 
-        auto operator->() -> std::vector<std::int32_t> * { return &data_; }
+        auto operator->() -> std::pmr::vector<std::int32_t> * {
+            return &data_;
+        }
 
         [[nodiscard]] auto operator[](std::size_t index) -> std::int32_t & {
             return data_[index];
@@ -542,19 +625,25 @@ namespace pixel_terrain::nbt {
     };
 
     class tag_long_array_payload : public tag_payload {
-        std::vector<std::uint64_t> data_;
+        std::pmr::vector<std::uint64_t> data_;
 
     public:
         tag_long_array_payload() { type_ = tag_type::TAG_LONG_ARRAY; }
+        explicit tag_long_array_payload(std::pmr::memory_resource *resource)
+            : data_(resource) {
+            type_ = tag_type::TAG_LONG_ARRAY;
+        }
         tag_long_array_payload(decltype(data_) const &data) : data_(data) {
             type_ = tag_type::TAG_LONG_ARRAY;
         }
 
-        [[nodiscard]] auto operator*() -> std::vector<std::uint64_t> & {
+        [[nodiscard]] auto operator*() -> std::pmr::vector<std::uint64_t> & {
             return data_;
         }
 
-        auto operator->() -> std::vector<std::uint64_t> * { return &data_; }
+        auto operator->() -> std::pmr::vector<std::uint64_t> * {
+            return &data_;
+        }
 
         [[nodiscard]] auto operator[](std::size_t index) -> std::uint64_t & {
             return data_[index];
@@ -579,22 +668,43 @@ namespace pixel_terrain::nbt {
         }
     };
 
+    /* Name is a view of the buffer. */
     auto parse_type_and_name(tag::data_iterator const &first,
                              tag::data_iterator const &last)
-        -> std::pair<std::optional<std::pair<tag_type, std::string>>,
+        -> std::pair<std::optional<std::pair<tag_type, std::string_view>>,
                      tag::data_iterator>;
 
+    /* End of the payload of TYPE at FIRST, found from lengths in it
+       without decoding it, or nullopt if it does not fit before LAST. */
+    auto skip_payload(tag_type type, tag::data_iterator first,
+                      tag::data_iterator last)
+        -> std::optional<tag::data_iterator>;
+
     template <tag_type TT>
     class basic_tag : public tag {
+        friend class tag_allocator;
+
         tag_payload *data_ = nullptr;
 
         basic_tag() {}
+        explicit basic_tag(std::pmr::memory_resource *resource)
+            : tag(resource) {}
 
     public:
         ~basic_tag() { delete data_; }
 
+        /* Tag named NAME holding P, which must be made by ALLOC. */
+        static auto make(std::string_view name, tag_payload *p,
+                         tag_allocator alloc) -> basic_tag<TT> * {
+            auto *result = alloc.make<basic_tag<TT>>(alloc.resource());
+            result->name_ = name;
+            result->data_ = p;
+            return result;
+        }
+
         static auto parse_buffer(data_iterator const &first,
-                                 data_iterator const &last)
+                                 data_iterator const &last,
+                                 tag_allocator alloc = tag_allocator())
             -> std::pair<basic_tag<TT> *, data_iterator> {
             auto [hdr, itr] = parse_type_and_name(first, last);
             if (!hdr) {
@@ -606,21 +716,31 @@ namespace pixel_terrain::nbt {
                 return std::make_pair(nullptr, first);
             }
 
-            auto *result = new basic_tag<TT>;
-
-            result->name_ = name;
-
             auto [p, payload_end] =
-                factory::payload_factories[static_cast<std::uint8_t>(TT)](itr,
-                                                                          last);
+                factory::payload_factories[static_cast<std::uint8_t>(TT)](
+                    itr, last, alloc);
             if (p == nullptr) {
-                delete result;
                 return std::make_pair(nullptr, first);
             }
 
-            result->data_ = p;
+            return std::make_pair(make(name, p, alloc), payload_end);
+        }
 
-            return std::make_pair(result, payload_end);
+        static auto parse_buffer(std::span<std::uint8_t const> data,
+                                 tag_allocator alloc = tag_allocator())
+            -> std::pair<basic_tag<TT> *, data_iterator> {
+            return parse_buffer(data.data(), data.data() + data.size(),
+                                alloc);
+        }
+
+        /* Same as above, but returns the end of the tag as an iterator of
+           FIRST. */
+        template <std::contiguous_iterator Iterator>
+        static auto parse_buffer(Iterator first, Iterator last)
+            -> std::pair<basic_tag<TT> *, Iterator> {
+            std::span<std::uint8_t const> data = byte_span(first, last);
+            auto [result, itr] = parse_buffer(data);
+            return std::make_pair(result, first + (itr - data.data()));
         }
 
         auto data() -> tag_payload * override { return data_; }
@@ -696,6 +816,25 @@ namespace pixel_terrain::nbt {
     using tag_int_array = basic_tag<tag_type::TAG_INT_ARRAY>;
     using tag_long_array = basic_tag<tag_type::TAG_LONG_ARRAY>;
 
+    /* Where a tag on a raw path of a selection is in the document. TYPE
+       is TAG_END if there is no such tag. */
+    struct raw_tag {
+        tag_type type = tag_type::TAG_END;
+        std::span<std::uint8_t const> payload;
+    };
+
+    /* Parse the compound at the beginning of DATA like
+       tag_compound::parse_buffer(), but decode only tags on paths of
+       SELECTION. Others are skipped by their length without being
+       decoded, so they are missing from the result. Tags on raw paths
+       are missing too, and stored into RAW_TAGS by their index instead;
+       RAW_TAGS must have selection.raw_count() elements. */
+    auto parse_selected(std::span<std::uint8_t const> data,
+                        nbt_selection const &selection,
+                        tag_allocator alloc = tag_allocator(),
+                        std::span<raw_tag> raw_tags = {})
+        -> std::pair<tag_compound *, tag::data_iterator>;
+
     template <>
     struct cxx_to_nbt_type<tag_null_payload> {
         static auto type() -> tag_type { return tag_type::TAG_END; }
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+
+/* Compare parsing NBT documents into heap-allocated tags with parsing
+   them into an arena, and with decoding only the tags read from chunks.
+   Documents are NBT test data, and chunks of region files given as
+   arguments if any. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "nbt/nbt-path.hh"
+#include "nbt/nbt.hh"
+#include "nbt/tag.hh"
+#include "nbt/utils.hh"
+#include "nbt_test_testdata.hh"
+
+using namespace pixel_terrain::nbt;
+
+namespace {
+    using document = std::vector<std::uint8_t>;
+
+    nbt_selection const chunk_selection = {
+        nbt_path::compile("//DataVersion"),
+        nbt_path::compile("//Level/LastUpdate"),
+        nbt_path::compile("//Level/Biomes"),
+        nbt_path::compile("//Level/Heightmaps"),
+        nbt_path::compile("//Level/Sections/Y"),
+        nbt_path::compile("//Level/Sections/BlockStates"),
+        nbt_path::compile("//Level/Sections/Palette/Name"),
+        nbt_path::compile("//Level/Sections/BlockLight"),
+    };
+
+    void add_testdata_documents(std::vector<document> *documents) {
+        std::vector<std::string_view> names = {
+            "complex-1.nbt",
+            "complex-3.nbt",
+            "nbt-file.nbt",
+            "simple-tag-compound.nbt",
+        };
+
+        for (std::string_view name : names) {
+            auto data = get_embedded_data(name);
+            if (data) {
+                documents->emplace_back(data->begin(), data->end());
+            }
+        }
+    }
+
+    void add_region_documents(std::filesystem::path const &path,
+                              std::vector<document> *documents) {
+        constexpr std::size_t sector_size = 4096;
+        constexpr int n_chunks = 1024;
+
+        std::ifstream in(path, std::ios::binary);
+        std::vector<std::uint8_t> file((std::istreambuf_iterator<char>(in)),
+                                       std::istreambuf_iterator<char>());
+        if (file.size() < 2 * sector_size) {
+            std::fprintf(stderr, "%s: too small\n", path.string().c_str());
+            return;
+        }
+
+        utils::decompressor inflater;
+        for (int i = 0; i < n_chunks; ++i) {
+            std::size_t off = (std::size_t{file[i * 4]} << 16 |
+                               std::size_t{file[i * 4 + 1]} << 8 |
+                               std::size_t{file[i * 4 + 2]}) *
+                              sector_size;
+            if (off == 0 || off + 5 > file.size()) {
+                continue;
+            }
+            std::size_t len = std::size_t{file[off]} << 24 |
+                              std::size_t{file[off + 1]} << 16 |
+                              std::size_t{file[off + 2]} << 8 |
+                              std::size_t{file[off + 3]};
+            auto type = static_cast<utils::compression>(file[off + 4]);
+            if (len < 1 || off + 4 + len > file.size() ||
+                !inflater.decompress(file.data() + off + 5, len - 1, type)) {
+                continue;
+            }
+            documents->emplace_back(inflater.begin(), inflater.end());
+        }
+    }
+
+    auto parse_heap(std::span<std::uint8_t const> data) -> bool {
+        auto [root, itr] = tag_compound::parse_buffer(data);
+        bool ok = root != nullptr;
+        delete root;
+        return ok;
+    }
+
+    auto parse_arena(std::span<std::uint8_t const> data) -> bool {
+        nbt *doc = nbt::from_buffer(data);
+        bool ok = doc != nullptr;
+        delete doc;
+        return ok;
+    }
+
+    auto parse_chunk_fields(std::span<std::uint8_t const> data) -> bool {
+        nbt *doc = nbt::from_buffer(data, chunk_selection);
+        bool ok = doc != nullptr;
+        delete doc;
+        return ok;
+    }
+
+    void run(char const *name, bool (*parse)(std::span<std::uint8_t const>),
+             std::vector<document> const &documents) {
+        constexpr std::size_t target_bytes = 256 * 1024 * 1024;
+
+        std::size_t per_round = 0;
+        for (document const &d : documents) {
+            per_round += d.size();
+        }
+        std::size_t rounds = std::max<std::size_t>(1, target_bytes / per_round);
+
+        std::size_t n_failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; ++r) {
+            for (document const &d : documents) {
+                if (!parse(d)) {
+                    ++n_failed;
+                }
+            }
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        std::printf("%-8s %8zu documents %10.1f MiB/s %10.0f documents/s",
+                    name, rounds * documents.size(),
+                    rounds * per_round / elapsed.count() / (1024 * 1024),
+                    rounds * documents.size() / elapsed.count());
+        if (n_failed != 0) {
+            std::printf(" (%zu failed)", n_failed);
+        }
+        std::printf("\n");
+    }
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    std::vector<document> documents;
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) {
+            add_region_documents(argv[i], &documents);
+        }
+    } else {
+        add_testdata_documents(&documents);
+    }
+    if (documents.empty()) {
+        std::fprintf(stderr, "No document found.\n");
+        return 1;
+    }
+
+    run("heap", parse_heap, documents);
+    run("arena", parse_arena, documents);
+    run("selected", parse_chunk_fields, documents);
+
+    return 0;
+}
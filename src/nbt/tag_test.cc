@@ -1,8 +1,11 @@
 // SPDX-License-Identifier: MIT
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <span>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -342,6 +345,39 @@ BOOST_AUTO_TEST_SUITE(parser)
         delete t;
     }
 
+    BOOST_AUTO_TEST_CASE(truncated) {
+        std::vector<std::uint8_t> data = *get_embedded_data("complex-3.nbt");
+
+        /* Parsed in place, so nothing past the end may be read. */
+        for (std::size_t len = 0; len < data.size(); ++len) {
+            std::vector<std::uint8_t> prefix(data.begin(),
+                                             data.begin() + len);
+            auto [t, itr] = nbt::tag_compound::parse_buffer(
+                std::span<std::uint8_t const>(prefix));
+            BOOST_TEST(t == nullptr);
+            delete t;
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(contiguous_range) {
+        std::vector<std::uint8_t> data = *get_embedded_data("complex-3.nbt");
+        std::vector<std::byte> bytes(data.size());
+        std::memcpy(bytes.data(), data.data(), data.size());
+
+        auto [t, itr] =
+            nbt::tag_compound::parse_buffer(bytes.cbegin(), bytes.cend());
+        BOOST_TEST(t != nullptr);
+        BOOST_TEST((itr == bytes.cend()));
+        BOOST_TEST(t->name() == "foo");
+        delete t;
+
+        auto [t2, end] = nbt::tag_compound::parse_buffer(
+            std::span<std::uint8_t const>(data));
+        BOOST_TEST(t2 != nullptr);
+        BOOST_TEST((end == data.data() + data.size()));
+        delete t2;
+    }
+
     BOOST_AUTO_TEST_CASE(nested_list) {
         std::vector<std::uint8_t> data = *get_embedded_data("nested-list.nbt");
 
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MIT
+
+/* Helpers for tests to write NBT documents of chunks. */
+
+#ifndef NBT_TEST_WRITER_HH
+#define NBT_TEST_WRITER_HH
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "nbt/tag.hh"
+
+namespace pixel_terrain::nbt::testing {
+    /* Writes NBT documents in big endian, tag by tag. */
+    class nbt_writer {
+        std::vector<std::uint8_t> out_;
+
+        void be(std::uint64_t v, int bytes) {
+            for (int i = bytes - 1; i >= 0; --i) {
+                out_.push_back(static_cast<std::uint8_t>(v >> (i * 8)));
+            }
+        }
+
+        void header(tag_type type, std::string_view name) {
+            out_.push_back(static_cast<std::uint8_t>(type));
+            string_payload(name);
+        }
+
+    public:
+        [[nodiscard]] auto data() const -> std::vector<std::uint8_t> const & {
+            return out_;
+        }
+
+        void string_payload(std::string_view value) {
+            be(value.size(), 2);
+            out_.insert(out_.end(), value.begin(), value.end());
+        }
+
+        void byte(std::string_view name, std::int8_t v) {
+            header(tag_type::TAG_BYTE, name);
+            be(static_cast<std::uint8_t>(v), 1);
+        }
+
+        void int_(std::string_view name, std::int32_t v) {
+            header(tag_type::TAG_INT, name);
+            be(static_cast<std::uint32_t>(v), 4);
+        }
+
+        void long_(std::string_view name, std::int64_t v) {
+            header(tag_type::TAG_LONG, name);
+            be(static_cast<std::uint64_t>(v), 8);
+        }
+
+        void string(std::string_view name, std::string_view value) {
+            header(tag_type::TAG_STRING, name);
+            string_payload(value);
+        }
+
+        void int_array(std::string_view name,
+                       std::vector<std::int32_t> const &values) {
+            header(tag_type::TAG_INT_ARRAY, name);
+            be(values.size(), 4);
+            for (std::int32_t v : values) {
+                be(static_cast<std::uint32_t>(v), 4);
+            }
+        }
+
+        void long_array(std::string_view name,
+                        std::vector<std::uint64_t> const &values) {
+            header(tag_type::TAG_LONG_ARRAY, name);
+            be(values.size(), 4);
+            for (std::uint64_t v : values) {
+                be(v, 8);
+            }
+        }
+
+        void compound(std::string_view name) {
+            header(tag_type::TAG_COMPOUND, name);
+        }
+
+        void list(std::string_view name, tag_type element, std::int32_t len) {
+            header(tag_type::TAG_LIST, name);
+            out_.push_back(static_cast<std::uint8_t>(element));
+            be(static_cast<std::uint32_t>(len), 4);
+        }
+
+        void end() { out_.push_back(0); }
+    };
+
+    /* Pack VALUES of BITS width without spanning longs. */
+    inline auto pack(std::vector<std::uint16_t> const &values,
+                     unsigned int bits) -> std::vector<std::uint64_t> {
+        unsigned int per_word = 64 / bits;
+        std::vector<std::uint64_t> result((values.size() + per_word - 1) /
+                                          per_word);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            result[i / per_word] |= std::uint64_t{values[i]}
+                                    << (i % per_word * bits);
+        }
+        return result;
+    }
+
+    inline void block_palette(nbt_writer *w, std::string_view list_name,
+                       std::vector<std::string> const &names) {
+        w->list(list_name, tag_type::TAG_COMPOUND,
+                static_cast<std::int32_t>(names.size()));
+        for (std::string const &name : names) {
+            w->string("Name", name);
+            w->end();
+        }
+    }
+} // namespace pixel_terrain::nbt::testing
+
+#endif
@@ -2,12 +2,18 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#if USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
 #include <zlib.h>
 
 #include "nbt/utils.hh"
@@ -15,79 +21,195 @@
 namespace pixel_terrain::nbt::utils {
     namespace {
         inline constexpr std::size_t ZLIB_IO_BUF_SIZE = 1024;
-    }
 
-    auto zlib_decompress(std::uint8_t *data, std::size_t const len)
-        -> std::vector<std::uint8_t> * {
-        int z_ret;
-        z_stream strm;
-        strm.zalloc = Z_NULL;
-        strm.zfree = Z_NULL;
-        strm.opaque = Z_NULL;
-        strm.avail_in = 0;
-        strm.next_in = Z_NULL;
-        std::array<std::uint8_t, ZLIB_IO_BUF_SIZE> out;
-
-        z_ret = inflateInit(&strm);
-        if (z_ret != Z_OK) {
-            return nullptr;
+        /* Give up on streams inflating to more than this; chunk data never
+           gets close to it. */
+        inline constexpr std::size_t MAX_INFLATED_SIZE = 256 * 1024 * 1024;
+    } // namespace
+
+    zlib_backend::zlib_backend() : strm_(new z_stream) {
+        strm_->zalloc = Z_NULL;
+        strm_->zfree = Z_NULL;
+        strm_->opaque = Z_NULL;
+        strm_->avail_in = 0;
+        strm_->next_in = Z_NULL;
+
+        /* Accept both zlib and gzip header. */
+        constexpr int window_bits = 15 + 32;
+        if (inflateInit2(strm_, window_bits) != Z_OK) {
+            delete strm_;
+            throw std::runtime_error("failed to initialize zlib");
         }
+    }
 
-        auto *all_out = new std::vector<std::uint8_t>;
+    zlib_backend::~zlib_backend() {
+        inflateEnd(strm_);
+        delete strm_;
+    }
 
-        strm.avail_in = len;
-        strm.next_in = data;
+    auto zlib_backend::inflate(std::uint8_t const *data, std::size_t len,
+                               compression /* type */,
+                               std::vector<std::uint8_t> *out)
+        -> std::optional<std::size_t> {
+        if (inflateReset(strm_) != Z_OK) {
+            return std::nullopt;
+        }
 
-        do {
-            strm.avail_out = ZLIB_IO_BUF_SIZE;
-            strm.next_out = out.data();
+        strm_->avail_in = len;
+        strm_->next_in = const_cast<std::uint8_t *>(data);
 
-            z_ret = inflate(&strm, Z_NO_FLUSH);
+        std::size_t size = 0;
+        for (;;) {
+            if (size == out->size()) {
+                if (out->size() >= MAX_INFLATED_SIZE) {
+                    return std::nullopt;
+                }
+                out->resize(std::max(out->size() * 2, ZLIB_IO_BUF_SIZE));
+            }
+            strm_->avail_out = out->size() - size;
+            strm_->next_out = out->data() + size;
 
-            if (z_ret == Z_STREAM_ERROR || z_ret == Z_NEED_DICT ||
-                z_ret == Z_DATA_ERROR || z_ret == Z_MEM_ERROR) {
-                inflateEnd(&strm);
+            int z_ret = ::inflate(strm_, Z_NO_FLUSH);
+            size = out->size() - strm_->avail_out;
 
-                delete all_out;
-                return nullptr;
+            if (z_ret == Z_STREAM_END) {
+                return size;
+            }
+            if (z_ret != Z_OK && z_ret != Z_BUF_ERROR) {
+                return std::nullopt;
+            }
+            if (strm_->avail_out != 0) {
+                /* Input ended before the stream did. */
+                return std::nullopt;
             }
+        }
+    }
 
-            all_out->insert(all_out->end(), out.begin(),
-                            out.begin() + ZLIB_IO_BUF_SIZE - strm.avail_out);
-        } while (strm.avail_out == 0);
+#if USE_LIBDEFLATE
+    libdeflate_backend::libdeflate_backend()
+        : decompressor_(libdeflate_alloc_decompressor()) {
+        if (decompressor_ == nullptr) {
+            throw std::runtime_error("failed to initialize libdeflate");
+        }
+    }
 
-        if (z_ret != Z_STREAM_END) {
-            delete all_out;
-            return nullptr;
+    libdeflate_backend::~libdeflate_backend() {
+        libdeflate_free_decompressor(decompressor_);
+    }
+
+    auto libdeflate_backend::inflate(std::uint8_t const *data, std::size_t len,
+                                     compression type,
+                                     std::vector<std::uint8_t> *out)
+        -> std::optional<std::size_t> {
+        if (out->empty()) {
+            out->resize(ZLIB_IO_BUF_SIZE);
         }
 
-        inflateEnd(&strm);
+        for (;;) {
+            std::size_t size;
+            libdeflate_result result;
+            if (type == compression::GZIP) {
+                result = libdeflate_gzip_decompress(
+                    decompressor_, data, len, out->data(), out->size(), &size);
+            } else {
+                result = libdeflate_zlib_decompress(
+                    decompressor_, data, len, out->data(), out->size(), &size);
+            }
 
-        return all_out;
+            if (result == LIBDEFLATE_SUCCESS) {
+                return size;
+            }
+            /* libdeflate does not stream, so retry with larger buffer. */
+            if (result != LIBDEFLATE_INSUFFICIENT_SPACE ||
+                out->size() >= MAX_INFLATED_SIZE) {
+                return std::nullopt;
+            }
+            out->resize(out->size() * 2);
+        }
     }
+#endif
 
-    auto gzip_file_decompress(std::filesystem::path const &path)
-        -> std::vector<std::uint8_t> * {
-        ::gzFile in;
-#ifdef OS_WIN
-        in = ::gzopen_w(path.c_str(), "r");
+    auto make_inflate_backend() -> inflate_backend * {
+#if USE_LIBDEFLATE
+        return new libdeflate_backend;
 #else
-        in = ::gzopen(path.c_str(), "r");
+        return new zlib_backend;
 #endif
-        if (in == nullptr) {
+    }
+
+    decompressor::decompressor() : backend_(make_inflate_backend()) {}
+
+    decompressor::decompressor(inflate_backend *backend) : backend_(backend) {}
+
+    decompressor::~decompressor() { delete backend_; }
+
+    auto decompressor::decompress(std::uint8_t const *data, std::size_t len,
+                                  compression type) -> bool {
+        /* Chunk data usually inflates to several times of its size. */
+        constexpr std::size_t initial_ratio = 8;
+        constexpr std::size_t min_arena_size = 64 * 1024;
+
+        size_ = 0;
+
+        if (type == compression::NONE) {
+            if (arena_.size() < len) {
+                arena_.resize(len);
+            }
+            std::copy(data, data + len, arena_.begin());
+            size_ = len;
+            return true;
+        }
+
+        std::size_t want = std::max(len * initial_ratio, min_arena_size);
+        if (arena_.size() < want) {
+            arena_.resize(want);
+        }
+
+        std::optional<std::size_t> size =
+            backend_->inflate(data, len, type, &arena_);
+        if (!size) {
+            return false;
+        }
+        size_ = *size;
+        return true;
+    }
+
+    auto thread_decompressor() -> decompressor & {
+        thread_local decompressor instance;
+        return instance;
+    }
+
+    auto zlib_decompress(std::uint8_t const *data, std::size_t const len)
+        -> std::vector<std::uint8_t> * {
+        decompressor &inflater = thread_decompressor();
+        if (!inflater.decompress(data, len)) {
             return nullptr;
         }
 
-        auto *all_out = new std::vector<std::uint8_t>;
-        std::array<std::uint8_t, ZLIB_IO_BUF_SIZE> buf;
-        std::size_t nread;
+        return new std::vector<std::uint8_t>(inflater.begin(), inflater.end());
+    }
 
-        while ((nread = ::gzread(in, buf.data(), ZLIB_IO_BUF_SIZE)) != 0) {
-            all_out->insert(all_out->cend(), buf.begin(), buf.begin() + nread);
+    auto gzip_file_decompress(std::filesystem::path const &path)
+        -> std::vector<std::uint8_t> * {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return nullptr;
+        }
+        std::vector<std::uint8_t> raw((std::istreambuf_iterator<char>(in)),
+                                      std::istreambuf_iterator<char>());
+
+        /* Like gzread(), pass through files without gzip magic. */
+        constexpr std::uint8_t gzip_id1 = 0x1f;
+        constexpr std::uint8_t gzip_id2 = 0x8b;
+        if (raw.size() < 2 || raw[0] != gzip_id1 || raw[1] != gzip_id2) {
+            return new std::vector<std::uint8_t>(std::move(raw));
         }
 
-        ::gzclose(in);
+        decompressor &inflater = thread_decompressor();
+        if (!inflater.decompress(raw.data(), raw.size(), compression::GZIP)) {
+            return nullptr;
+        }
 
-        return all_out;
+        return new std::vector<std::uint8_t>(inflater.begin(), inflater.end());
     }
 } // namespace pixel_terrain::nbt::utils
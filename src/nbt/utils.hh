@@ -9,9 +9,16 @@
 #include <cstring>
 #include <filesystem>
 #include <memory>
+#include <optional>
+#include <span>
 #include <utility>
 #include <vector>
 
+struct z_stream_s;
+#if USE_LIBDEFLATE
+struct libdeflate_decompressor;
+#endif
+
 namespace pixel_terrain::nbt::utils {
     static inline void swap_chars(std::uint8_t *a, std::uint8_t *b) {
         *a ^= *b;
@@ -102,7 +109,110 @@ namespace pixel_terrain::nbt::utils {
         return src;
     }
 
-    auto zlib_decompress(std::uint8_t *data, std::size_t len)
+    /* Compression types of chunk data, as stored in region files. */
+    enum class compression : std::uint8_t { GZIP = 1, ZLIB = 2, NONE = 3 };
+
+    /* Whole-buffer inflate implementation. */
+    class inflate_backend {
+    public:
+        virtual ~inflate_backend() = default;
+
+        /* Inflate LEN bytes at DATA compressed as TYPE (GZIP or ZLIB) into
+           the beginning of OUT, growing OUT if needed. Returns number of
+           bytes written, or std::nullopt on error. */
+        virtual auto inflate(std::uint8_t const *data, std::size_t len,
+                             compression type, std::vector<std::uint8_t> *out)
+            -> std::optional<std::size_t> = 0;
+
+        [[nodiscard]] virtual auto name() const -> char const * = 0;
+    };
+
+    class zlib_backend : public inflate_backend {
+        ::z_stream_s *strm_;
+
+    public:
+        zlib_backend();
+        ~zlib_backend() override;
+
+        zlib_backend(zlib_backend const &) = delete;
+        auto operator=(zlib_backend const &) -> zlib_backend & = delete;
+
+        auto inflate(std::uint8_t const *data, std::size_t len,
+                     compression type, std::vector<std::uint8_t> *out)
+            -> std::optional<std::size_t> override;
+
+        [[nodiscard]] auto name() const -> char const * override {
+            return "zlib";
+        }
+    };
+
+#if USE_LIBDEFLATE
+    class libdeflate_backend : public inflate_backend {
+        ::libdeflate_decompressor *decompressor_;
+
+    public:
+        libdeflate_backend();
+        ~libdeflate_backend() override;
+
+        libdeflate_backend(libdeflate_backend const &) = delete;
+        auto operator=(libdeflate_backend const &)
+            -> libdeflate_backend & = delete;
+
+        auto inflate(std::uint8_t const *data, std::size_t len,
+                     compression type, std::vector<std::uint8_t> *out)
+            -> std::optional<std::size_t> override;
+
+        [[nodiscard]] auto name() const -> char const * override {
+            return "libdeflate";
+        }
+    };
+#endif
+
+    /* Returns new instance of the backend chosen at build time. */
+    auto make_inflate_backend() -> inflate_backend *;
+
+    /* Decompresses chunk data into a buffer kept across calls, so that
+       decompressing many chunks does not allocate once warmed up.
+       Not thread-safe; use thread_decompressor() to get one per thread. */
+    class decompressor {
+        inflate_backend *backend_;
+        std::vector<std::uint8_t> arena_;
+        std::size_t size_ = 0;
+
+    public:
+        decompressor();
+        /* Takes ownership of BACKEND. */
+        explicit decompressor(inflate_backend *backend);
+        ~decompressor();
+
+        decompressor(decompressor const &) = delete;
+        auto operator=(decompressor const &) -> decompressor & = delete;
+
+        /* Decompress LEN bytes at DATA compressed as TYPE. Uncompressed
+           data is copied as is. The result is valid until the next call.
+           Returns false on error. */
+        auto decompress(std::uint8_t const *data, std::size_t len,
+                        compression type = compression::ZLIB) -> bool;
+
+        [[nodiscard]] auto begin() const
+            -> std::vector<std::uint8_t>::const_iterator {
+            return arena_.cbegin();
+        }
+
+        [[nodiscard]] auto end() const
+            -> std::vector<std::uint8_t>::const_iterator {
+            return arena_.cbegin() + static_cast<std::ptrdiff_t>(size_);
+        }
+
+        [[nodiscard]] auto view() const -> std::span<std::uint8_t const> {
+            return {arena_.data(), size_};
+        }
+    };
+
+    /* Decompressor owned by the calling thread. */
+    auto thread_decompressor() -> decompressor &;
+
+    auto zlib_decompress(std::uint8_t const *data, std::size_t len)
         -> std::vector<std::uint8_t> *;
     auto gzip_file_decompress(std::filesystem::path const &path)
         -> std::vector<std::uint8_t> *;
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MIT
+
+/* XXH64, following the reference specification at
+   https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "nbt/xxhash.hh"
+
+namespace pixel_terrain::nbt::utils {
+    namespace {
+        constexpr std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+        constexpr std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+        constexpr std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+        /* Input is read as little-endian regardless of host. */
+        auto read64(std::uint8_t const *p) -> std::uint64_t {
+            std::uint64_t result = 0;
+            for (int i = 7; i >= 0; --i) {
+                result = result << 8 | p[i];
+            }
+            return result;
+        }
+
+        auto read32(std::uint8_t const *p) -> std::uint64_t {
+            std::uint64_t result = 0;
+            for (int i = 3; i >= 0; --i) {
+                result = result << 8 | p[i];
+            }
+            return result;
+        }
+
+        auto round(std::uint64_t acc, std::uint64_t input) -> std::uint64_t {
+            acc += input * PRIME64_2;
+            acc = std::rotl(acc, 31);
+            return acc * PRIME64_1;
+        }
+
+        auto merge_round(std::uint64_t acc, std::uint64_t val)
+            -> std::uint64_t {
+            acc ^= round(0, val);
+            return acc * PRIME64_1 + PRIME64_4;
+        }
+    } // namespace
+
+    auto xxhash64(void const *data, std::size_t len, std::uint64_t seed)
+        -> std::uint64_t {
+        constexpr std::size_t stripe_size = 32;
+
+        auto const *p = static_cast<std::uint8_t const *>(data);
+        std::uint8_t const *end = p + len;
+        std::uint64_t h;
+
+        if (len >= stripe_size) {
+            std::uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+            std::uint64_t v2 = seed + PRIME64_2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - PRIME64_1;
+            std::uint8_t const *limit = end - stripe_size;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += stripe_size;
+            } while (p <= limit);
+
+            h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) +
+                std::rotl(v4, 18);
+            h = merge_round(h, v1);
+            h = merge_round(h, v2);
+            h = merge_round(h, v3);
+            h = merge_round(h, v4);
+        } else {
+            h = seed + PRIME64_5;
+        }
+
+        h += len;
+
+        for (; p + 8 <= end; p += 8) {
+            h ^= round(0, read64(p));
+            h = std::rotl(h, 27) * PRIME64_1 + PRIME64_4;
+        }
+        if (p + 4 <= end) {
+            h ^= read32(p) * PRIME64_1;
+            h = std::rotl(h, 23) * PRIME64_2 + PRIME64_3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= *p * PRIME64_5;
+            h = std::rotl(h, 11) * PRIME64_1;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME64_2;
+        h ^= h >> 29;
+        h *= PRIME64_3;
+        h ^= h >> 32;
+        return h;
+    }
+} // namespace pixel_terrain::nbt::utils
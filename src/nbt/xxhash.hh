@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: MIT
+
+#ifndef XXHASH_HH
+#define XXHASH_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pixel_terrain::nbt::utils {
+    /* 64-bit xxHash (XXH64) of LEN bytes at DATA. */
+    auto xxhash64(void const *data, std::size_t len, std::uint64_t seed = 0)
+        -> std::uint64_t;
+} // namespace pixel_terrain::nbt::utils
+
+#endif
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <boost/test/tools/interface.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/test/unit_test_suite.hpp>
+
+#include "nbt/xxhash.hh"
+
+using namespace pixel_terrain::nbt::utils;
+
+namespace {
+    auto hash(std::string_view s, std::uint64_t seed = 0) -> std::uint64_t {
+        return xxhash64(s.data(), s.size(), seed);
+    }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(xxhash64_known_values) {
+    BOOST_TEST(hash("") == 0xEF46DB3751D8E999ULL);
+    BOOST_TEST(hash("a") == 0xD24EC4F1A98C6E5BULL);
+    BOOST_TEST(hash("abc") == 0x44BC2CF5AD770999ULL);
+    BOOST_TEST(hash("Nobody inspects the spammish repetition") ==
+               0xFBCEA83C8A378BF1ULL);
+}
+
+BOOST_AUTO_TEST_CASE(xxhash64_seed) {
+    BOOST_TEST(hash("abc", 1) != hash("abc"));
+    BOOST_TEST(hash("abc", 1) == hash("abc", 1));
+}
+
+BOOST_AUTO_TEST_CASE(xxhash64_all_lengths) {
+    /* Every length up to a few stripes, to cover all tail paths. */
+    std::vector<std::uint8_t> data(100);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::uint8_t>(i * 31 + 7);
+    }
+    for (std::size_t len = 0; len < data.size(); ++len) {
+        std::uint64_t h = xxhash64(data.data(), len);
+        BOOST_TEST(h == xxhash64(data.data(), len));
+        BOOST_TEST(h != xxhash64(data.data(), len + 1));
+    }
+}
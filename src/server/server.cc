@@ -173,17 +173,18 @@ namespace pixel_terrain::server {
 
                 return;
             }
+            int min_y = chunk->get_min_height();
             if (dimen == "nether") {
                 constexpr int nether_max_y = 127;
 
                 bool air_found = false;
-                for (int y = nether_max_y; y >= 0; --y) {
+                for (int y = nether_max_y; y >= min_y; --y) {
                     std::string block =
                         chunk->get_block(x_in_chunk, y, z_in_chunk);
                     if (block == "minecraft:air" ||
                         block == "minecraft:cave_air" ||
                         block == "minecraft:void_air") {
-                        if (y == 0) {
+                        if (y == min_y) {
                             response()
                                 .set_response_code(RESPONSE_NOT_FOUND)
                                 ->write_to(w);
@@ -197,7 +198,7 @@ namespace pixel_terrain::server {
                     }
 
                     if (!air_found) {
-                        if (y == 0) {
+                        if (y == min_y) {
                             response()
                                 .set_response_code(RESPONSE_NOT_FOUND)
                                 ->write_to(w);
@@ -222,15 +223,15 @@ namespace pixel_terrain::server {
                     break;
                 }
             } else {
-                constexpr int max_y = 255;
+                int max_y = std::max(chunk->get_max_height(), min_y);
 
-                for (int y = max_y; y >= 0; --y) {
+                for (int y = max_y; y >= min_y; --y) {
                     std::string block =
                         chunk->get_block(x_in_chunk, y, z_in_chunk);
                     if (block == "minecraft:air" ||
                         block == "minecraft:cave_air" ||
                         block == "minecraft:void_air") {
-                        if (y == 0) {
+                        if (y == min_y) {
                             response()
                                 .set_response_code(RESPONSE_NOT_FOUND)
                                 ->write_to(w);
@@ -3,89 +3,158 @@
 #ifndef WORKER_THREAD_HH
 #define WORKER_THREAD_HH
 
-/* Generic implementation of threaded worker. */
+/* Generic implementation of threaded worker.
+   Each worker owns a deque of jobs. It takes jobs from the back of its own
+   deque, and steals from the front of others' when it runs out. Jobs queued
+   from a worker thread go to that worker's deque; jobs from other threads
+   are distributed round-robin. */
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <system_error>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace pixel_terrain {
-    namespace {
-        enum class signal_type { JOB, TERMINATE };
-
-        template <typename T>
-        class worker_signal {
-            signal_type type_;
-            T data_;
-
-        public:
-            worker_signal(signal_type type, T data)
-                : type_(type), data_(data) {}
-
-            worker_signal(signal_type type) : type_(type) {}
-
-            [[nodiscard]] auto type() const -> signal_type { return type_; }
-
-            [[nodiscard]] auto data() const -> T const & { return data_; }
-        };
-    } // namespace
-
     template <typename T>
     class threaded_worker {
+        struct job_queue {
+            std::mutex mtx;
+            std::deque<T> jobs;
+        };
+
         unsigned int n_workers_;
         std::function<void(T)> handler_;
 
         std::vector<std::thread *> workers_;
-        std::mutex queue_mtx_, signal_mtx_;
-        std::condition_variable signal_cond_;
+        std::vector<job_queue *> queues_;
+
+        /* Jobs sitting in queues. */
+        std::atomic<std::size_t> n_queued_ = 0;
+        /* Jobs queued but not yet handled, including running ones. */
+        std::atomic<std::size_t> n_outstanding_ = 0;
+        std::atomic<unsigned int> n_parked_ = 0;
+        std::atomic<unsigned int> next_queue_ = 0;
+
+        std::mutex park_mtx_;
+        std::condition_variable park_cond_;
         bool finished_ = false;
 
-        std::queue<T> job_queue_;
+        static inline thread_local threaded_worker<T> *current_pool_ = nullptr;
+        static inline thread_local unsigned int current_index_ = 0;
 
-        auto fetch_job_block() -> worker_signal<T> {
-            for (;;) {
-                std::unique_lock<std::mutex> queue_lock(queue_mtx_);
-                if (job_queue_.empty()) {
-                    if (finished_) {
-                        return worker_signal<T>(signal_type::TERMINATE);
-                    }
-                    queue_lock.unlock();
+        /* Index of the queue new jobs from this thread should go. */
+        auto submit_index() -> unsigned int {
+            if (current_pool_ == this) {
+                return current_index_;
+            }
+            return next_queue_++ % queues_.size();
+        }
 
-                    std::unique_lock<std::mutex> signal_lock(signal_mtx_);
-                    signal_cond_.wait(signal_lock);
-                    continue;
+        auto try_pop(unsigned int index, T &item) -> bool {
+            if (n_queued_ == 0) {
+                return false;
+            }
+
+            {
+                job_queue *own = queues_[index];
+                std::unique_lock<std::mutex> lock(own->mtx);
+                if (!own->jobs.empty()) {
+                    item = std::move(own->jobs.back());
+                    own->jobs.pop_back();
+                    --n_queued_;
+                    return true;
+                }
+            }
+
+            for (std::size_t i = 1; i < queues_.size(); ++i) {
+                job_queue *victim = queues_[(index + i) % queues_.size()];
+                std::unique_lock<std::mutex> lock(victim->mtx);
+                if (!victim->jobs.empty()) {
+                    item = std::move(victim->jobs.front());
+                    victim->jobs.pop_front();
+                    --n_queued_;
+                    return true;
                 }
-                T item = job_queue_.front();
-                job_queue_.pop();
-                return worker_signal<T>(signal_type::JOB, item);
             }
+            return false;
         }
 
-        void handle_jobs_internal() {
+        /* Wake up to N parked workers after jobs are made visible. */
+        void unpark(std::size_t n) {
+            if (n_parked_ == 0) {
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(park_mtx_);
+            if (n == 1) {
+                park_cond_.notify_one();
+            } else {
+                park_cond_.notify_all();
+            }
+        }
+
+        void handle_jobs_internal(unsigned int index) {
+            current_pool_ = this;
+            current_index_ = index;
+
             for (;;) {
-                worker_signal<T> sig = fetch_job_block();
+                T item;
+                if (try_pop(index, item)) {
+                    handler_(std::move(item));
+
+                    if (--n_outstanding_ == 0) {
+                        /* Let parked workers exit if we are finishing. */
+                        std::unique_lock<std::mutex> lock(park_mtx_);
+                        if (finished_) {
+                            park_cond_.notify_all();
+                        }
+                    }
+                    continue;
+                }
 
-                if (sig.type() == signal_type::TERMINATE) {
+                std::unique_lock<std::mutex> lock(park_mtx_);
+                /* Announce parking before the final check, so that a
+                   producer either sees us parked or we see its job. */
+                ++n_parked_;
+                if (n_queued_ != 0) {
+                    --n_parked_;
+                    continue;
+                }
+                if (finished_ && n_outstanding_ == 0) {
+                    --n_parked_;
                     break;
                 }
-
-                handler_(sig.data());
+                park_cond_.wait(lock);
+                --n_parked_;
             }
+
+            current_pool_ = nullptr;
         }
 
     public:
         threaded_worker(unsigned int n_workers, std::function<void(T)> handler)
-            : n_workers_(n_workers), handler_(std::move(handler)) {}
+            : n_workers_(n_workers), handler_(std::move(handler)) {
+            unsigned int n_queues = n_workers_ == 0 ? 1 : n_workers_;
+            for (unsigned int i = 0; i < n_queues; ++i) {
+                queues_.push_back(new job_queue);
+            }
+        }
 
         ~threaded_worker() {
             if (!workers_.empty()) {
                 finish();
             }
+            for (job_queue *q : queues_) {
+                delete q;
+            }
         }
 
         threaded_worker(threaded_worker<T> const &) = delete;
@@ -96,7 +165,7 @@ namespace pixel_terrain {
             for (unsigned int i = 0; i < n_workers_; ++i) {
                 try {
                     auto *th = new std::thread(
-                        &threaded_worker<T>::handle_jobs_internal, this);
+                        &threaded_worker<T>::handle_jobs_internal, this, i);
                     workers_.push_back(th);
                 } catch (std::system_error const &) {
                     finish();
@@ -107,19 +176,57 @@ namespace pixel_terrain {
         }
 
         void queue_job(T item) {
-            std::unique_lock<std::mutex> lock(queue_mtx_);
-            job_queue_.push(std::move(item));
-            signal_cond_.notify_one();
+            ++n_outstanding_;
+            job_queue *q = queues_[submit_index()];
+            {
+                std::unique_lock<std::mutex> lock(q->mtx);
+                q->jobs.push_back(std::move(item));
+            }
+            ++n_queued_;
+            unpark(1);
+        }
+
+        /* Queue jobs in [FIRST, LAST) at once. From a worker thread they
+           go to its own queue for others to steal; otherwise they are
+           spread over all queues. */
+        template <typename Iterator>
+        void queue_jobs(Iterator first, Iterator last) {
+            auto n = static_cast<std::size_t>(std::distance(first, last));
+            if (n == 0) {
+                return;
+            }
+
+            n_outstanding_ += n;
+            if (current_pool_ == this) {
+                job_queue *q = queues_[current_index_];
+                std::unique_lock<std::mutex> lock(q->mtx);
+                q->jobs.insert(q->jobs.end(), first, last);
+            } else {
+                std::size_t per_queue =
+                    (n + queues_.size() - 1) / queues_.size();
+                while (first != last) {
+                    job_queue *q = queues_[submit_index()];
+                    std::unique_lock<std::mutex> lock(q->mtx);
+                    for (std::size_t i = 0; i < per_queue && first != last;
+                         ++i, ++first) {
+                        q->jobs.push_back(*first);
+                    }
+                }
+            }
+            n_queued_ += n;
+            unpark(n);
         }
 
+        /* Wait for all queued jobs, including ones queued by running jobs,
+           to be handled, then stop workers. */
         void finish() {
             {
-                std::unique_lock<std::mutex> lock(queue_mtx_);
+                std::unique_lock<std::mutex> lock(park_mtx_);
                 finished_ = true;
+                park_cond_.notify_all();
             }
 
             for (std::thread *th : workers_) {
-                signal_cond_.notify_all();
                 th->join();
                 delete th;
             }
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: MIT
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <vector>
 
 #include "utils/threaded_worker.hh"
 
@@ -78,6 +81,79 @@ namespace {
         worker.finish();
         std::puts("\r\e[JDone.");
     }
+
+    std::atomic<long> handled;
+
+    void report(char const *name, std::chrono::steady_clock::time_point start,
+                long n_jobs) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::printf("%s: %ld jobs in %.3f s (%.0f jobs/s)\n", name, n_jobs,
+                    elapsed.count(), n_jobs / elapsed.count());
+        if (handled != n_jobs) {
+            std::printf("  error: %ld jobs handled\n", handled.load());
+        }
+    }
+
+    void throughput_benchmark() {
+        constexpr int n_jobs = 2000000;
+        constexpr int n_fanout = 1000;
+        constexpr int per_fanout = 1000;
+        unsigned int n_threads =
+            max(1, (int)std::thread::hardware_concurrency());
+
+        std::puts("Running throughput_benchmark");
+
+        /* Tiny jobs queued one by one from outside the pool. */
+        handled = 0;
+        auto start = std::chrono::steady_clock::now();
+        {
+            pixel_terrain::threaded_worker<int> worker(
+                n_threads, [](int) { ++handled; });
+            worker.start();
+            for (int i = 0; i < n_jobs; ++i) {
+                worker.queue_job(i);
+            }
+            worker.finish();
+        }
+        report("single", start, n_jobs);
+
+        /* Same jobs queued in one batch. */
+        handled = 0;
+        start = std::chrono::steady_clock::now();
+        {
+            pixel_terrain::threaded_worker<int> worker(
+                n_threads, [](int) { ++handled; });
+            worker.start();
+            std::vector<int> jobs(n_jobs);
+            worker.queue_jobs(jobs.begin(), jobs.end());
+            worker.finish();
+        }
+        report("batch", start, n_jobs);
+
+        /* Jobs which queue more jobs from workers, like split regions. */
+        handled = 0;
+        start = std::chrono::steady_clock::now();
+        {
+            pixel_terrain::threaded_worker<int> *self = nullptr;
+            pixel_terrain::threaded_worker<int> worker(
+                n_threads, [&self](int n) {
+                    if (n < 0) {
+                        std::vector<int> jobs(per_fanout, 0);
+                        self->queue_jobs(jobs.begin(), jobs.end());
+                        return;
+                    }
+                    ++handled;
+                });
+            self = &worker;
+            worker.start();
+            for (int i = 0; i < n_fanout; ++i) {
+                worker.queue_job(-1);
+            }
+            worker.finish();
+        }
+        report("fan-out", start, static_cast<long>(n_fanout) * per_fanout);
+    }
 } // namespace
 
 int main(void) {
@@ -86,4 +162,5 @@ int main(void) {
     slow_producer_test();
     few_item_test();
     zero_item_test();
+    throughput_benchmark();
 }
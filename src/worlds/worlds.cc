@@ -45,7 +45,7 @@ namespace pixel_terrain {
             return false;
         }
 #if USE_V3_NBT_PARSER
-        auto *leveldat = nbt::nbt::from_iterator(data->cbegin(), data->cend());
+        auto *leveldat = nbt::nbt::from_buffer(*data);
         auto *world_name_node = leveldat->query<nbt::tag_string_payload>(
             nbt::nbt_path::compile("//Data/LevelName"));
         if (world_name_node == nullptr) {
@@ -58,7 +58,7 @@ namespace pixel_terrain {
             nbt::nbt_path::compile("//Data/WorldGenSettings/dimensions"));
         if (dimensions_node != nullptr) {
             for (auto *tag : **dimensions_node) {
-                dimensions_.push_back(tag->name());
+                dimensions_.emplace_back(tag->name());
             }
         }
         delete dimensions_node;
@@ -88,7 +88,7 @@ namespace pixel_terrain {
                 enabled_datapacks_node->payload_type() ==
                     nbt::tag_type::TAG_STRING) {
                 for (auto *p : **enabled_datapacks_node) {
-                    enabled_datapacks_.push_back(
+                    enabled_datapacks_.emplace_back(
                         **static_cast<nbt::tag_string_payload *>(p));
                 }
             }
@@ -101,7 +101,7 @@ namespace pixel_terrain {
                 disabled_datapacks_node->payload_type() ==
                     nbt::tag_type::TAG_STRING) {
                 for (auto *p : **disabled_datapacks_node) {
-                    disabled_datapacks_.push_back(
+                    disabled_datapacks_.emplace_back(
                         **static_cast<nbt::tag_string_payload *>(p));
                 }
             }